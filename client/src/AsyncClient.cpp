@@ -0,0 +1,292 @@
+// This file implements the AsyncClient class, a pipelining client library for the graph server.
+
+#include "AsyncClient.hpp"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Constructor: the pool is opened by connect()
+AsyncClient::AsyncClient(const std::string &ip, int port, size_t size)
+    : serverIP(ip), serverPort(port), poolSize(size == 0 ? 1 : size), nextRequestId(1), nextConnection(0) {}
+
+// Destructor: closes all pooled connections
+AsyncClient::~AsyncClient()
+{
+    disconnect();
+}
+
+// Opens every connection in the pool and starts its reader thread
+void AsyncClient::connect()
+{
+    sockaddr_in serverAddr;
+    std::memset(&serverAddr, 0, sizeof(serverAddr));
+    serverAddr.sin_family = AF_INET;
+    serverAddr.sin_port = htons(serverPort);
+    if (inet_pton(AF_INET, serverIP.c_str(), &serverAddr.sin_addr) <= 0)
+    {
+        throw std::runtime_error("Invalid address / Address not supported");
+    }
+
+    for (size_t i = 0; i < poolSize; ++i)
+    {
+        auto connection = std::make_unique<PooledConnection>();
+        connection->socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (connection->socket == -1)
+        {
+            disconnect();
+            throw std::runtime_error("Error creating socket");
+        }
+        if (::connect(connection->socket, (struct sockaddr *)&serverAddr, sizeof(serverAddr)) < 0)
+        {
+            ::close(connection->socket);
+            disconnect();
+            throw std::runtime_error("Connection failed");
+        }
+        PooledConnection *raw = connection.get();
+        connection->reader = std::thread(&AsyncClient::readLoop, this, std::ref(*raw));
+        pool.push_back(std::move(connection));
+    }
+}
+
+// Closes every connection; requests still in flight fail with an exception
+void AsyncClient::disconnect()
+{
+    for (auto &connection : pool)
+    {
+        ::shutdown(connection->socket, SHUT_RDWR);
+        if (connection->reader.joinable())
+        {
+            connection->reader.join();
+        }
+        ::close(connection->socket);
+    }
+    pool.clear();
+}
+
+// Returns true while the pool is open
+bool AsyncClient::isConnected() const
+{
+    return !pool.empty();
+}
+
+// Picks the next pooled connection round robin
+AsyncClient::PooledConnection &AsyncClient::pickConnection()
+{
+    if (pool.empty())
+    {
+        throw std::runtime_error("Not connected to server");
+    }
+    return *pool[nextConnection++ % pool.size()];
+}
+
+// Sends a request and returns a future for its response
+std::future<std::string> AsyncClient::request(const std::string &command)
+{
+    auto promise = std::make_shared<std::promise<std::string>>();
+    std::future<std::string> future = promise->get_future();
+    request(
+        command, [promise](const std::string &response)
+        { promise->set_value(response); },
+        [promise](std::exception_ptr error)
+        { promise->set_exception(error); });
+    return future;
+}
+
+// Sends a request; onResponse runs on a reader thread when the response arrives
+void AsyncClient::request(const std::string &command, Callback onResponse, ErrorCallback onError)
+{
+    send(pickConnection(), {command}, {PendingRequest{std::move(onResponse), std::move(onError)}});
+}
+
+// Sends many requests with as few writes as possible: the batch is split across the pool
+// and each connection receives its share in a single write
+std::vector<std::future<std::string>> AsyncClient::batch(const std::vector<std::string> &commands)
+{
+    std::vector<std::future<std::string>> futures;
+    if (commands.empty())
+    {
+        return futures;
+    }
+    if (pool.empty())
+    {
+        throw std::runtime_error("Not connected to server");
+    }
+
+    size_t chunkSize = (commands.size() + pool.size() - 1) / pool.size();
+    for (size_t start = 0; start < commands.size(); start += chunkSize)
+    {
+        size_t end = std::min(commands.size(), start + chunkSize);
+        std::vector<std::string> chunk(commands.begin() + start, commands.begin() + end);
+        std::vector<PendingRequest> handlers;
+        for (size_t i = start; i < end; ++i)
+        {
+            auto promise = std::make_shared<std::promise<std::string>>();
+            futures.push_back(promise->get_future());
+            handlers.push_back(PendingRequest{[promise](const std::string &response)
+                                              { promise->set_value(response); },
+                                              [promise](std::exception_ptr error)
+                                              { promise->set_exception(error); }});
+        }
+        send(pickConnection(), chunk, std::move(handlers));
+    }
+    return futures;
+}
+
+// Switches every pooled connection to the named graph and waits until all have confirmed
+void AsyncClient::useGraph(const std::string &name)
+{
+    std::vector<std::future<std::string>> confirmations;
+    for (auto &connection : pool)
+    {
+        auto promise = std::make_shared<std::promise<std::string>>();
+        confirmations.push_back(promise->get_future());
+        send(*connection, {"use_graph " + name}, {PendingRequest{[promise](const std::string &response)
+                                                                 { promise->set_value(response); },
+                                                                 [promise](std::exception_ptr error)
+                                                                 { promise->set_exception(error); }}});
+    }
+    for (auto &confirmation : confirmations)
+    {
+        confirmation.get();
+    }
+}
+
+// Registers the handlers, then writes all commands as one buffer of tagged lines
+void AsyncClient::send(PooledConnection &connection, const std::vector<std::string> &commands,
+                       std::vector<PendingRequest> handlers)
+{
+    std::string buffer;
+    {
+        std::lock_guard<std::mutex> lock(connection.pendingMutex);
+        if (connection.failed)
+        {
+            throw std::runtime_error("Connection to server lost");
+        }
+        for (size_t i = 0; i < commands.size(); ++i)
+        {
+            uint64_t id = nextRequestId++;
+            connection.pending[id] = std::move(handlers[i]);
+            buffer += "#" + std::to_string(id) + " " + commands[i] + "\n";
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(connection.writeMutex);
+    size_t sent = 0;
+    while (sent < buffer.size())
+    {
+        ssize_t n = ::send(connection.socket, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ::shutdown(connection.socket, SHUT_RDWR); // The reader fails the pending requests
+            return;
+        }
+        sent += static_cast<size_t>(n);
+    }
+}
+
+// Reader thread: accumulates bytes until a whole "#<id> <length>\n<payload>" frame is present,
+// however the stream was split into reads, then completes the matching request.
+// Streamed responses arrive as "#<id> +<length>" pieces that are collected until the final frame.
+void AsyncClient::readLoop(PooledConnection &connection)
+{
+    std::string buffer;
+    char chunk[65536];
+    while (true)
+    {
+        ssize_t n = ::recv(connection.socket, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        buffer.append(chunk, static_cast<size_t>(n));
+
+        size_t position = 0;
+        while (true)
+        {
+            size_t headerEnd = buffer.find('\n', position);
+            if (headerEnd == std::string::npos)
+            {
+                break; // Header not complete yet
+            }
+            if (buffer[position] != '#')
+            {
+                position = headerEnd + 1; // Not a frame (e.g. an untagged error line); skip it
+                continue;
+            }
+            char *afterId = nullptr;
+            uint64_t id = std::strtoull(buffer.c_str() + position + 1, &afterId, 10);
+            while (*afterId == ' ')
+            {
+                ++afterId;
+            }
+            bool last = *afterId != '+';
+            size_t length = std::strtoull(afterId + (last ? 0 : 1), nullptr, 10);
+            if (buffer.size() - (headerEnd + 1) < length)
+            {
+                break; // Payload not complete yet
+            }
+            std::string payload = buffer.substr(headerEnd + 1, length);
+            position = headerEnd + 1 + length;
+
+            PendingRequest handler;
+            {
+                std::lock_guard<std::mutex> lock(connection.pendingMutex);
+                auto it = connection.pending.find(id);
+                if (it == connection.pending.end())
+                {
+                    continue;
+                }
+                if (!last)
+                {
+                    connection.partial[id] += payload;
+                    continue;
+                }
+                handler = std::move(it->second);
+                connection.pending.erase(it);
+                auto pieces = connection.partial.find(id);
+                if (pieces != connection.partial.end())
+                {
+                    payload = pieces->second + payload;
+                    connection.partial.erase(pieces);
+                }
+            }
+            if (handler.onResponse)
+            {
+                handler.onResponse(payload);
+            }
+        }
+        buffer.erase(0, position);
+    }
+    failAll(connection, "Connection to server lost");
+}
+
+// Fails every request still waiting on a connection that has gone away
+void AsyncClient::failAll(PooledConnection &connection, const std::string &reason)
+{
+    std::unordered_map<uint64_t, PendingRequest> orphaned;
+    {
+        std::lock_guard<std::mutex> lock(connection.pendingMutex);
+        connection.failed = true;
+        orphaned.swap(connection.pending);
+        connection.partial.clear();
+    }
+    for (auto &pair : orphaned)
+    {
+        if (pair.second.onError)
+        {
+            pair.second.onError(std::make_exception_ptr(std::runtime_error(reason)));
+        }
+    }
+}
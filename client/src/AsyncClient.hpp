@@ -0,0 +1,65 @@
+#pragma once
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Asynchronous client for the graph server.
+// Requests are tagged ("#<id> <command>") and may be pipelined over a pool of connections;
+// a reader thread per connection reassembles the framed responses and completes them by ID.
+class AsyncClient
+{
+public:
+    using Callback = std::function<void(const std::string &response)>;
+    using ErrorCallback = std::function<void(std::exception_ptr error)>;
+
+    AsyncClient(const std::string &serverIP, int serverPort, size_t poolSize = 1);
+    ~AsyncClient();
+
+    void connect();
+    void disconnect();
+    bool isConnected() const;
+
+    std::future<std::string> request(const std::string &command);
+    void request(const std::string &command, Callback onResponse, ErrorCallback onError = nullptr);
+    std::vector<std::future<std::string>> batch(const std::vector<std::string> &commands);
+    void useGraph(const std::string &name);
+
+private:
+    struct PendingRequest
+    {
+        Callback onResponse;
+        ErrorCallback onError;
+    };
+
+    // One pooled socket with its reader thread and the requests still waiting for a response
+    struct PooledConnection
+    {
+        int socket = -1;
+        std::thread reader;
+        std::mutex writeMutex;
+        std::mutex pendingMutex;
+        std::unordered_map<uint64_t, PendingRequest> pending;
+        std::unordered_map<uint64_t, std::string> partial; // Pieces of streamed responses received so far
+        bool failed = false;
+    };
+
+    std::string serverIP;
+    int serverPort;
+    size_t poolSize;
+    std::vector<std::unique_ptr<PooledConnection>> pool;
+    std::atomic<uint64_t> nextRequestId;
+    std::atomic<size_t> nextConnection;
+
+    PooledConnection &pickConnection();
+    void send(PooledConnection &connection, const std::vector<std::string> &commands,
+              std::vector<PendingRequest> handlers);
+    void readLoop(PooledConnection &connection);
+    static void failAll(PooledConnection &connection, const std::string &reason);
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include "AsyncClient.hpp"
 #include <string>
 
 class Client
@@ -12,5 +13,5 @@ public:
 private:
     std::string serverIP;
     int serverPort;
-    int clientSocket;
-};
\ No newline at end of file
+    AsyncClient connection;
+};
@@ -12,8 +12,29 @@ void printHelp()
               << "  add_edge <v1> <v2> <w>  - Add an edge between vertices v1 and v2 with weight w\n"
               << "  remove_vertex <v>       - Remove vertex v from the graph\n"
               << "  remove_edge <v1> <v2>   - Remove the edge between vertices v1 and v2\n"
-              << "  calculate_mst <algo>    - Calculate the Minimum Spanning Tree using 'prim' or 'kruskal'\n"
-              << "  metrics_mst             - Get the MST and its metrics\n"
+              << "  calculate_mst <algo> [forest] [tree|edges|parents] - Calculate the Minimum Spanning Tree using 'prim' or 'kruskal'\n"
+              << "  metrics_mst [algo] [forest]   - Get the MST and its metrics (per component with 'forest')\n"
+              << "  metrics_mst [algo] full     - Eccentricities, center, centroid, degree and weight distributions\n"
+              << "  metrics_mst [algo] approx [error] [samples] - Estimate the metrics by sampling (huge trees)\n"
+              << "  calculate_mst external [file] - Kruskal on disk over an edge file (default: export this graph)\n"
+              << "  apsp_stats              - Diameter, radius and average distance over all vertex pairs\n"
+              << "  shortest_path <u> <v>   - Shortest path between two vertices in the whole graph\n"
+              << "  shortest_paths <s> ...  - Reach and distances from each source vertex\n"
+              << "  export_edges <file>     - Write this graph's edges to a binary edge file on the server\n"
+              << "  generate <kind> <args>  - Replace the graph with a generated one (random, grid, powerlaw,\n"
+              << "                            complete, tree; optional seed <s> and weights <min> <max>)\n"
+              << "  mst_path <u> <v>        - Vertices on the MST path between u and v\n"
+              << "  mst_distance <u> <v>    - Weight of the MST path between u and v\n"
+              << "  mst_bottleneck <u> <v>  - Heaviest edge on the MST path between u and v\n"
+              << "  mst_batch <query> <u1> <v1> ... - Many path/distance/bottleneck queries at once\n"
+              << "  use_graph <name>        - Switch to the named graph (created on first use)\n"
+              << "  list_graphs             - List all graphs\n"
+              << "  health                  - Show server load and queue depths\n"
+              << "  stats                   - Show command latencies, stage timings and graph sizes\n"
+              << "  trace <on|off|clear|dump> - Trace requests through the pipeline (dump = Chrome JSON)\n"
+              << "  deadline <ms>           - Time limit for each later request (0 = none)\n"
+              << "  cancel <tag>            - Stop a tagged request that is still running\n"
+              << "  priority <class>        - Schedule later requests as interactive, normal or batch\n"
               << "  help                    - Show this help message\n"
               << "  quit                    - Exit the program\n";
 }
@@ -0,0 +1,372 @@
+// This file implements the APSPEngine class: blocked, vectorized, multi-threaded Floyd-Warshall.
+
+#include "APSPEngine.hpp"
+#include "CancellationToken.hpp"
+#include "WeightKernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define APSP_AVX2 1
+#endif
+
+namespace
+{
+    // "No path": half the element range, so the sum of any two entries still fits
+    template <typename T>
+    constexpr T unreachable()
+    {
+        return std::numeric_limits<T>::max() / 2;
+    }
+
+    // Relaxes tile c through a (same rows, intermediate columns) and b (intermediate rows, same columns):
+    // c[i][j] = min(c[i][j], a[i][k] + b[k][j]). k is the outer loop, so a, b and c may be the same tile.
+    template <typename T>
+    void relaxScalar(T *c, const T *a, const T *b, size_t stride)
+    {
+        const size_t tile = APSPEngine::tileSize;
+        for (size_t k = 0; k < tile; ++k)
+        {
+            const T *bk = b + k * stride;
+            for (size_t i = 0; i < tile; ++i)
+            {
+                T aik = a[i * stride + k];
+                if (aik >= unreachable<T>())
+                {
+                    continue;
+                }
+                T *ci = c + i * stride;
+                for (size_t j = 0; j < tile; ++j)
+                {
+                    ci[j] = std::min<T>(ci[j], aik + bk[j]);
+                }
+            }
+        }
+    }
+
+#ifdef APSP_AVX2
+    __attribute__((target("avx2"))) void relaxAvx2(int32_t *c, const int32_t *a, const int32_t *b, size_t stride)
+    {
+        const size_t tile = APSPEngine::tileSize;
+        for (size_t k = 0; k < tile; ++k)
+        {
+            const int32_t *bk = b + k * stride;
+            for (size_t i = 0; i < tile; ++i)
+            {
+                int32_t aik = a[i * stride + k];
+                if (aik >= unreachable<int32_t>())
+                {
+                    continue;
+                }
+                __m256i through = _mm256_set1_epi32(aik);
+                int32_t *ci = c + i * stride;
+                for (size_t j = 0; j < tile; j += 8)
+                {
+                    __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ci + j));
+                    __m256i candidate = _mm256_add_epi32(through, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bk + j)));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(ci + j), _mm256_min_epi32(current, candidate));
+                }
+            }
+        }
+    }
+
+    // AVX2 has no 64-bit minimum, so compare and blend
+    __attribute__((target("avx2"))) void relaxAvx2(int64_t *c, const int64_t *a, const int64_t *b, size_t stride)
+    {
+        const size_t tile = APSPEngine::tileSize;
+        for (size_t k = 0; k < tile; ++k)
+        {
+            const int64_t *bk = b + k * stride;
+            for (size_t i = 0; i < tile; ++i)
+            {
+                int64_t aik = a[i * stride + k];
+                if (aik >= unreachable<int64_t>())
+                {
+                    continue;
+                }
+                __m256i through = _mm256_set1_epi64x(aik);
+                int64_t *ci = c + i * stride;
+                for (size_t j = 0; j < tile; j += 4)
+                {
+                    __m256i current = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ci + j));
+                    __m256i candidate = _mm256_add_epi64(through, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bk + j)));
+                    __m256i shorter = _mm256_cmpgt_epi64(current, candidate);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i *>(ci + j), _mm256_blendv_epi8(current, candidate, shorter));
+                }
+            }
+        }
+    }
+#endif
+
+    // Runs a batch on up to threads threads of the shared pool, or on the calling thread without one
+    void forEach(WorkerPool *pool, size_t threads, size_t count, const std::function<void(size_t)> &work)
+    {
+        if (pool && threads > 1)
+        {
+            pool->forEach(count, work, threads);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            work(i);
+        }
+    }
+
+    // Blocked Floyd-Warshall over a stride x stride matrix (stride is a multiple of the tile size)
+    template <typename T>
+    void blockedFloydWarshall(std::vector<T> &distances, size_t stride, WorkerPool *pool, size_t threads,
+                              void (*relax)(T *, const T *, const T *, size_t))
+    {
+        const size_t tile = APSPEngine::tileSize;
+        const size_t tiles = stride / tile;
+        T *d = distances.data();
+        auto at = [d, stride, tile](size_t row, size_t col)
+        {
+            return d + row * tile * stride + col * tile;
+        };
+
+        for (size_t kb = 0; kb < tiles; ++kb)
+        {
+            CancellationToken::checkpoint(); // One block of intermediate vertices per check
+            T *pivot = at(kb, kb);
+            relax(pivot, pivot, pivot, stride);
+
+            // The pivot's row and column tiles only depend on the pivot tile
+            forEach(pool, threads, 2 * (tiles - 1), [&](size_t index)
+                    {
+                size_t other = index / 2;
+                other += other >= kb ? 1 : 0;
+                if (index % 2 == 0)
+                {
+                    T *rowTile = at(kb, other);
+                    relax(rowTile, pivot, rowTile, stride);
+                }
+                else
+                {
+                    T *columnTile = at(other, kb);
+                    relax(columnTile, columnTile, pivot, stride);
+                } });
+
+            // Every other tile only depends on its row's and column's tiles from the step above
+            forEach(pool, threads, (tiles - 1) * (tiles - 1), [&](size_t index)
+                    {
+                size_t row = index / (tiles - 1);
+                size_t col = index % (tiles - 1);
+                row += row >= kb ? 1 : 0;
+                col += col >= kb ? 1 : 0;
+                relax(at(row, col), at(row, kb), at(kb, col), stride); });
+        }
+    }
+
+    // Per-row summaries, reduced into APSPStats afterwards
+    struct RowSummary
+    {
+        long long eccentricity = 0;
+        int farthest = -1;
+        long long reachable = 0;
+        double sum = 0.0;
+    };
+
+    template <typename T>
+    void summarizeRows(const std::vector<T> &distances, size_t stride, size_t n, WorkerPool *pool, size_t threads,
+                       std::vector<RowSummary> &rows)
+    {
+        rows.assign(n, RowSummary());
+        const size_t tile = APSPEngine::tileSize;
+        forEach(pool, threads, (n + tile - 1) / tile, [&](size_t block)
+                {
+            for (size_t i = block * tile; i < std::min(n, (block + 1) * tile); ++i)
+            {
+                const T *row = distances.data() + i * stride;
+                RowSummary &summary = rows[i];
+                for (size_t j = 0; j < n; ++j)
+                {
+                    if (j == i || row[j] >= unreachable<T>())
+                    {
+                        continue;
+                    }
+                    ++summary.reachable;
+                    summary.sum += static_cast<double>(row[j]);
+                    if (summary.farthest < 0 || row[j] > summary.eccentricity)
+                    {
+                        summary.eccentricity = row[j];
+                        summary.farthest = static_cast<int>(j);
+                    }
+                }
+            } });
+    }
+
+    // Builds the padded adjacency matrix and runs the blocked algorithm with the chosen kernel
+    template <typename T>
+    void solve(const Graph &graph, const std::vector<int> &ids, size_t stride, bool avx2, WorkerPool *pool, size_t threads,
+               std::vector<T> &distances, std::vector<RowSummary> &rows)
+    {
+        distances.assign(stride * stride, unreachable<T>());
+        for (size_t i = 0; i < stride; ++i)
+        {
+            distances[i * stride + i] = 0;
+        }
+        std::unordered_map<int, size_t> indexOf;
+        indexOf.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            indexOf[ids[i]] = i;
+        }
+        for (size_t i = 0; i < ids.size(); ++i)
+        {
+            for (const Edge &edge : graph.getAdjacentEdges(ids[i]))
+            {
+                auto destination = indexOf.find(edge.destination);
+                if (destination == indexOf.end())
+                {
+                    throw std::invalid_argument("Edge " + std::to_string(ids[i]) + " - " + std::to_string(edge.destination) +
+                                                " leads to vertex " + std::to_string(edge.destination) +
+                                                ", which is not in the graph");
+                }
+                size_t j = destination->second;
+                if (j != i)
+                {
+                    T &entry = distances[i * stride + j];
+                    entry = std::min<T>(entry, edge.weight);
+                }
+            }
+        }
+
+        void (*relax)(T *, const T *, const T *, size_t) = relaxScalar<T>;
+#ifdef APSP_AVX2
+        if (avx2)
+        {
+            relax = relaxAvx2;
+        }
+#else
+        (void)avx2;
+#endif
+        blockedFloydWarshall(distances, stride, pool, threads, relax);
+        summarizeRows(distances, stride, ids.size(), pool, threads, rows);
+    }
+}
+
+// Constructor: remembers how many threads of the pool run() may use
+APSPEngine::APSPEngine(WorkerPool *workers, size_t threads)
+    : pool(workers), threadCount(workers ? workers->getThreadCount() : 1)
+{
+    if (threads > 0)
+    {
+        threadCount = std::min(threadCount, threads);
+    }
+}
+
+void APSPEngine::run(const Graph &graph)
+{
+    auto started = std::chrono::steady_clock::now();
+    vertexIds = graph.getVertexIds();
+    size_t n = vertexIds.size();
+    if (n > static_cast<size_t>(maxVertices))
+    {
+        throw std::invalid_argument("Graph has " + std::to_string(n) + " vertices; all-pairs distances are limited to " +
+                                    std::to_string(maxVertices));
+    }
+
+    // The longest shortest path has at most n - 1 edges, which decides the element width
+    long long heaviest = 0;
+    for (int id : vertexIds)
+    {
+        for (const Edge &edge : graph.getAdjacentEdges(id))
+        {
+            if (edge.weight < 0)
+            {
+                throw std::invalid_argument("Edge " + std::to_string(edge.source) + " - " + std::to_string(edge.destination) +
+                                            " has a negative weight, so shortest paths are undefined");
+            }
+            heaviest = std::max<long long>(heaviest, edge.weight);
+        }
+    }
+    long long longestPath = heaviest * static_cast<long long>(n > 0 ? n - 1 : 0);
+    wide = longestPath >= unreachable<int32_t>();
+
+    stride = std::max<size_t>(1, (n + tileSize - 1) / tileSize) * tileSize;
+    size_t tiles = stride / tileSize;
+    size_t threads = std::min(threadCount, tiles * tiles);
+    bool avx2 = std::strcmp(WeightKernels::getImplementation(), "avx2") == 0;
+
+    std::vector<RowSummary> rows;
+    if (wide)
+    {
+        narrowDistances = std::vector<int32_t>();
+        solve(graph, vertexIds, stride, avx2, pool, threads, wideDistances, rows);
+    }
+    else
+    {
+        wideDistances = std::vector<int64_t>();
+        solve(graph, vertexIds, stride, avx2, pool, threads, narrowDistances, rows);
+    }
+
+    stats = APSPStats();
+    stats.vertices = static_cast<int>(n);
+    stats.edges = graph.getEdges();
+    stats.distanceBits = wide ? 64 : 32;
+    stats.kernel = avx2 ? "avx2" : "scalar";
+    stats.threads = threads;
+    double sum = 0.0;
+    long long reachable = 0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const RowSummary &row = rows[i];
+        reachable += row.reachable;
+        sum += row.sum;
+        if (row.reachable == 0)
+        {
+            continue;
+        }
+        if (stats.diameterFrom < 0 || row.eccentricity > stats.diameter)
+        {
+            stats.diameter = row.eccentricity;
+            stats.diameterFrom = vertexIds[i];
+            stats.diameterTo = vertexIds[row.farthest];
+        }
+        if (stats.center < 0 || row.eccentricity < stats.radius)
+        {
+            stats.radius = row.eccentricity;
+            stats.center = vertexIds[i];
+        }
+    }
+    // Every reachable pair was counted from both ends
+    stats.reachablePairs = reachable / 2;
+    stats.unreachablePairs = static_cast<long long>(n) * (static_cast<long long>(n) - 1) / 2 - stats.reachablePairs;
+    stats.averageDistance = stats.reachablePairs > 0 ? sum / 2 / stats.reachablePairs : 0.0;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+
+long long APSPEngine::at(size_t i, size_t j) const
+{
+    if (wide)
+    {
+        int64_t value = wideDistances[i * stride + j];
+        return value >= unreachable<int64_t>() ? -1 : value;
+    }
+    int32_t value = narrowDistances[i * stride + j];
+    return value >= unreachable<int32_t>() ? -1 : value;
+}
+
+long long APSPEngine::getDistance(int source, int destination) const
+{
+    auto from = std::lower_bound(vertexIds.begin(), vertexIds.end(), source);
+    auto to = std::lower_bound(vertexIds.begin(), vertexIds.end(), destination);
+    if (from == vertexIds.end() || *from != source || to == vertexIds.end() || *to != destination)
+    {
+        throw std::out_of_range("Vertex does not exist");
+    }
+    return at(static_cast<size_t>(from - vertexIds.begin()), static_cast<size_t>(to - vertexIds.begin()));
+}
+
+APSPStats APSPEngine::getStats() const
+{
+    return stats;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "Graph.hpp"
+#include "WorkerPool.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Summary of all shortest-path distances of a graph. Pairs are unordered; distances between
+// vertices in different components are ignored, so eccentricities are taken within each component.
+struct APSPStats
+{
+    int vertices = 0;
+    int edges = 0;
+    long long reachablePairs = 0;
+    long long unreachablePairs = 0;
+    long long diameter = 0;        // Largest finite distance
+    int diameterFrom = -1, diameterTo = -1;
+    long long radius = 0;          // Smallest eccentricity of a vertex that reaches any other vertex
+    int center = -1;               // Smallest vertex ID with that eccentricity
+    double averageDistance = 0.0;  // Mean over the reachable pairs
+    int distanceBits = 32;         // Width of the matrix elements
+    const char *kernel = "scalar"; // Min-plus implementation that ran
+    size_t threads = 1;
+    double milliseconds = 0.0;
+};
+
+// All-pairs shortest paths on the whole graph (not just its MST) for up to a few thousand vertices.
+//
+// The distances live in one flat row-major matrix padded to whole tiles. Floyd-Warshall runs blocked:
+// for every block of intermediate vertices the diagonal tile is relaxed first, then the tiles in its
+// row and column, then all other tiles. Tiles are small enough to stay in cache, and the tiles of the
+// last two phases are independent, so they are spread over a few threads. The inner min-plus loop uses
+// AVX2 when WeightKernels does.
+//
+// Elements are 32-bit when no shortest path can exceed half the int32 range, and 64-bit otherwise.
+// "Unreachable" is half the element range, so adding any two entries never overflows and sums that
+// pass it never beat it. Negative weights are rejected: in an undirected graph a negative edge is
+// already a negative cycle.
+class APSPEngine
+{
+public:
+    static const int maxVertices = 10000;
+    static const size_t tileSize = 64;
+
+    // Runs on at most threads threads of pool (0 = all of them; no pool = one thread)
+    explicit APSPEngine(WorkerPool *pool = nullptr, size_t threads = 0);
+
+    // Computes all distances of graph; throws std::invalid_argument for oversized graphs, negative weights
+    // or an edge to a vertex the graph does not list
+    void run(const Graph &graph);
+    // Distance between two vertex IDs after run(), or -1 if there is no path
+    long long getDistance(int source, int destination) const;
+    APSPStats getStats() const;
+
+private:
+    WorkerPool *pool; // Shared with other queries
+    size_t threadCount;
+    std::vector<int> vertexIds; // Sorted; matrix row/column i belongs to vertexIds[i]
+    size_t stride = 0;          // Padded row length
+    bool wide = false;
+    std::vector<int32_t> narrowDistances;
+    std::vector<int64_t> wideDistances;
+    APSPStats stats;
+
+    long long at(size_t i, size_t j) const;
+};
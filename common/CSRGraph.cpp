@@ -0,0 +1,71 @@
+// This file implements CSRGraph, the adjacency-array snapshot used by the shortest path engine.
+
+#include "CSRGraph.hpp"
+#include "CancellationToken.hpp"
+#include <algorithm>
+#include <climits>
+#include <numeric>
+#include <unordered_map>
+
+// Constructor: renumbers the vertices, counts the arcs per vertex, then fills each vertex's slice
+CSRGraph::CSRGraph(const Graph &graph) : vertexIds(graph.getVertexIds())
+{
+    std::sort(vertexIds.begin(), vertexIds.end());
+    size_t n = vertexIds.size();
+    std::unordered_map<int, int> indexById;
+    indexById.reserve(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        indexById[vertexIds[i]] = static_cast<int>(i);
+    }
+
+    offsets.assign(n + 1, 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        offsets[i + 1] = offsets[i] + graph.getAdjacentEdges(vertexIds[i]).size();
+    }
+    targets.resize(offsets[n]);
+    weights.resize(offsets[n]);
+
+    minWeight = INT_MAX;
+    maxWeight = INT_MIN;
+    std::vector<size_t> order;
+    for (size_t i = 0; i < n; ++i)
+    {
+        CancellationToken::checkpoint(i);
+        const std::vector<Edge> &edges = graph.getAdjacentEdges(vertexIds[i]);
+        order.resize(edges.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&edges](size_t a, size_t b)
+                         { return edges[a].weight < edges[b].weight; });
+        size_t arc = offsets[i];
+        for (size_t k : order)
+        {
+            targets[arc] = indexById.at(edges[k].destination);
+            weights[arc] = edges[k].weight;
+            minWeight = std::min(minWeight, edges[k].weight);
+            maxWeight = std::max(maxWeight, edges[k].weight);
+            ++arc;
+        }
+    }
+    if (targets.empty())
+    {
+        minWeight = maxWeight = 0;
+    }
+}
+
+long long CSRGraph::indexOf(int id) const
+{
+    auto it = std::lower_bound(vertexIds.begin(), vertexIds.end(), id);
+    return it != vertexIds.end() && *it == id ? it - vertexIds.begin() : -1;
+}
+
+// Binary search over the weight-sorted slice of the vertex
+size_t CSRGraph::lightEnd(size_t index, long long bound) const
+{
+    auto first = weights.begin() + static_cast<std::ptrdiff_t>(offsets[index]);
+    auto last = weights.begin() + static_cast<std::ptrdiff_t>(offsets[index + 1]);
+    return static_cast<size_t>(std::upper_bound(first, last, bound, [](long long value, int weight)
+                                                { return value < weight; }) -
+                               weights.begin());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstddef>
+#include <vector>
+
+// An immutable compressed sparse row (CSR) copy of a Graph. Vertices are renumbered 0..n-1 in
+// ascending ID order, and the arcs of vertex i are targets[offsets[i]] .. targets[offsets[i + 1] - 1]
+// with the matching weights. Every undirected edge appears once in each direction.
+//
+// Each vertex's arcs are sorted by weight, so the arcs up to a weight bound are a prefix (see lightEnd).
+class CSRGraph
+{
+public:
+    explicit CSRGraph(const Graph &graph);
+
+    size_t getVertexCount() const { return vertexIds.size(); }
+    size_t getArcCount() const { return targets.size(); }
+    int getId(size_t index) const { return vertexIds[index]; }
+    // Index of a vertex ID, or -1 if the graph has no such vertex
+    long long indexOf(int id) const;
+    int getMinWeight() const { return minWeight; }
+    int getMaxWeight() const { return maxWeight; }
+
+    size_t begin(size_t index) const { return offsets[index]; }
+    size_t end(size_t index) const { return offsets[index + 1]; }
+    int getTarget(size_t arc) const { return targets[arc]; }
+    int getWeight(size_t arc) const { return weights[arc]; }
+    // First arc of index whose weight exceeds bound (end(index) if none does)
+    size_t lightEnd(size_t index, long long bound) const;
+
+private:
+    std::vector<int> vertexIds;
+    std::vector<size_t> offsets;
+    std::vector<int> targets;
+    std::vector<int> weights;
+    int minWeight = 0;
+    int maxWeight = 0;
+};
@@ -0,0 +1,53 @@
+// This file implements CancellationToken.
+
+#include "CancellationToken.hpp"
+
+thread_local std::shared_ptr<const CancellationToken> CancellationToken::currentToken;
+
+CancellationToken::CancellationToken(std::shared_ptr<const CancellationToken> p, Clock::time_point d)
+    : parent(std::move(p)), deadline(d), cancelled(false) {}
+
+bool CancellationToken::isCancelled() const
+{
+    return cancelled.load(std::memory_order_acquire) || (parent && parent->isCancelled());
+}
+
+bool CancellationToken::isExpired() const
+{
+    return (deadline != Clock::time_point::max() && Clock::now() >= deadline) || (parent && parent->isExpired());
+}
+
+void CancellationToken::check() const
+{
+    if (isCancelled())
+    {
+        throw OperationCancelled("Request cancelled");
+    }
+    if (isExpired())
+    {
+        throw OperationCancelled("Request deadline exceeded");
+    }
+}
+
+std::function<void()> CancellationToken::bind(std::function<void()> task)
+{
+    if (!currentToken)
+    {
+        return task;
+    }
+    return [token = currentToken, task = std::move(task)]()
+    {
+        Scope scope(token);
+        task();
+    };
+}
+
+CancellationToken::Scope::Scope(std::shared_ptr<const CancellationToken> token) : previous(std::move(currentToken))
+{
+    currentToken = std::move(token);
+}
+
+CancellationToken::Scope::~Scope()
+{
+    currentToken = std::move(previous);
+}
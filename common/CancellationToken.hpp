@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+// Thrown from a checkpoint when the work's request was cancelled or ran past its deadline
+class OperationCancelled : public std::runtime_error
+{
+public:
+    explicit OperationCancelled(const std::string &reason) : std::runtime_error(reason) {}
+};
+
+// Cooperative cancellation for long-running work. A token is cancelled explicitly (e.g. when the
+// client disconnects), when its parent is cancelled, or implicitly once its deadline passes.
+//
+// Algorithms do not take a token parameter: the token of the request being served rides along in a
+// thread-local (installed by Scope and carried across pipeline stages by bind), and loops call
+// checkpoint() every so often. Without a current token a checkpoint costs one thread-local read.
+class CancellationToken
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit CancellationToken(std::shared_ptr<const CancellationToken> parent = nullptr,
+                               Clock::time_point deadline = Clock::time_point::max());
+
+    void cancel() { cancelled.store(true, std::memory_order_release); }
+    bool isCancelled() const;
+    bool isExpired() const;
+    Clock::time_point getDeadline() const { return deadline; }
+    // Throws OperationCancelled if the token is cancelled or expired
+    void check() const;
+
+    // The token of the work running on this thread, or null
+    static const std::shared_ptr<const CancellationToken> &current() { return currentToken; }
+    // Checks the current token, if any
+    static void checkpoint()
+    {
+        if (currentToken)
+        {
+            currentToken->check();
+        }
+    }
+    // For hot loops: checks only when the iteration count is a multiple of checkInterval
+    static void checkpoint(size_t iteration)
+    {
+        if ((iteration & (checkInterval - 1)) == 0)
+        {
+            checkpoint();
+        }
+    }
+    static const size_t checkInterval = 1024;
+    // Wraps a task so it runs under the current token, wherever it is executed
+    static std::function<void()> bind(std::function<void()> task);
+
+    // Makes a token current on this thread until the scope ends
+    class Scope
+    {
+    public:
+        explicit Scope(std::shared_ptr<const CancellationToken> token);
+        ~Scope();
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+    private:
+        std::shared_ptr<const CancellationToken> previous;
+    };
+
+private:
+    std::shared_ptr<const CancellationToken> parent;
+    Clock::time_point deadline;
+    std::atomic<bool> cancelled;
+
+    static thread_local std::shared_ptr<const CancellationToken> currentToken;
+};
@@ -0,0 +1,70 @@
+// This file implements EdgeColumns, the column-wise edge list used by Kruskal's algorithm.
+
+#include "EdgeColumns.hpp"
+#include "WeightKernels.hpp"
+#include <algorithm>
+#include <numeric>
+
+void EdgeColumns::reserve(size_t count)
+{
+    sources.reserve(count);
+    destinations.reserve(count);
+    weights.reserve(count);
+}
+
+void EdgeColumns::push(const Edge &edge)
+{
+    sources.push_back(edge.source);
+    destinations.push_back(edge.destination);
+    weights.push_back(edge.weight);
+}
+
+// Builds the permutation that sorts the weights stably, then applies it to all three columns
+void EdgeColumns::sortByWeight()
+{
+    size_t count = size();
+    if (count < 2)
+    {
+        return;
+    }
+
+    std::vector<size_t> order(count);
+    WeightKernels::Summary summary = WeightKernels::summarize(weights.data(), count);
+    unsigned long long range = static_cast<unsigned long long>(static_cast<long long>(summary.max) - summary.min) + 1;
+    if (range <= count + countingSortSlack)
+    {
+        // Counting sort: one bucket per weight value, prefix sums give each bucket's first slot
+        std::vector<int> counts(range, 0);
+        WeightKernels::histogram(weights.data(), count, summary.min, 1.0, counts);
+        std::vector<size_t> next(range);
+        size_t position = 0;
+        for (size_t bucket = 0; bucket < range; ++bucket)
+        {
+            next[bucket] = position;
+            position += static_cast<size_t>(counts[bucket]);
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            order[next[static_cast<size_t>(static_cast<long long>(weights[i]) - summary.min)]++] = i;
+        }
+    }
+    else
+    {
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b)
+                         { return weights[a] < weights[b]; });
+    }
+
+    auto permute = [&order, count](std::vector<int> &column)
+    {
+        std::vector<int> sorted(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            sorted[i] = column[order[i]];
+        }
+        column.swap(sorted);
+    };
+    permute(sources);
+    permute(destinations);
+    permute(weights);
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstddef>
+#include <vector>
+
+// An edge list stored column by column (structure of arrays): sources, destinations and weights each
+// live in their own contiguous array, so a pass over the weights reads nothing else and vectorizes
+// (see WeightKernels).
+struct EdgeColumns
+{
+    std::vector<int> sources;
+    std::vector<int> destinations;
+    std::vector<int> weights;
+
+    size_t size() const { return weights.size(); }
+    void reserve(size_t count);
+    void push(const Edge &edge);
+    Edge get(size_t i) const { return Edge(sources[i], destinations[i], weights[i]); }
+
+    // Reorders the edges by ascending weight, keeping equal weights in their current order. Uses a
+    // counting sort when the weight range is not much larger than the edge count, a comparison sort otherwise.
+    void sortByWeight();
+
+private:
+    static const size_t countingSortSlack = 1 << 16; // Extra buckets allowed beyond one per edge
+};
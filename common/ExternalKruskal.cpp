@@ -0,0 +1,394 @@
+// This file implements ExternalKruskal, a semi-external minimum spanning forest.
+//
+// Pass 1 reads the edge file in chunks of memoryBudget bytes, sorts each chunk by weight and writes it
+// out as a run. Merge passes combine up to getMaxFanIn() runs at a time with a heap until few enough
+// remain; the last merge streams straight into a disjoint set instead of writing another file.
+// Peak memory is one chunk (or the merge buffers) plus the O(V) disjoint set.
+
+#include "ExternalKruskal.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <unistd.h>
+
+const char ExternalKruskal::fileMagic[8] = {'M', 'S', 'T', 'E', 'D', 'G', 'E', '1'};
+
+namespace
+{
+    // Bytes of read-ahead per run while merging
+    const size_t streamBufferBytes = 1 << 20;
+
+    // Kruskal order; ties are broken by endpoints so every run is deterministic
+    bool recordLess(const EdgeRecord &a, const EdgeRecord &b)
+    {
+        if (a.weight != b.weight)
+        {
+            return a.weight < b.weight;
+        }
+        if (a.source != b.source)
+        {
+            return a.source < b.source;
+        }
+        return a.destination < b.destination;
+    }
+
+    // Reads records from a file through a fixed-size buffer
+    class RecordReader
+    {
+    public:
+        RecordReader(const std::string &path, size_t bufferRecords, bool expectMagic)
+            : in(path, std::ios::binary), buffer(std::max<size_t>(1, bufferRecords)), count(0), pos(0)
+        {
+            if (!in)
+            {
+                throw std::runtime_error("Cannot open edge file: " + path);
+            }
+            if (expectMagic)
+            {
+                char magic[sizeof(ExternalKruskal::fileMagic)];
+                if (!in.read(magic, sizeof(magic)) ||
+                    std::memcmp(magic, ExternalKruskal::fileMagic, sizeof(magic)) != 0)
+                {
+                    throw std::runtime_error("Not an edge file: " + path);
+                }
+            }
+        }
+
+        // Fills chunk with up to chunk.size() records; returns how many were read
+        size_t readChunk(std::vector<EdgeRecord> &chunk)
+        {
+            in.read(reinterpret_cast<char *>(chunk.data()), chunk.size() * sizeof(EdgeRecord));
+            size_t bytes = static_cast<size_t>(in.gcount());
+            if (bytes % sizeof(EdgeRecord) != 0)
+            {
+                throw std::runtime_error("Edge file is truncated");
+            }
+            return bytes / sizeof(EdgeRecord);
+        }
+
+        // Appends up to limit records to out, one buffer at a time; returns how many were added
+        size_t appendTo(std::vector<EdgeRecord> &out, size_t limit)
+        {
+            size_t added = 0;
+            while (added < limit)
+            {
+                if (pos == count)
+                {
+                    count = readChunk(buffer);
+                    pos = 0;
+                    if (count == 0)
+                    {
+                        break;
+                    }
+                }
+                size_t take = std::min(count - pos, limit - added);
+                out.insert(out.end(), buffer.begin() + static_cast<std::ptrdiff_t>(pos),
+                           buffer.begin() + static_cast<std::ptrdiff_t>(pos + take));
+                pos += take;
+                added += take;
+            }
+            return added;
+        }
+
+        bool next(EdgeRecord &record)
+        {
+            if (pos == count)
+            {
+                count = readChunk(buffer);
+                pos = 0;
+                if (count == 0)
+                {
+                    return false;
+                }
+            }
+            record = buffer[pos++];
+            return true;
+        }
+
+    private:
+        std::ifstream in;
+        std::vector<EdgeRecord> buffer;
+        size_t count;
+        size_t pos;
+    };
+
+    // Writes records to a file, failing loudly (e.g. on a full disk) instead of producing a short run
+    void writeRecords(std::ofstream &out, const EdgeRecord *records, size_t count, const std::string &path)
+    {
+        out.write(reinterpret_cast<const char *>(records), count * sizeof(EdgeRecord));
+        if (!out)
+        {
+            throw std::runtime_error("Failed to write " + path);
+        }
+    }
+}
+
+// memoryBudget bounds the edge buffers; tempDirectory receives the sorted runs
+ExternalKruskal::ExternalKruskal(size_t budget, const std::string &directory)
+    : memoryBudget(std::max<size_t>(budget, 4 * streamBufferBytes)), tempDirectory(directory.empty() ? "." : directory) {}
+
+// Writes the graph in edge file format; each undirected edge is emitted once and self-loops are skipped
+uint64_t ExternalKruskal::writeEdgeFile(const Graph &graph, const std::string &path)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("Cannot create edge file: " + path);
+    }
+    out.write(fileMagic, sizeof(fileMagic));
+
+    std::vector<EdgeRecord> records;
+    uint64_t written = 0;
+    for (int u : graph.getVertexIds())
+    {
+        for (const Edge &edge : graph.getAdjacentEdges(u))
+        {
+            if (edge.destination > u)
+            {
+                records.push_back({edge.source, edge.destination, edge.weight});
+            }
+        }
+        if (records.size() >= streamBufferBytes / sizeof(EdgeRecord))
+        {
+            writeRecords(out, records.data(), records.size(), path);
+            written += records.size();
+            records.clear();
+        }
+    }
+    writeRecords(out, records.data(), records.size(), path);
+    written += records.size();
+    out.close();
+    if (!out)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
+    return written;
+}
+
+// Returns a fresh path for a temporary run and remembers it for cleanup
+std::string ExternalKruskal::newRunPath()
+{
+    static std::atomic<uint64_t> runCounter(0);
+    std::string path = tempDirectory + "/kruskal." + std::to_string(getpid()) + "." +
+                       std::to_string(runCounter++) + ".run";
+    tempFiles.push_back(path);
+    return path;
+}
+
+// Deletes every run created by this instance
+void ExternalKruskal::removeTempFiles()
+{
+    for (const std::string &path : tempFiles)
+    {
+        std::remove(path.c_str());
+    }
+    tempFiles.clear();
+}
+
+// How many runs one merge can read at once without exceeding the memory budget
+size_t ExternalKruskal::getMaxFanIn() const
+{
+    return std::max<size_t>(2, memoryBudget / streamBufferBytes - 1);
+}
+
+// Pass 1: split the input into sorted runs of at most memoryBudget bytes each.
+// Also records which vertex IDs occur so the disjoint set can be sized and the final merge can stop early.
+std::vector<std::string> ExternalKruskal::createRuns(const std::string &edgeFile, Stats &stats, std::vector<bool> &seen)
+{
+    // The run buffer never exceeds the file, so a small file does not claim the whole budget
+    std::error_code error;
+    uintmax_t fileBytes = std::filesystem::file_size(edgeFile, error);
+    size_t runBytes = memoryBudget - streamBufferBytes;
+    if (!error)
+    {
+        runBytes = static_cast<size_t>(std::min<uintmax_t>(runBytes, fileBytes));
+    }
+    size_t runRecords = std::max<size_t>(1, runBytes / sizeof(EdgeRecord));
+
+    RecordReader reader(edgeFile, streamBufferBytes / sizeof(EdgeRecord), true);
+    std::vector<EdgeRecord> chunk;
+    chunk.reserve(runRecords);
+    std::vector<std::string> runs;
+    size_t count;
+    while ((count = reader.appendTo(chunk, runRecords)) > 0)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const EdgeRecord &record = chunk[i];
+            if (record.source < 0 || record.destination < 0)
+            {
+                throw std::runtime_error("Edge file contains a negative vertex ID");
+            }
+            size_t highest = static_cast<size_t>(std::max(record.source, record.destination));
+            if (highest >= seen.size())
+            {
+                seen.resize(std::max(highest + 1, seen.size() * 2), false);
+            }
+            for (int32_t v : {record.source, record.destination})
+            {
+                if (!seen[v])
+                {
+                    seen[v] = true;
+                    ++stats.vertices;
+                }
+            }
+        }
+        stats.edgesRead += count;
+
+        std::sort(chunk.begin(), chunk.begin() + count, recordLess);
+        std::string path = newRunPath();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        writeRecords(out, chunk.data(), count, path);
+        runs.push_back(path);
+        chunk.clear();
+    }
+    stats.runs = runs.size();
+    return runs;
+}
+
+// Streams the records of runs[first, last) in Kruskal order until consume returns false
+void ExternalKruskal::forEachMerged(const std::vector<std::string> &runs, size_t first, size_t last,
+                                   const std::function<bool(const EdgeRecord &)> &consume)
+{
+    size_t fanIn = last - first;
+    size_t bufferRecords = std::min(streamBufferBytes, memoryBudget / (fanIn + 1)) / sizeof(EdgeRecord);
+    std::vector<std::unique_ptr<RecordReader>> readers;
+    for (size_t i = first; i < last; ++i)
+    {
+        readers.push_back(std::make_unique<RecordReader>(runs[i], bufferRecords, false));
+    }
+
+    // Min-heap of the current head of every run
+    using Head = std::pair<EdgeRecord, size_t>;
+    auto greater = [](const Head &a, const Head &b)
+    { return recordLess(b.first, a.first); };
+    std::priority_queue<Head, std::vector<Head>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < readers.size(); ++i)
+    {
+        EdgeRecord record;
+        if (readers[i]->next(record))
+        {
+            heap.emplace(record, i);
+        }
+    }
+
+    while (!heap.empty())
+    {
+        Head head = heap.top();
+        heap.pop();
+        if (!consume(head.first))
+        {
+            return;
+        }
+        EdgeRecord record;
+        if (readers[head.second]->next(record))
+        {
+            heap.emplace(record, head.second);
+        }
+    }
+}
+
+// Merges runs[first, last) into a single new run and returns its path
+std::string ExternalKruskal::mergeRuns(const std::vector<std::string> &runs, size_t first, size_t last)
+{
+    std::string path = newRunPath();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    std::vector<EdgeRecord> pending;
+    pending.reserve(streamBufferBytes / sizeof(EdgeRecord));
+    forEachMerged(runs, first, last, [&](const EdgeRecord &record)
+                  {
+        pending.push_back(record);
+        if (pending.size() == pending.capacity())
+        {
+            writeRecords(out, pending.data(), pending.size(), path);
+            pending.clear();
+        }
+        return true; });
+    writeRecords(out, pending.data(), pending.size(), path);
+    return path;
+}
+
+// Runs the whole external algorithm; temporary runs are removed even if it fails
+ExternalKruskal::Stats ExternalKruskal::run(const std::string &edgeFile,
+                                            const std::function<void(const Edge &)> &onForestEdge)
+{
+    Stats stats;
+    try
+    {
+        std::vector<bool> seen;
+        std::vector<std::string> runs = createRuns(edgeFile, stats, seen);
+
+        // Intermediate passes until one final merge can read every remaining run
+        size_t maxFanIn = getMaxFanIn();
+        while (runs.size() > maxFanIn)
+        {
+            std::vector<std::string> merged;
+            for (size_t first = 0; first < runs.size(); first += maxFanIn)
+            {
+                size_t last = std::min(first + maxFanIn, runs.size());
+                merged.push_back(last - first == 1 ? runs[first] : mergeRuns(runs, first, last));
+                for (size_t i = first; last - first > 1 && i < last; ++i)
+                {
+                    std::remove(runs[i].c_str());
+                }
+            }
+            runs.swap(merged);
+            ++stats.mergePasses;
+        }
+
+        // Disjoint set over vertex IDs with union by size and path halving
+        std::vector<int32_t> parent(seen.size());
+        std::vector<int32_t> setSize(seen.size(), 1);
+        for (size_t i = 0; i < parent.size(); ++i)
+        {
+            parent[i] = static_cast<int32_t>(i);
+        }
+        auto find = [&parent](int32_t v)
+        {
+            while (parent[v] != v)
+            {
+                parent[v] = parent[parent[v]];
+                v = parent[v];
+            }
+            return v;
+        };
+
+        // Final pass: merge straight into Kruskal's main loop; a connected input stops after V - 1 edges
+        uint64_t target = stats.vertices == 0 ? 0 : stats.vertices - 1;
+        forEachMerged(runs, 0, runs.size(), [&](const EdgeRecord &record)
+                      {
+            if (stats.forestEdges == target)
+            {
+                return false;
+            }
+            int32_t rootX = find(record.source);
+            int32_t rootY = find(record.destination);
+            if (rootX != rootY)
+            {
+                if (setSize[rootX] < setSize[rootY])
+                {
+                    std::swap(rootX, rootY);
+                }
+                parent[rootY] = rootX;
+                setSize[rootX] += setSize[rootY];
+                ++stats.forestEdges;
+                stats.totalWeight += record.weight;
+                onForestEdge(Edge(record.source, record.destination, record.weight));
+            }
+            return true; });
+        ++stats.mergePasses;
+    }
+    catch (...)
+    {
+        removeTempFiles();
+        throw;
+    }
+    removeTempFiles();
+    return stats;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// One undirected edge as stored on disk: three native-endian 32-bit integers
+struct EdgeRecord
+{
+    int32_t source;
+    int32_t destination;
+    int32_t weight;
+};
+
+// Kruskal's algorithm for edge lists that do not fit in memory.
+// Edges are streamed from a binary edge file, sorted in memory-sized runs that are spilled to disk,
+// merged k ways at a time and fed to a disjoint set in weight order. Only the disjoint set is O(V);
+// everything proportional to the number of edges stays within the configured memory budget.
+class ExternalKruskal
+{
+public:
+    // Counters describing one external run
+    struct Stats
+    {
+        uint64_t edgesRead = 0;    // Records in the input file
+        uint64_t runs = 0;         // Sorted runs written in the first pass
+        int mergePasses = 0;       // Merge passes, including the final one that feeds the disjoint set
+        uint64_t vertices = 0;     // Distinct vertices that appear in at least one edge
+        uint64_t forestEdges = 0;  // Edges of the resulting minimum spanning forest
+        long long totalWeight = 0; // Sum of the forest edge weights
+    };
+
+    // Edge files start with this 8-byte tag, followed by EdgeRecords until the end of the file
+    static const char fileMagic[8];
+
+    ExternalKruskal(size_t memoryBudget, const std::string &tempDirectory);
+
+    // Writes every undirected edge of graph once; returns the number of records written
+    static uint64_t writeEdgeFile(const Graph &graph, const std::string &path);
+
+    // Computes the minimum spanning forest of the edges in edgeFile; onForestEdge receives each forest
+    // edge in ascending weight order as soon as it is accepted
+    Stats run(const std::string &edgeFile, const std::function<void(const Edge &)> &onForestEdge);
+
+private:
+    size_t memoryBudget;
+    std::string tempDirectory;
+    std::vector<std::string> tempFiles;
+
+    std::string newRunPath();
+    void removeTempFiles();
+    std::vector<std::string> createRuns(const std::string &edgeFile, Stats &stats, std::vector<bool> &seen);
+    std::string mergeRuns(const std::vector<std::string> &runs, size_t first, size_t last);
+    void forEachMerged(const std::vector<std::string> &runs, size_t first, size_t last,
+                       const std::function<bool(const EdgeRecord &)> &consume);
+    size_t getMaxFanIn() const;
+};
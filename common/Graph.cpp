@@ -135,9 +135,12 @@ bool Graph::changeWeight(int source, int destination, int newWeight)
     return true;
 }
 
-// Returns a vector of edges adjacent to a given vertex
-std::vector<Edge> Graph::getAdjacentEdges(int vertex) const
+// Returns the edges adjacent to a given vertex without copying them; the reference is valid until the
+// graph is modified
+const std::vector<Edge> &Graph::getAdjacentEdges(int vertex) const
 {
+    static const std::vector<Edge> noEdges;
+
     // Search for the given vertex in the adjacency list
     auto it = adjacencyList.find(vertex);
 
@@ -149,7 +152,7 @@ std::vector<Edge> Graph::getAdjacentEdges(int vertex) const
     }
 
     // If the vertex is not found, return an empty vector of edges
-    return std::vector<Edge>();
+    return noEdges;
 }
 
 // Returns the number of vertices in the graph
@@ -167,4 +170,77 @@ int Graph::getEdges() const
         count += pair.second.size();
     }
     return count / 2; // Each edge is counted twice
+}
+
+// Returns the IDs of all vertices in the graph in ascending order
+std::vector<int> Graph::getVertexIds() const
+{
+    std::vector<int> ids;
+    ids.reserve(adjacencyList.size());
+    for (const auto &pair : adjacencyList)
+    {
+        ids.push_back(pair.first);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+// Inserts a vertex with a specific ID (used when restoring a snapshot)
+bool Graph::insertVertex(int vertexId)
+{
+    if (vertexId < 0 || adjacencyList.find(vertexId) != adjacencyList.end())
+    {
+        return false;
+    }
+    adjacencyList[vertexId] = std::vector<Edge>();
+    reserveVertexIds(vertexId + 1);
+    return true;
+}
+
+// Returns the ID that the next call to addVertex will assign
+int Graph::getNextVertexId() const
+{
+    return nextVertexId;
+}
+
+// Makes sure addVertex never hands out an ID below nextId
+void Graph::reserveVertexIds(int nextId)
+{
+    nextVertexId = std::max(nextVertexId, nextId);
+}
+
+// Returns the subgraph induced by the given vertices, keeping their original IDs
+Graph Graph::getSubgraph(const std::vector<int> &vertices) const
+{
+    Graph subgraph;
+    for (int v : vertices)
+    {
+        subgraph.insertVertex(v);
+    }
+    for (int v : vertices)
+    {
+        auto it = adjacencyList.find(v);
+        if (it == adjacencyList.end())
+        {
+            continue;
+        }
+        bool skipLoop = false;
+        for (const Edge &edge : it->second)
+        {
+            // Add each undirected edge once: from its smaller endpoint, and every other copy of a self-loop
+            if (edge.destination == v)
+            {
+                if (!skipLoop)
+                {
+                    subgraph.addEdge(v, v, edge.weight);
+                }
+                skipLoop = !skipLoop;
+            }
+            else if (edge.destination > v && subgraph.adjacencyList.count(edge.destination))
+            {
+                subgraph.addEdge(v, edge.destination, edge.weight);
+            }
+        }
+    }
+    return subgraph;
 }
\ No newline at end of file
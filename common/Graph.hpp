@@ -24,9 +24,14 @@ public:
     bool removeEdge(int source, int destination);
     bool removeVertex(int vertex);
     bool changeWeight(int source, int destination, int newWeight);
-    std::vector<Edge> getAdjacentEdges(int vertex) const;
+    const std::vector<Edge> &getAdjacentEdges(int vertex) const;
     int getVertices() const;
     int getEdges() const;
+    std::vector<int> getVertexIds() const;
+    bool insertVertex(int vertexId);
+    int getNextVertexId() const;
+    void reserveVertexIds(int nextId);
+    Graph getSubgraph(const std::vector<int> &vertices) const;
     ~Graph();
 
 private:
@@ -0,0 +1,385 @@
+// This file implements the GraphGenerator class, which builds reproducible synthetic graphs.
+
+#include "GraphGenerator.hpp"
+#include "CancellationToken.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace
+{
+    // Seeded random source with platform-independent mappings of the engine output
+    class Random
+    {
+    public:
+        explicit Random(uint64_t seed) : engine(seed) {}
+
+        // Uniform integer in [0, n) by Lemire's multiply-and-reject: the high half of engine() * n,
+        // redrawn in the rare case the low half falls in the short, biased stretch that % n would keep
+        uint64_t below(uint64_t n)
+        {
+            unsigned __int128 product = static_cast<unsigned __int128>(engine()) * n;
+            if (static_cast<uint64_t>(product) < n)
+            {
+                uint64_t threshold = (0 - n) % n;
+                while (static_cast<uint64_t>(product) < threshold)
+                {
+                    product = static_cast<unsigned __int128>(engine()) * n;
+                }
+            }
+            return static_cast<uint64_t>(product >> 64);
+        }
+        // Uniform double in [0, 1)
+        double unit() { return static_cast<double>(engine() >> 11) * 0x1.0p-53; }
+        int weight(int minWeight, int maxWeight)
+        {
+            uint64_t range = static_cast<uint64_t>(static_cast<long long>(maxWeight) - minWeight) + 1;
+            return static_cast<int>(minWeight + static_cast<long long>(below(range)));
+        }
+
+    private:
+        std::mt19937_64 engine;
+    };
+
+    // Parses a whole word as an integer in [minimum, maximum]
+    long long parseInteger(const std::string &word, const std::string &what, long long minimum, long long maximum)
+    {
+        size_t used = 0;
+        long long value = 0;
+        try
+        {
+            value = std::stoll(word, &used);
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (used == 0 || used != word.size() || value < minimum || value > maximum)
+        {
+            throw std::invalid_argument("Invalid " + what + ": " + word);
+        }
+        return value;
+    }
+
+    double parseProbability(const std::string &word)
+    {
+        size_t used = 0;
+        double value = -1;
+        try
+        {
+            value = std::stod(word, &used);
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (used == 0 || used != word.size() || !(value >= 0 && value <= 1))
+        {
+            throw std::invalid_argument("Invalid edge probability: " + word + " (expected 0..1)");
+        }
+        return value;
+    }
+
+    uint64_t parseSeed(const std::string &word)
+    {
+        size_t used = 0;
+        uint64_t value = 0;
+        try
+        {
+            value = std::stoull(word, &used);
+        }
+        catch (const std::exception &)
+        {
+            used = 0;
+        }
+        if (used == 0 || used != word.size() || !std::isdigit(static_cast<unsigned char>(word[0])))
+        {
+            throw std::invalid_argument("Invalid seed: " + word);
+        }
+        return value;
+    }
+}
+
+std::string GraphGenerator::getUsage()
+{
+    return "random <n> <p> | grid <rows> <cols> | powerlaw <n> <m> | complete <n> | tree <n> [<extra edges>], "
+           "optionally followed by seed <s> and weights <min> <max>";
+}
+
+// Parses "<kind> <parameters...> [seed <s>] [weights <min> <max>]"
+GraphGenerator::Spec GraphGenerator::parse(const std::vector<std::string> &args)
+{
+    if (args.empty())
+    {
+        throw std::invalid_argument("Missing graph kind");
+    }
+    Spec spec;
+    spec.kind = args[0];
+    size_t next = 1;
+    // Returns the next parameter word or complains about the missing one
+    auto take = [&args, &next](const std::string &what) -> const std::string &
+    {
+        if (next >= args.size())
+        {
+            throw std::invalid_argument("Missing " + what);
+        }
+        return args[next++];
+    };
+
+    if (spec.kind == "random")
+    {
+        spec.vertices = static_cast<int>(parseInteger(take("vertex count"), "vertex count", 1, maxVertices));
+        spec.probability = parseProbability(take("edge probability"));
+    }
+    else if (spec.kind == "grid")
+    {
+        spec.rows = static_cast<int>(parseInteger(take("row count"), "row count", 1, maxVertices));
+        spec.cols = static_cast<int>(parseInteger(take("column count"), "column count", 1, maxVertices));
+        if (static_cast<long long>(spec.rows) * spec.cols > maxVertices)
+        {
+            throw std::invalid_argument("Grid has more than " + std::to_string(maxVertices) + " vertices");
+        }
+        spec.vertices = spec.rows * spec.cols;
+    }
+    else if (spec.kind == "powerlaw")
+    {
+        spec.vertices = static_cast<int>(parseInteger(take("vertex count"), "vertex count", 2, maxVertices));
+        spec.attachments = static_cast<int>(parseInteger(take("edges per vertex"), "edges per vertex", 1, spec.vertices - 1));
+    }
+    else if (spec.kind == "complete")
+    {
+        spec.vertices = static_cast<int>(parseInteger(take("vertex count"), "vertex count", 1, maxVertices));
+    }
+    else if (spec.kind == "tree")
+    {
+        spec.vertices = static_cast<int>(parseInteger(take("vertex count"), "vertex count", 1, maxVertices));
+        if (next < args.size() && args[next] != "seed" && args[next] != "weights")
+        {
+            long long n = spec.vertices;
+            spec.extraEdges = parseInteger(args[next++], "extra edge count", 0, n * (n - 1) / 2 - (n - 1));
+        }
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown graph kind: " + spec.kind);
+    }
+
+    while (next < args.size())
+    {
+        const std::string &option = args[next++];
+        if (option == "seed")
+        {
+            spec.seed = parseSeed(take("seed"));
+        }
+        else if (option == "weights")
+        {
+            spec.minWeight = static_cast<int>(parseInteger(take("minimum weight"), "minimum weight", INT32_MIN, INT32_MAX));
+            spec.maxWeight = static_cast<int>(parseInteger(take("maximum weight"), "maximum weight", spec.minWeight, INT32_MAX));
+        }
+        else
+        {
+            throw std::invalid_argument("Unexpected argument: " + option);
+        }
+    }
+
+    if (estimateEdges(spec) > maxEdges)
+    {
+        throw std::invalid_argument("Graph would have more than " + std::to_string(maxEdges) + " edges");
+    }
+    return spec;
+}
+
+// Number of edges the spec produces (the expected number for random graphs)
+long long GraphGenerator::estimateEdges(const Spec &spec)
+{
+    long long n = spec.vertices;
+    if (spec.kind == "random")
+    {
+        return static_cast<long long>(std::ceil(spec.probability * static_cast<double>(n * (n - 1) / 2)));
+    }
+    if (spec.kind == "grid")
+    {
+        return static_cast<long long>(spec.rows) * (spec.cols - 1) + static_cast<long long>(spec.cols) * (spec.rows - 1);
+    }
+    if (spec.kind == "powerlaw")
+    {
+        long long m = spec.attachments;
+        return m * (m + 1) / 2 + (n - m - 1) * m;
+    }
+    if (spec.kind == "complete")
+    {
+        return n * (n - 1) / 2;
+    }
+    return n - 1 + spec.extraEdges;
+}
+
+// Builds the graph described by spec
+Graph GraphGenerator::generate(const Spec &spec)
+{
+    Graph graph(spec.vertices);
+    Random random(spec.seed);
+    int n = spec.vertices;
+    size_t edgeCount = 0;
+    // Large graphs take a while, so generation stops once its request is cancelled
+    auto connect = [&graph, &random, &spec, &edgeCount](int u, int v)
+    {
+        CancellationToken::checkpoint(edgeCount++);
+        graph.addEdge(u, v, random.weight(spec.minWeight, spec.maxWeight));
+    };
+
+    if (spec.kind == "random")
+    {
+        // Erdős–Rényi G(n, p) by geometric skipping (Batagelj and Brandes): jumps straight to the next
+        // edge that is present, so the cost is proportional to the edges produced rather than to n^2
+        if (spec.probability >= 1)
+        {
+            for (int u = 0; u < n; ++u)
+            {
+                for (int v = u + 1; v < n; ++v)
+                {
+                    connect(u, v);
+                }
+            }
+        }
+        else if (spec.probability > 0)
+        {
+            double logMiss = std::log(1.0 - spec.probability);
+            long long v = 1, w = -1;
+            while (v < n)
+            {
+                w += 1 + static_cast<long long>(std::floor(std::log(1.0 - random.unit()) / logMiss));
+                while (w >= v && v < n)
+                {
+                    w -= v;
+                    ++v;
+                }
+                if (v < n)
+                {
+                    connect(static_cast<int>(w), static_cast<int>(v));
+                }
+            }
+        }
+    }
+    else if (spec.kind == "grid")
+    {
+        for (int r = 0; r < spec.rows; ++r)
+        {
+            for (int c = 0; c < spec.cols; ++c)
+            {
+                int vertex = r * spec.cols + c;
+                if (c + 1 < spec.cols)
+                {
+                    connect(vertex, vertex + 1);
+                }
+                if (r + 1 < spec.rows)
+                {
+                    connect(vertex, vertex + spec.cols);
+                }
+            }
+        }
+    }
+    else if (spec.kind == "powerlaw")
+    {
+        // Barabási–Albert preferential attachment: start from a clique of m + 1 vertices, then every new
+        // vertex links to m distinct earlier vertices picked with probability proportional to their degree.
+        // endpoints holds both ends of every edge, so a uniform pick from it is a degree-weighted pick.
+        int m = spec.attachments;
+        std::vector<int> endpoints;
+        endpoints.reserve(static_cast<size_t>(estimateEdges(spec)) * 2);
+        for (int u = 0; u <= m; ++u)
+        {
+            for (int v = u + 1; v <= m; ++v)
+            {
+                connect(u, v);
+                endpoints.push_back(u);
+                endpoints.push_back(v);
+            }
+        }
+        std::vector<char> picked(n, 0);
+        std::vector<int> targets;
+        for (int v = m + 1; v < n; ++v)
+        {
+            targets.clear();
+            while (static_cast<int>(targets.size()) < m)
+            {
+                int target = endpoints[random.below(endpoints.size())];
+                if (!picked[target])
+                {
+                    picked[target] = 1;
+                    targets.push_back(target);
+                }
+            }
+            for (int target : targets)
+            {
+                picked[target] = 0;
+                connect(target, v);
+                endpoints.push_back(target);
+                endpoints.push_back(v);
+            }
+        }
+    }
+    else if (spec.kind == "complete")
+    {
+        for (int u = 0; u < n; ++u)
+        {
+            for (int v = u + 1; v < n; ++v)
+            {
+                connect(u, v);
+            }
+        }
+    }
+    else if (spec.kind == "tree")
+    {
+        // Random recursive tree (each vertex hangs off a uniformly chosen earlier one), then distinct
+        // noise edges between random pairs that are not yet adjacent. When the noise takes more than
+        // half of the free pairs, the pairs left out are drawn instead and every other pair is connected,
+        // so the set of drawn pairs never holds more than half of them and draws rarely collide.
+        std::vector<int> parent(n, -1);
+        auto isTreeEdge = [&parent](int u, int v)
+        {
+            return parent[std::max(u, v)] == std::min(u, v);
+        };
+        auto key = [](int u, int v)
+        {
+            return (static_cast<uint64_t>(std::min(u, v)) << 32) | static_cast<uint32_t>(std::max(u, v));
+        };
+        for (int v = 1; v < n; ++v)
+        {
+            parent[v] = static_cast<int>(random.below(static_cast<uint64_t>(v)));
+            connect(parent[v], v);
+        }
+
+        long long freePairs = static_cast<long long>(n) * (n - 1) / 2 - (n - 1);
+        bool complement = spec.extraEdges > freePairs / 2;
+        long long draws = complement ? freePairs - spec.extraEdges : spec.extraEdges;
+        std::unordered_set<uint64_t> drawn;
+        drawn.reserve(static_cast<size_t>(draws));
+        while (static_cast<long long>(drawn.size()) < draws)
+        {
+            int u = static_cast<int>(random.below(static_cast<uint64_t>(n)));
+            int v = static_cast<int>(random.below(static_cast<uint64_t>(n)));
+            if (u != v && !isTreeEdge(u, v) && drawn.insert(key(u, v)).second && !complement)
+            {
+                connect(u, v);
+            }
+        }
+        for (int u = 0; complement && u < n; ++u)
+        {
+            for (int v = u + 1; v < n; ++v)
+            {
+                if (!isTreeEdge(u, v) && !drawn.count(key(u, v)))
+                {
+                    connect(u, v);
+                }
+            }
+        }
+    }
+    else
+    {
+        throw std::invalid_argument("Unknown graph kind: " + spec.kind);
+    }
+    return graph;
+}
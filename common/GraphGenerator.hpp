@@ -0,0 +1,39 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Builds synthetic graphs for benchmarks and load tests. Every generator is driven by a seeded
+// 64-bit Mersenne Twister and maps its output to numbers without the standard distributions (whose
+// results differ between standard libraries), so the same spec gives the same graph everywhere.
+// Vertices are numbered 0..n-1 and edge weights are uniform in [minWeight, maxWeight].
+class GraphGenerator
+{
+public:
+    // What to generate, as parsed from "<kind> <parameters...> [seed <s>] [weights <min> <max>]"
+    struct Spec
+    {
+        std::string kind;          // random, grid, powerlaw, complete or tree
+        int vertices = 0;          // Vertex count (rows * cols for grids)
+        int rows = 0, cols = 0;    // Grid dimensions
+        double probability = 0;    // Edge probability of a random (Erdős–Rényi) graph
+        int attachments = 0;       // Edges each new vertex brings into a power-law graph
+        long long extraEdges = 0;  // Noise edges added on top of a random tree
+        uint64_t seed = 1;
+        int minWeight = 1, maxWeight = 100;
+    };
+
+    // Refuses specs that would build more than this many vertices or edges
+    static const int maxVertices = 10000000;
+    static const long long maxEdges = 50000000;
+
+    // Parses a spec from its words; throws std::invalid_argument with the reason
+    static Spec parse(const std::vector<std::string> &args);
+    static std::string getUsage();
+
+    static Graph generate(const Spec &spec);
+
+private:
+    static long long estimateEdges(const Spec &spec);
+};
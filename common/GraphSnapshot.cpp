@@ -0,0 +1,236 @@
+// This file implements the GraphSnapshot class, which saves and restores complete graphs.
+//
+// Format (whitespace separated, one record per line):
+//   graph_snapshot 1
+//   lsn <last log sequence number included>
+//   next_vertex <id the next add_vertex will get>
+//   vertices <count>    followed by <count> vertex IDs
+//   edges <count>       followed by <count> "<source> <destination> <weight>" lines
+
+#include "GraphSnapshot.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace
+{
+    // Parses the next integer starting at pos, skipping leading whitespace
+    bool nextNumber(const char *&pos, const char *end, long long &value)
+    {
+        while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\t' || *pos == '\r'))
+        {
+            ++pos;
+        }
+        if (pos == end)
+        {
+            return false;
+        }
+        char *stop = nullptr;
+        errno = 0;
+        value = std::strtoll(pos, &stop, 10);
+        if (stop == pos || errno != 0)
+        {
+            return false;
+        }
+        pos = stop;
+        return true;
+    }
+
+    // Checks that the next word matches the expected keyword
+    bool expectWord(const char *&pos, const char *end, const char *word)
+    {
+        while (pos < end && (*pos == ' ' || *pos == '\n' || *pos == '\t' || *pos == '\r'))
+        {
+            ++pos;
+        }
+        size_t len = std::strlen(word);
+        if (static_cast<size_t>(end - pos) < len || std::strncmp(pos, word, len) != 0)
+        {
+            return false;
+        }
+        pos += len;
+        return true;
+    }
+}
+
+// Writes the graph to the stream. Each undirected edge is emitted once.
+void GraphSnapshot::write(const Graph &graph, std::ostream &out, uint64_t lsn)
+{
+    std::vector<int> ids = graph.getVertexIds();
+
+    // Collect every edge once: source < destination, and every other copy of a self-loop
+    std::vector<Edge> edges;
+    for (int u : ids)
+    {
+        bool skipLoop = false;
+        for (const Edge &edge : graph.getAdjacentEdges(u))
+        {
+            if (edge.destination > u)
+            {
+                edges.push_back(edge);
+            }
+            else if (edge.destination == u)
+            {
+                if (!skipLoop)
+                {
+                    edges.push_back(edge);
+                }
+                skipLoop = !skipLoop;
+            }
+        }
+    }
+
+    out << "graph_snapshot 1\n";
+    out << "lsn " << lsn << "\n";
+    out << "next_vertex " << graph.getNextVertexId() << "\n";
+    out << "vertices " << ids.size() << "\n";
+    for (int id : ids)
+    {
+        out << id << "\n";
+    }
+    out << "edges " << edges.size() << "\n";
+    for (const Edge &edge : edges)
+    {
+        out << edge.source << " " << edge.destination << " " << edge.weight << "\n";
+    }
+}
+
+// Parses a snapshot held in memory. Uses strtoll directly so large snapshots load quickly.
+bool GraphSnapshot::parse(const std::string &data, Graph &graph, uint64_t &lsn)
+{
+    const char *pos = data.data();
+    const char *end = pos + data.size();
+    long long version, value, count;
+
+    if (!expectWord(pos, end, "graph_snapshot") || !nextNumber(pos, end, version) || version != 1)
+    {
+        return false;
+    }
+    if (!expectWord(pos, end, "lsn") || !nextNumber(pos, end, value))
+    {
+        return false;
+    }
+    lsn = static_cast<uint64_t>(value);
+
+    long long nextVertex;
+    if (!expectWord(pos, end, "next_vertex") || !nextNumber(pos, end, nextVertex))
+    {
+        return false;
+    }
+
+    Graph restored;
+    if (!expectWord(pos, end, "vertices") || !nextNumber(pos, end, count))
+    {
+        return false;
+    }
+    for (long long i = 0; i < count; ++i)
+    {
+        if (!nextNumber(pos, end, value) || !restored.insertVertex(static_cast<int>(value)))
+        {
+            return false;
+        }
+    }
+    restored.reserveVertexIds(static_cast<int>(nextVertex));
+
+    if (!expectWord(pos, end, "edges") || !nextNumber(pos, end, count))
+    {
+        return false;
+    }
+    for (long long i = 0; i < count; ++i)
+    {
+        long long source, destination, weight;
+        if (!nextNumber(pos, end, source) || !nextNumber(pos, end, destination) || !nextNumber(pos, end, weight))
+        {
+            return false;
+        }
+        try
+        {
+            restored.addEdge(static_cast<int>(source), static_cast<int>(destination), static_cast<int>(weight));
+        }
+        catch (const std::out_of_range &)
+        {
+            return false;
+        }
+    }
+
+    graph = std::move(restored);
+    return true;
+}
+
+// Writes contents to path atomically so a crash never leaves a half-written snapshot behind
+void GraphSnapshot::writeFile(const std::string &path, const std::string &contents)
+{
+    std::string tempPath = path + ".tmp";
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot create snapshot " + tempPath + ": " + std::strerror(errno));
+    }
+
+    size_t written = 0;
+    while (written < contents.size())
+    {
+        ssize_t n = ::write(fd, contents.data() + written, contents.size() - written);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ::close(fd);
+            throw std::runtime_error("Cannot write snapshot " + tempPath + ": " + std::strerror(errno));
+        }
+        written += static_cast<size_t>(n);
+    }
+
+    if (::fsync(fd) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot sync snapshot " + tempPath + ": " + std::strerror(errno));
+    }
+    ::close(fd);
+
+    if (::rename(tempPath.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("Cannot install snapshot " + path + ": " + std::strerror(errno));
+    }
+
+    // Sync the directory as well so the rename itself survives a crash
+    size_t slash = path.find_last_of('/');
+    std::string directory = (slash == std::string::npos) ? "." : path.substr(0, slash);
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0 || ::fsync(dirFd) != 0)
+    {
+        std::string reason = std::strerror(errno);
+        if (dirFd >= 0)
+        {
+            ::close(dirFd);
+        }
+        throw std::runtime_error("Cannot sync directory " + directory + " after installing snapshot " + path + ": " +
+                                 reason);
+    }
+    ::close(dirFd);
+}
+
+// Loads a snapshot file into graph
+bool GraphSnapshot::readFile(const std::string &path, Graph &graph, uint64_t &lsn)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    if (!parse(buffer.str(), graph, lsn))
+    {
+        throw std::runtime_error("Corrupt snapshot file: " + path);
+    }
+    return true;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Serializes a whole graph (vertex IDs and undirected edges) into a compact text format.
+// Snapshots are used for durable storage and as an interchange format for generated graphs.
+class GraphSnapshot
+{
+public:
+    // write the graph to a stream, tagging it with the log sequence number it covers
+    static void write(const Graph &graph, std::ostream &out, uint64_t lsn = 0);
+    // parse a snapshot from memory into graph; returns false on malformed input
+    static bool parse(const std::string &data, Graph &graph, uint64_t &lsn);
+    // atomically replace the file at path (write to a temp file, fsync, rename)
+    static void writeFile(const std::string &path, const std::string &contents);
+    // read a snapshot file; returns false if the file does not exist
+    static bool readFile(const std::string &path, Graph &graph, uint64_t &lsn);
+};
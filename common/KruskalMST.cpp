@@ -1,10 +1,13 @@
 #include "KruskalMST.hpp"
+#include "CancellationToken.hpp"
+#include "EdgeColumns.hpp"
 #include <algorithm>
 #include <queue>
 #include <stdexcept>
 #include <limits>
 #include <vector>
 #include <functional>
+#include <unordered_map>
 
 using namespace std;
 
@@ -12,18 +15,25 @@ using namespace std;
 vector<Edge> KruskalMST::findMST(const Graph &graph)
 {
     vector<Edge> mst;                      // Will store the edges of the MST
-    vector<Edge> allEdges;                 // Will store all edges of the graph
+    EdgeColumns allEdges;                  // Will store all edges of the graph, column by column
     int numVertices = graph.getVertices(); // Get the number of vertices in the graph
 
-    // Collect all edges from the graph
+    // Collect every undirected edge once; both adjacency lists hold a copy of it
+    allEdges.reserve(static_cast<size_t>(graph.getEdges()));
     for (int i = 0; i < numVertices; ++i)
     {
-        vector<Edge> adjacentEdges = graph.getAdjacentEdges(i);
-        allEdges.insert(allEdges.end(), adjacentEdges.begin(), adjacentEdges.end());
+        CancellationToken::checkpoint(i);
+        for (const Edge &edge : graph.getAdjacentEdges(i))
+        {
+            if (edge.destination > i)
+            {
+                allEdges.push(edge);
+            }
+        }
     }
 
-    // Sort edges by weight in ascending order
-    sort(allEdges.begin(), allEdges.end());
+    // Sort edges by weight in ascending order (counting sort for narrow weight ranges)
+    allEdges.sortByWeight();
 
     // Initialize disjoint set data structure
     vector<int> parent(numVertices);
@@ -54,15 +64,16 @@ vector<Edge> KruskalMST::findMST(const Graph &graph)
     };
 
     // Kruskal's algorithm main loop
-    for (const Edge &edge : allEdges)
+    for (size_t i = 0; i < allEdges.size(); ++i)
     {
-        int sourceRoot = find(edge.source);
-        int destRoot = find(edge.destination);
+        CancellationToken::checkpoint(i);
+        int sourceRoot = find(allEdges.sources[i]);
+        int destRoot = find(allEdges.destinations[i]);
 
         // If the edge doesn't create a cycle, add it to the MST
         if (sourceRoot != destRoot)
         {
-            mst.push_back(edge);
+            mst.push_back(allEdges.get(i));
             unionSets(sourceRoot, destRoot);
         }
 
@@ -74,4 +85,83 @@ vector<Edge> KruskalMST::findMST(const Graph &graph)
     }
 
     return mst; // Return the Minimum Spanning Tree
-}
\ No newline at end of file
+}
+
+// Kruskal's algorithm over the whole graph, producing one tree per connected component.
+// Components are labeled first, so the main loop can stop as soon as it has V - C edges
+// instead of scanning every remaining edge of a disconnected graph.
+SpanningForest KruskalMST::findSpanningForest(const Graph &graph)
+{
+    SpanningForest forest;
+    forest.assignComponents(graph);
+
+    vector<int> ids = graph.getVertexIds();
+    size_t numVertices = ids.size();
+    unordered_map<int, int> indexOf;
+    indexOf.reserve(numVertices);
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        indexOf[ids[i]] = static_cast<int>(i);
+    }
+
+    // Collect every undirected edge once (self-loops can never be part of a forest)
+    EdgeColumns allEdges;
+    allEdges.reserve(static_cast<size_t>(graph.getEdges()));
+    for (size_t i = 0; i < ids.size(); ++i)
+    {
+        int id = ids[i];
+        CancellationToken::checkpoint(i);
+        for (const Edge &edge : graph.getAdjacentEdges(id))
+        {
+            if (edge.destination > id)
+            {
+                allEdges.push(edge);
+            }
+        }
+    }
+    allEdges.sortByWeight();
+
+    // Disjoint set over dense indices with union by size and path halving
+    vector<int> parent(numVertices);
+    vector<int> setSize(numVertices, 1);
+    for (size_t i = 0; i < numVertices; ++i)
+    {
+        parent[i] = static_cast<int>(i);
+    }
+    auto find = [&](int v)
+    {
+        while (parent[v] != v)
+        {
+            parent[v] = parent[parent[v]];
+            v = parent[v];
+        }
+        return v;
+    };
+
+    vector<Edge> forestEdges;
+    size_t target = numVertices - forest.getComponentCount();
+    forestEdges.reserve(target);
+    for (size_t i = 0; i < allEdges.size(); ++i)
+    {
+        CancellationToken::checkpoint(i);
+        if (forestEdges.size() == target)
+        {
+            break; // Every component is already spanned
+        }
+        int rootX = find(indexOf[allEdges.sources[i]]);
+        int rootY = find(indexOf[allEdges.destinations[i]]);
+        if (rootX != rootY)
+        {
+            if (setSize[rootX] < setSize[rootY])
+            {
+                std::swap(rootX, rootY);
+            }
+            parent[rootY] = rootX;
+            setSize[rootX] += setSize[rootY];
+            forestEdges.push_back(allEdges.get(i));
+        }
+    }
+
+    forest.groupEdges(forestEdges);
+    return forest;
+}
@@ -5,4 +5,5 @@ class KruskalMST : public MST
 {
 public:
     std::vector<Edge> findMST(const Graph &graph) override;
+    SpanningForest findSpanningForest(const Graph &graph) override;
 };
\ No newline at end of file
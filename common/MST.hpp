@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include "Graph.hpp"
+#include "SpanningForest.hpp"
 
 // Abstract class for Minimum Spanning Tree algorithms
 class MST
@@ -8,6 +9,8 @@ class MST
 public:
     // find the MST of the graph
     virtual std::vector<Edge> findMST(const Graph &graph) = 0;
+    // find a minimum spanning forest (one tree per connected component)
+    virtual SpanningForest findSpanningForest(const Graph &graph) = 0;
     // destructor
     virtual ~MST() = default;
 };
\ No newline at end of file
@@ -2,17 +2,104 @@
 // for Minimum Spanning Trees (MSTs) in graphs.
 
 #include "MSTMetrics.hpp"
+#include "CancellationToken.hpp"
+#include "WeightKernels.hpp"
 #include <limits>
 #include <algorithm>
 #include <numeric>
 #include <vector>
 #include <queue>
 #include <unordered_set>
+#include <unordered_map>
 #include <iostream>
 #include <cassert>
+#include <cmath>
+#include <random>
 
 using namespace std;
 
+namespace
+{
+    // Builds a compact adjacency list over the tree's own vertices
+    void buildAdjacency(const vector<Edge> &tree, vector<vector<pair<int, int>>> &adjacency)
+    {
+        unordered_map<int, int> indexOf;
+        indexOf.reserve(tree.size() + 1);
+        auto indexFor = [&](int id)
+        {
+            auto it = indexOf.find(id);
+            if (it != indexOf.end())
+            {
+                return it->second;
+            }
+            int index = static_cast<int>(adjacency.size());
+            indexOf[id] = index;
+            adjacency.emplace_back();
+            return index;
+        };
+        for (const auto &edge : tree)
+        {
+            int u = indexFor(edge.source);
+            int v = indexFor(edge.destination);
+            adjacency[u].emplace_back(v, edge.weight);
+            adjacency[v].emplace_back(u, edge.weight);
+        }
+    }
+
+    // Flat (CSR) copy of a tree's adjacency; repeated sweeps stay in a few contiguous arrays
+    struct FlatTree
+    {
+        vector<int> offsets;
+        vector<int> targets;
+        vector<int> weights;
+
+        explicit FlatTree(const vector<vector<pair<int, int>>> &adjacency) : offsets(adjacency.size() + 1, 0)
+        {
+            for (size_t u = 0; u < adjacency.size(); ++u)
+            {
+                offsets[u + 1] = offsets[u] + static_cast<int>(adjacency[u].size());
+                for (const auto &[v, w] : adjacency[u])
+                {
+                    targets.push_back(v);
+                    weights.push_back(w);
+                }
+            }
+        }
+        int size() const { return static_cast<int>(offsets.size()) - 1; }
+    };
+
+    // Walks the tree from source, filling distance; returns the farthest vertex and the sum of all distances
+    pair<int, double> sweepFrom(const FlatTree &tree, int source, vector<long long> &distance, vector<int> &stack)
+    {
+        const long long unvisited = numeric_limits<long long>::min();
+        distance.assign(tree.size(), unvisited);
+        distance[source] = 0;
+        stack.assign(1, source);
+        int farthest = source;
+        double sum = 0.0;
+        while (!stack.empty())
+        {
+            int u = stack.back();
+            stack.pop_back();
+            sum += distance[u];
+            if (distance[u] > distance[farthest])
+            {
+                farthest = u;
+            }
+            for (int i = tree.offsets[u]; i < tree.offsets[u + 1]; ++i)
+            {
+                int v = tree.targets[i];
+                if (distance[v] == unvisited)
+                {
+                    distance[v] = distance[u] + tree.weights[i];
+                    stack.push_back(v);
+                }
+            }
+        }
+        return {farthest, sum};
+    }
+}
+
 // Calculates the total weight of the MST
 int MSTMetrics::getTotalWeight(const std::vector<Edge> &mst) const
 {
@@ -23,10 +110,7 @@ int MSTMetrics::getTotalWeight(const std::vector<Edge> &mst) const
         return 0;
     }
 
-    for (const auto &edge : mst)
-    {
-        total += edge.weight;
-    }
+    total = static_cast<int>(WeightKernels::summarize(mst).sum);
     return total;
 }
 
@@ -39,159 +123,477 @@ int MSTMetrics::getLongestDistance(const Graph &graph, const std::vector<Edge> &
         std::cout << "Empty MST or graph" << std::endl;
         return 0;
     }
+    return static_cast<int>(max(0LL, getExactMetrics(mst).longestDistance));
+}
+
+// Calculates the average distance between all pairs of vertices in the MST
+double MSTMetrics::getAverageDistance(const Graph &graph, const vector<Edge> &mst) const
+{
+    if (mst.empty() || graph.getVertices() == 0)
+    {
+        return 0.0;
+    }
+    return getExactMetrics(mst).getAverageDistance();
+}
+
+// Finds the shortest distance between any two vertices in the MST
+int MSTMetrics::getShortestDistance(const vector<Edge> &mst) const
+{
+    if (mst.empty())
+        return 0;
 
-    int numVertices = graph.getVertices();
-    // Initialize distance matrix
-    std::vector<std::vector<int>> dist(numVertices, std::vector<int>(numVertices, std::numeric_limits<int>::max()));
+    return static_cast<int>(getExactMetrics(mst).shortestDistance);
+}
 
-    // Populate distance matrix with MST edges
+// Exact metrics over all pairs of vertices the MST connects. The MST may hold several trees (of a
+// disconnected graph); each is measured in linear time by getComponentMetrics and the results are
+// combined, so no V x V distance matrix is ever built.
+ComponentMetrics MSTMetrics::getExactMetrics(const std::vector<Edge> &mst) const
+{
+    // Union-find over the compacted vertex IDs groups the edges by tree
+    unordered_map<int, int> indexOf;
+    indexOf.reserve(mst.size() + 1);
+    vector<int> parent;
+    auto indexFor = [&](int id)
+    {
+        auto [it, inserted] = indexOf.emplace(id, static_cast<int>(parent.size()));
+        if (inserted)
+        {
+            parent.push_back(it->second);
+        }
+        return it->second;
+    };
+    auto find = [&](int x)
+    {
+        while (parent[x] != x)
+        {
+            parent[x] = parent[parent[x]];
+            x = parent[x];
+        }
+        return x;
+    };
     for (const auto &edge : mst)
     {
-        // Validate edge vertices
-        if (edge.source < 0 || edge.source >= numVertices ||
-            edge.destination < 0 || edge.destination >= numVertices)
+        int a = find(indexFor(edge.source));
+        int b = find(indexFor(edge.destination));
+        if (a != b)
+        {
+            parent[a] = b;
+        }
+    }
+
+    unordered_map<int, size_t> treeOf; // Root -> position in trees
+    vector<vector<Edge>> trees;
+    vector<int> treeVertices;
+    for (int v = 0; v < static_cast<int>(parent.size()); ++v)
+    {
+        auto [it, inserted] = treeOf.emplace(find(v), trees.size());
+        if (inserted)
         {
-            std::cout << "Invalid edge: (" << edge.source << ", " << edge.destination << ", " << edge.weight << ")" << std::endl;
-            continue;
+            trees.emplace_back();
+            treeVertices.push_back(0);
         }
-        dist[edge.source][edge.destination] = edge.weight;
-        dist[edge.destination][edge.source] = edge.weight;
+        ++treeVertices[it->second];
+    }
+    for (const auto &edge : mst)
+    {
+        trees[treeOf[find(indexOf[edge.source])]].push_back(edge);
+    }
+
+    vector<ComponentMetrics> components;
+    components.reserve(trees.size());
+    for (size_t t = 0; t < trees.size(); ++t)
+    {
+        CancellationToken::checkpoint();
+        components.push_back(getComponentMetrics(trees[t], treeVertices[t]));
+    }
+    return combine(components);
+}
+
+// Computes the metrics of every component of a spanning forest, one tree at a time
+std::vector<ComponentMetrics> MSTMetrics::getComponentMetrics(const SpanningForest &forest) const
+{
+    std::vector<ComponentMetrics> result;
+    result.reserve(forest.getComponentCount());
+    for (size_t c = 0; c < forest.getComponentCount(); ++c)
+    {
+        CancellationToken::checkpoint();
+        result.push_back(getComponentMetrics(forest.getComponentEdges(c), forest.componentSizes[c]));
+    }
+    return result;
+}
+
+// Computes the metrics of a single tree in O(V) with one post-order pass:
+//  - an edge splitting the tree into s and n - s vertices lies on s * (n - s) paths, which gives the
+//    sum of all pairwise distances without visiting any pair;
+//  - the longest/shortest path through a vertex joins its two best downward paths.
+ComponentMetrics MSTMetrics::getComponentMetrics(const std::vector<Edge> &tree, int vertices) const
+{
+    ComponentMetrics metrics;
+    metrics.vertices = vertices;
+    metrics.edges = static_cast<int>(tree.size());
+    metrics.pairs = static_cast<long long>(vertices) * (vertices - 1) / 2;
+    if (tree.empty())
+    {
+        return metrics;
     }
 
-    // Apply Floyd-Warshall algorithm for all-pairs shortest paths
-    for (int k = 0; k < numVertices; ++k)
+    vector<vector<pair<int, int>>> adjacency;
+    buildAdjacency(tree, adjacency);
+    metrics.totalWeight = WeightKernels::summarize(tree).sum;
+    int n = static_cast<int>(adjacency.size());
+
+    // Iterative DFS from vertex 0 gives a pre-order; walking it backwards is a post-order
+    vector<int> order;
+    vector<int> parent(n, -1);
+    vector<int> parentWeight(n, 0);
+    order.reserve(n);
+    vector<int> stack{0};
+    parent[0] = 0;
+    while (!stack.empty())
     {
-        for (int i = 0; i < numVertices; ++i)
+        int u = stack.back();
+        stack.pop_back();
+        order.push_back(u);
+        for (const auto &[v, w] : adjacency[u])
         {
-            for (int j = 0; j < numVertices; ++j)
+            if (parent[v] == -1)
             {
-                if (dist[i][k] != std::numeric_limits<int>::max() &&
-                    dist[k][j] != std::numeric_limits<int>::max() &&
-                    dist[i][k] + dist[k][j] < dist[i][j])
-                {
-                    dist[i][j] = dist[i][k] + dist[k][j];
-                }
+                parent[v] = u;
+                parentWeight[v] = w;
+                stack.push_back(v);
             }
         }
     }
 
-    // Find the maximum distance
-    int maxDist = 0;
-    for (int i = 0; i < numVertices; ++i)
+    vector<long long> subtreeSize(n, 1);
+    vector<long long> longestDown(n, 0);  // Heaviest path from the vertex down into its subtree (may be empty)
+    vector<long long> shortestDown(n, 0); // Lightest such path
+    long long longest = numeric_limits<long long>::min();
+    long long shortest = numeric_limits<long long>::max();
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
     {
-        for (int j = i + 1; j < numVertices; ++j)
+        int u = *it;
+        long long bestLong = numeric_limits<long long>::min(), secondLong = numeric_limits<long long>::min();
+        long long bestShort = numeric_limits<long long>::max(), secondShort = numeric_limits<long long>::max();
+        for (const auto &[v, w] : adjacency[u])
         {
-            if (dist[i][j] != std::numeric_limits<int>::max())
+            if (v == parent[u] && u != 0)
+            {
+                continue;
+            }
+            long long down = w + longestDown[v];
+            if (down > bestLong)
+            {
+                secondLong = bestLong;
+                bestLong = down;
+            }
+            else if (down > secondLong)
             {
-                maxDist = std::max(maxDist, dist[i][j]);
+                secondLong = down;
             }
+            long long downShort = w + shortestDown[v];
+            if (downShort < bestShort)
+            {
+                secondShort = bestShort;
+                bestShort = downShort;
+            }
+            else if (downShort < secondShort)
+            {
+                secondShort = downShort;
+            }
+        }
+        if (bestLong != numeric_limits<long long>::min())
+        {
+            longest = max(longest, secondLong != numeric_limits<long long>::min() ? max(bestLong, bestLong + secondLong) : bestLong);
+            shortest = min(shortest, secondShort != numeric_limits<long long>::max() ? min(bestShort, bestShort + secondShort) : bestShort);
+            longestDown[u] = max(0LL, bestLong);
+            shortestDown[u] = min(0LL, bestShort);
+        }
+
+        if (u != 0)
+        {
+            subtreeSize[parent[u]] += subtreeSize[u];
+            metrics.pairDistanceSum += static_cast<double>(parentWeight[u]) * subtreeSize[u] * (n - subtreeSize[u]);
         }
     }
 
-    return maxDist;
+    metrics.longestDistance = longest;
+    metrics.shortestDistance = shortest;
+    return metrics;
 }
 
-// Calculates the average distance between all pairs of vertices in the MST
-double MSTMetrics::getAverageDistance(const Graph &graph, const vector<Edge> &mst) const
+// Combines per-component metrics into forest-wide figures over reachable pairs only
+ComponentMetrics MSTMetrics::combine(const std::vector<ComponentMetrics> &components)
 {
-    if (mst.empty())
+    ComponentMetrics total;
+    bool any = false;
+    for (const auto &c : components)
     {
-        return 0.0;
+        total.vertices += c.vertices;
+        total.edges += c.edges;
+        total.totalWeight += c.totalWeight;
+        total.pairDistanceSum += c.pairDistanceSum;
+        total.pairs += c.pairs;
+        if (c.edges > 0)
+        {
+            total.longestDistance = any ? max(total.longestDistance, c.longestDistance) : c.longestDistance;
+            total.shortestDistance = any ? min(total.shortestDistance, c.shortestDistance) : c.shortestDistance;
+            any = true;
+        }
     }
+    return total;
+}
 
-    int numVertices = graph.getVertices();
-    // Initialize distance matrix
-    vector<vector<int>> dist(numVertices, vector<int>(numVertices, numeric_limits<int>::max()));
-
-    // Populate distance matrix with MST edges
-    for (const auto &edge : mst)
+// Estimates the metrics of a tree with a few linear sweeps instead of a full analysis.
+// Picking a source s uniformly at random, X_s = (sum of distances from s) / (n - 1) has the average
+// pairwise distance as its mean, so the sample mean of X over distinct sources is an unbiased
+// estimate; its normal-approximation interval (with finite population correction) gives the confidence.
+ApproximateMetrics MSTMetrics::getApproximateMetrics(const std::vector<Edge> &tree, double relativeError,
+                                                     int sampleBudget, unsigned seed) const
+{
+    ApproximateMetrics metrics;
+    metrics.edges = static_cast<int>(tree.size());
+    if (tree.empty())
     {
-        dist[edge.source][edge.destination] = edge.weight;
-        dist[edge.destination][edge.source] = edge.weight;
+        return metrics;
     }
 
-    // Apply Floyd-Warshall algorithm for all-pairs shortest paths
-    for (int k = 0; k < numVertices; ++k)
+    vector<vector<pair<int, int>>> adjacency;
+    buildAdjacency(tree, adjacency);
+    FlatTree flat(adjacency);
+    adjacency = vector<vector<pair<int, int>>>();
+    int n = flat.size();
+    metrics.vertices = n;
+
+    WeightKernels::Summary weights = WeightKernels::summarize(tree);
+    metrics.totalWeight = weights.sum;
+    metrics.shortestDistance = weights.min;
+    if (weights.min < 0)
     {
-        for (int i = 0; i < numVertices; ++i)
-        {
-            for (int j = 0; j < numVertices; ++j)
-            {
-                if (dist[i][k] != numeric_limits<int>::max() &&
-                    dist[k][j] != numeric_limits<int>::max() &&
-                    dist[i][k] + dist[k][j] < dist[i][j])
-                {
-                    dist[i][j] = dist[i][k] + dist[k][j];
-                }
-            }
-        }
+        metrics.longestExact = false;
+        metrics.shortestExact = false;
     }
 
-    // Calculate the sum of all distances and count valid pairs
-    double totalDistance = 0.0;
-    int validPairs = 0;
-    for (int i = 0; i < numVertices; ++i)
+    // Double sweep: the vertex farthest from anywhere is one end of a diameter, for non-negative weights
+    vector<long long> distance;
+    vector<int> stack;
+    int end = sweepFrom(flat, 0, distance, stack).first;
+    int otherEnd = sweepFrom(flat, end, distance, stack).first;
+    metrics.longestDistance = distance[otherEnd];
+
+    // Sample distinct sources in random order (partial Fisher-Yates) until the interval is tight enough
+    const double z = 1.96; // 95% two-sided normal quantile
+    int budget = max(1, min(sampleBudget, n));
+    vector<int> candidates(n);
+    iota(candidates.begin(), candidates.end(), 0);
+    mt19937 random(seed);
+    double mean = 0.0;
+    double m2 = 0.0; // Welford running sum of squared deviations
+    for (int k = 0; k < budget; ++k)
     {
-        for (int j = i + 1; j < numVertices; ++j)
+        CancellationToken::checkpoint(); // Every sample is a full sweep of the tree
+        uniform_int_distribution<int> pick(k, n - 1);
+        swap(candidates[k], candidates[pick(random)]);
+        double x = sweepFrom(flat, candidates[k], distance, stack).second / (n - 1);
+        metrics.samples = k + 1;
+        double delta = x - mean;
+        mean += delta / metrics.samples;
+        m2 += delta * (x - mean);
+
+        if (metrics.samples == n)
+        {
+            metrics.averageHalfWidth = 0.0; // Every source was visited: the average is exact
+            break;
+        }
+        if (metrics.samples >= 2)
         {
-            if (dist[i][j] != numeric_limits<int>::max())
+            double variance = m2 / (metrics.samples - 1);
+            double correction = sqrt(static_cast<double>(n - metrics.samples) / (n - 1));
+            metrics.averageHalfWidth = z * sqrt(variance / metrics.samples) * correction;
+            // A handful of samples can agree by chance, so never stop before eight
+            if (metrics.samples >= 8 && metrics.averageHalfWidth <= relativeError * fabs(mean))
             {
-                totalDistance += dist[i][j];
-                validPairs++;
+                break;
             }
         }
     }
-
-    // Calculate and return the average distance
-    return (validPairs > 0) ? (totalDistance / validPairs) : 0.0;
+    metrics.averageDistance = mean;
+    if (metrics.samples == 1 && n > 1)
+    {
+        metrics.averageHalfWidth = numeric_limits<double>::infinity(); // One sample says nothing about spread
+    }
+    return metrics;
 }
 
-// Finds the shortest distance between any two vertices in the MST
-int MSTMetrics::getShortestDistance(const vector<Edge> &mst) const
+// Fills a TreeProfile with two passes over the tree (post-order, then pre-order) plus a pass over the weights.
+// Eccentricities use rerooting: best[v] is the heaviest path from v down into its subtree and up[v] the
+// heaviest path that leaves v through its parent, so ecc(v) = max(best[v], up[v]) for any edge weights.
+TreeProfile MSTMetrics::getTreeProfile(const std::vector<Edge> &tree, int histogramBuckets) const
 {
-    if (mst.empty())
-        return 0;
+    TreeProfile profile;
+    profile.edges = static_cast<int>(tree.size());
+    if (tree.empty())
+    {
+        return profile;
+    }
 
-    size_t size = mst.size();
-    // Initialize distance matrix
-    vector<vector<int>> dist(size + 1, vector<int>(size + 1, numeric_limits<int>::max()));
+    // Dense indices in sorted ID order, so the per-vertex results come out sorted
+    for (const auto &edge : tree)
+    {
+        profile.vertexIds.push_back(edge.source);
+        profile.vertexIds.push_back(edge.destination);
+    }
+    sort(profile.vertexIds.begin(), profile.vertexIds.end());
+    profile.vertexIds.erase(unique(profile.vertexIds.begin(), profile.vertexIds.end()), profile.vertexIds.end());
+    int n = static_cast<int>(profile.vertexIds.size());
+    profile.vertices = n;
+    unordered_map<int, int> indexOf;
+    indexOf.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        indexOf[profile.vertexIds[i]] = i;
+    }
+    vector<vector<pair<int, int>>> adjacency(n);
+    for (const auto &edge : tree)
+    {
+        int u = indexOf[edge.source];
+        int v = indexOf[edge.destination];
+        adjacency[u].emplace_back(v, edge.weight);
+        adjacency[v].emplace_back(u, edge.weight);
+    }
 
-    // Populate distance matrix with MST edges
-    for (const auto &edge : mst)
+    // Weight column: the sum, extremes and histogram below are vectorized reductions over it
+    vector<int> weights;
+    weights.reserve(tree.size());
+    for (const auto &edge : tree)
     {
-        dist[edge.source][edge.destination] = edge.weight;
-        dist[edge.destination][edge.source] = edge.weight;
+        weights.push_back(edge.weight);
     }
+    WeightKernels::Summary summary = WeightKernels::summarize(weights.data(), weights.size());
+    profile.totalWeight = summary.sum;
+    profile.weightMin = summary.min;
+    profile.weightMax = summary.max;
+    profile.bottleneck = tree[find(weights.begin(), weights.end(), summary.max) - weights.begin()];
 
-    // Apply Floyd-Warshall algorithm for all-pairs shortest paths
-    for (size_t k = 0; k <= size; ++k)
+    // Pre-order from vertex 0
+    vector<int> order;
+    vector<int> parent(n, -1);
+    vector<int> parentWeight(n, 0);
+    order.reserve(n);
+    vector<int> stack{0};
+    parent[0] = 0;
+    while (!stack.empty())
     {
-        for (size_t i = 0; i <= size; ++i)
+        int u = stack.back();
+        stack.pop_back();
+        order.push_back(u);
+        for (const auto &[v, w] : adjacency[u])
         {
-            for (size_t j = 0; j <= size; ++j)
+            if (parent[v] == -1)
             {
-                if (dist[i][k] != numeric_limits<int>::max() &&
-                    dist[k][j] != numeric_limits<int>::max() &&
-                    dist[i][k] + dist[k][j] < dist[i][j])
-                {
-                    dist[i][j] = dist[i][k] + dist[k][j];
-                }
+                parent[v] = u;
+                parentWeight[v] = w;
+                stack.push_back(v);
             }
         }
     }
 
-    // Find the shortest distance between any two vertices
-    int shortestDist = numeric_limits<int>::max();
-    for (size_t i = 0; i <= size; ++i)
+    // Post-order: subtree sizes and the best downward path through each child
+    const long long none = numeric_limits<long long>::min();
+    vector<long long> best(n, none);
+    vector<int> subtreeSize(n, 1);
+    vector<int> largestChild(n, 0);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        int u = *it;
+        if (u != 0)
+        {
+            int p = parent[u];
+            long long through = parentWeight[u] + max(0LL, best[u] == none ? 0LL : best[u]);
+            best[p] = max(best[p], through);
+            subtreeSize[p] += subtreeSize[u];
+            largestChild[p] = max(largestChild[p], subtreeSize[u]);
+        }
+    }
+
+    // Pre-order: the best path leaving each child through its parent, from the parent's top two branches
+    vector<long long> up(n, none);
+    for (int u : order)
     {
-        for (size_t j = i + 1; j <= size; ++j)
+        long long first = none, second = none;
+        int firstChild = -1;
+        for (const auto &[v, w] : adjacency[u])
+        {
+            if (v == parent[u] && u != 0)
+            {
+                continue;
+            }
+            long long through = w + max(0LL, best[v] == none ? 0LL : best[v]);
+            if (through > first)
+            {
+                second = first;
+                first = through;
+                firstChild = v;
+            }
+            else if (through > second)
+            {
+                second = through;
+            }
+        }
+        for (const auto &[v, w] : adjacency[u])
         {
-            if (dist[i][j] != numeric_limits<int>::max())
+            if (v == parent[u] && u != 0)
             {
-                shortestDist = min(shortestDist, dist[i][j]);
+                continue;
             }
+            long long sibling = (v == firstChild) ? second : first;
+            long long beyond = max({0LL, up[u] == none ? 0LL : up[u], sibling == none ? 0LL : sibling});
+            up[v] = w + beyond;
+        }
+    }
+
+    profile.eccentricity.resize(n);
+    profile.degree.resize(n);
+    profile.diameter = numeric_limits<long long>::min();
+    profile.radius = numeric_limits<long long>::max();
+    for (int v = 0; v < n; ++v)
+    {
+        profile.eccentricity[v] = max(best[v], up[v]);
+        profile.degree[v] = static_cast<int>(adjacency[v].size());
+        profile.diameter = max(profile.diameter, profile.eccentricity[v]);
+        profile.radius = min(profile.radius, profile.eccentricity[v]);
+        if (static_cast<int>(profile.degreeCounts.size()) <= profile.degree[v])
+        {
+            profile.degreeCounts.resize(profile.degree[v] + 1, 0);
+        }
+        ++profile.degreeCounts[profile.degree[v]];
+    }
+    for (int v = 0; v < n; ++v)
+    {
+        if (profile.eccentricity[v] == profile.radius)
+        {
+            profile.center.push_back(profile.vertexIds[v]);
+        }
+        if (2 * max(largestChild[v], n - subtreeSize[v]) <= n)
+        {
+            profile.centroid.push_back(profile.vertexIds[v]);
         }
     }
 
-    return shortestDist;
-}
\ No newline at end of file
+    // Weight distribution: one pass for the histogram, selection for the percentiles
+    profile.weightHistogram.assign(max(1, histogramBuckets), 0);
+    double width = static_cast<double>(profile.weightMax - profile.weightMin) / profile.weightHistogram.size();
+    WeightKernels::histogram(weights.data(), weights.size(), profile.weightMin, width, profile.weightHistogram);
+    auto percentile = [&weights](int p)
+    {
+        size_t rank = (static_cast<size_t>(p) * weights.size() + 99) / 100; // Nearest rank, 1-based
+        auto nth = weights.begin() + (rank == 0 ? 0 : rank - 1);
+        nth_element(weights.begin(), nth, weights.end());
+        return *nth;
+    };
+    profile.weightP50 = percentile(50);
+    profile.weightP90 = percentile(90);
+    profile.weightP99 = percentile(99);
+    return profile;
+}
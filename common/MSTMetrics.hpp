@@ -1,8 +1,64 @@
 #pragma once
 #include "Graph.hpp"
+#include "SpanningForest.hpp"
 #include <vector>
 #include <limits>
 
+// Metrics of one tree of a spanning forest. Distances are path weights inside the tree;
+// pairs of vertices in different components are never considered.
+struct ComponentMetrics
+{
+    int vertices = 0;
+    int edges = 0;
+    long long totalWeight = 0;
+    long long longestDistance = 0;  // Largest distance between two vertices of the tree
+    long long shortestDistance = 0; // Smallest distance between two distinct vertices of the tree
+    double pairDistanceSum = 0.0;   // Sum of distances over all unordered vertex pairs
+    long long pairs = 0;            // Number of unordered vertex pairs
+
+    double getAverageDistance() const { return pairs > 0 ? pairDistanceSum / pairs : 0.0; }
+};
+
+// Sampled metrics of one tree. Total weight is always exact; the diameter comes from a double sweep
+// (exact when no weight is negative); the average distance is estimated from sampled sources.
+struct ApproximateMetrics
+{
+    int vertices = 0;
+    int edges = 0;
+    long long totalWeight = 0;
+    long long longestDistance = 0;
+    bool longestExact = true;          // False if negative weights make the double sweep a lower bound
+    long long shortestDistance = 0;    // Lightest edge; a shortest path never uses more than one edge
+    bool shortestExact = true;         // ...unless weights are negative, then this is an upper bound
+    double averageDistance = 0.0;
+    double averageHalfWidth = 0.0;     // Half-width of the confidence interval around averageDistance
+    double confidence = 0.95;
+    int samples = 0;                   // Source vertices whose distances were summed
+};
+
+// Everything about one tree that clients used to compute offline, filled by MSTMetrics::getTreeProfile
+struct TreeProfile
+{
+    int vertices = 0;
+    int edges = 0;
+    long long totalWeight = 0;
+    std::vector<int> vertexIds;           // Sorted; the per-vertex vectors below follow this order
+    std::vector<long long> eccentricity;  // Largest distance from the vertex to any other vertex
+    std::vector<int> degree;
+    long long diameter = 0;               // Largest eccentricity
+    long long radius = 0;                 // Smallest eccentricity
+    std::vector<int> center;              // Vertices whose eccentricity equals the radius
+    std::vector<int> centroid;            // Vertices whose removal leaves no part larger than half the tree
+    std::vector<int> degreeCounts;        // degreeCounts[d] = number of vertices with degree d
+    Edge bottleneck = Edge(0, 0, 0);      // Heaviest edge
+    int weightMin = 0;
+    int weightMax = 0;
+    std::vector<int> weightHistogram;     // Equal-width buckets over [weightMin, weightMax]
+    int weightP50 = 0;                    // Nearest-rank percentiles of the edge weights
+    int weightP90 = 0;
+    int weightP99 = 0;
+};
+
 class MSTMetrics
 {
 public:
@@ -10,4 +66,20 @@ public:
     int getLongestDistance(const Graph &graph, const std::vector<Edge> &mst) const;
     int getShortestDistance(const std::vector<Edge> &mst) const;
     double getAverageDistance(const Graph &graph, const std::vector<Edge> &mst) const;
+
+    // Linear-time metrics for every tree of a forest, and their combination over the whole forest
+    std::vector<ComponentMetrics> getComponentMetrics(const SpanningForest &forest) const;
+    ComponentMetrics getComponentMetrics(const std::vector<Edge> &tree, int vertices) const;
+    static ComponentMetrics combine(const std::vector<ComponentMetrics> &components);
+
+    // All per-vertex and distribution metrics of a tree in a fixed number of linear passes
+    TreeProfile getTreeProfile(const std::vector<Edge> &tree, int histogramBuckets = 10) const;
+
+    // Sampling estimate for very large trees: stops once the confidence interval of the average
+    // distance is within relativeError of the estimate, or after sampleBudget sources
+    ApproximateMetrics getApproximateMetrics(const std::vector<Edge> &tree, double relativeError, int sampleBudget,
+                                             unsigned seed = 0) const;
+
+private:
+    ComponentMetrics getExactMetrics(const std::vector<Edge> &mst) const;
 };
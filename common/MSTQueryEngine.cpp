@@ -0,0 +1,223 @@
+// This file implements MSTQueryEngine, which answers distance, bottleneck and path queries on a
+// spanning forest. Each tree is rooted at an arbitrary vertex; a query climbs both endpoints to their
+// lowest common ancestor with binary lifting, and distances come from the per-vertex prefix sums.
+
+#include "MSTQueryEngine.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+// Builds the lifting tables for every tree of the forest (isolated vertices are trees of one vertex)
+MSTQueryEngine::MSTQueryEngine(const SpanningForest &forest) : levels(1)
+{
+    ids.reserve(forest.componentOf.size());
+    for (const auto &entry : forest.componentOf)
+    {
+        ids.push_back(entry.first);
+    }
+    std::sort(ids.begin(), ids.end());
+    int n = static_cast<int>(ids.size());
+    indexOf.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        indexOf[ids[i]] = i;
+    }
+
+    std::vector<std::vector<std::pair<int, int>>> adjacency(n);
+    for (const Edge &edge : forest.edges)
+    {
+        int u = indexOf.at(edge.source);
+        int v = indexOf.at(edge.destination);
+        adjacency[u].emplace_back(v, edge.weight);
+        adjacency[v].emplace_back(u, edge.weight);
+    }
+
+    while ((1 << levels) < n)
+    {
+        ++levels;
+    }
+    component.assign(n, -1);
+    depth.assign(n, 0);
+    rootDistance.assign(n, 0);
+    parentWeight.assign(n, 0);
+    ancestor.assign(static_cast<size_t>(levels) * n, 0);
+    heaviest.assign(static_cast<size_t>(levels) * n, 0);
+
+    // Iterative DFS from each unvisited vertex; level 0 of the tables is the parent
+    std::vector<int> stack;
+    int components = 0;
+    for (int root = 0; root < n; ++root)
+    {
+        if (component[root] != -1)
+        {
+            continue;
+        }
+        component[root] = components++;
+        ancestor[root] = root;
+        heaviest[root] = root;
+        stack.assign(1, root);
+        while (!stack.empty())
+        {
+            int u = stack.back();
+            stack.pop_back();
+            for (const auto &[v, w] : adjacency[u])
+            {
+                if (component[v] == -1)
+                {
+                    component[v] = component[u];
+                    depth[v] = depth[u] + 1;
+                    rootDistance[v] = rootDistance[u] + w;
+                    parentWeight[v] = w;
+                    ancestor[v] = u;
+                    heaviest[v] = v;
+                    stack.push_back(v);
+                }
+            }
+        }
+    }
+
+    // Level k jumps twice as far as level k - 1
+    for (int k = 1; k < levels; ++k)
+    {
+        const int *previous = &ancestor[static_cast<size_t>(k - 1) * n];
+        const int *previousHeaviest = &heaviest[static_cast<size_t>(k - 1) * n];
+        int *current = &ancestor[static_cast<size_t>(k) * n];
+        int *currentHeaviest = &heaviest[static_cast<size_t>(k) * n];
+        for (int v = 0; v < n; ++v)
+        {
+            int middle = previous[v];
+            current[v] = previous[middle];
+            currentHeaviest[v] = heavier(previousHeaviest[v], previousHeaviest[middle]);
+        }
+    }
+}
+
+bool MSTQueryEngine::contains(int vertex) const
+{
+    return indexOf.count(vertex) > 0;
+}
+
+// Maps a vertex ID to its dense index, rejecting IDs the forest does not contain
+int MSTQueryEngine::indexFor(int vertex) const
+{
+    auto it = indexOf.find(vertex);
+    if (it == indexOf.end())
+    {
+        throw std::invalid_argument("Vertex " + std::to_string(vertex) + " does not exist");
+    }
+    return it->second;
+}
+
+// Of two vertices, returns the one whose edge to its parent is heavier (a root's own entry never wins)
+int MSTQueryEngine::heavier(int a, int b) const
+{
+    if (depth[a] == 0)
+    {
+        return b;
+    }
+    if (depth[b] == 0)
+    {
+        return a;
+    }
+    return parentWeight[b] > parentWeight[a] ? b : a;
+}
+
+int MSTQueryEngine::climb(int v, int steps, int &heaviestBelow) const
+{
+    size_t n = ids.size();
+    for (int k = 0; steps > 0; ++k, steps >>= 1)
+    {
+        if (steps & 1)
+        {
+            heaviestBelow = heavier(heaviestBelow, heaviest[k * n + v]);
+            v = ancestor[k * n + v];
+        }
+    }
+    return v;
+}
+
+// Standard binary lifting: equalize depths, then jump both vertices while their ancestors differ
+int MSTQueryEngine::lowestCommonAncestor(int u, int v) const
+{
+    int ignored = u;
+    if (depth[u] < depth[v])
+    {
+        std::swap(u, v);
+    }
+    u = climb(u, depth[u] - depth[v], ignored);
+    if (u == v)
+    {
+        return u;
+    }
+    size_t n = ids.size();
+    for (int k = levels - 1; k >= 0; --k)
+    {
+        if (ancestor[k * n + u] != ancestor[k * n + v])
+        {
+            u = ancestor[k * n + u];
+            v = ancestor[k * n + v];
+        }
+    }
+    return ancestor[u];
+}
+
+bool MSTQueryEngine::connected(int u, int v) const
+{
+    return component[indexFor(u)] == component[indexFor(v)];
+}
+
+long long MSTQueryEngine::distance(int u, int v) const
+{
+    int a = indexFor(u);
+    int b = indexFor(v);
+    if (component[a] != component[b])
+    {
+        throw std::invalid_argument("Vertices " + std::to_string(u) + " and " + std::to_string(v) + " are not connected");
+    }
+    return rootDistance[a] + rootDistance[b] - 2 * rootDistance[lowestCommonAncestor(a, b)];
+}
+
+Edge MSTQueryEngine::bottleneck(int u, int v) const
+{
+    int a = indexFor(u);
+    int b = indexFor(v);
+    if (component[a] != component[b])
+    {
+        throw std::invalid_argument("Vertices " + std::to_string(u) + " and " + std::to_string(v) + " are not connected");
+    }
+    if (a == b)
+    {
+        throw std::invalid_argument("The path from a vertex to itself has no edges");
+    }
+    int lca = lowestCommonAncestor(a, b);
+    // Start from an endpoint below the LCA: its parent edge is on the path
+    int best = a != lca ? a : b;
+    climb(a, depth[a] - depth[lca], best);
+    climb(b, depth[b] - depth[lca], best);
+    return Edge(ids[best], ids[ancestor[best]], parentWeight[best]);
+}
+
+// Walks both endpoints up to their common ancestor; the result runs from u to v
+std::vector<int> MSTQueryEngine::path(int u, int v) const
+{
+    int a = indexFor(u);
+    int b = indexFor(v);
+    if (component[a] != component[b])
+    {
+        throw std::invalid_argument("Vertices " + std::to_string(u) + " and " + std::to_string(v) + " are not connected");
+    }
+    int lca = lowestCommonAncestor(a, b);
+    std::vector<int> result;
+    for (int x = a; x != lca; x = ancestor[x])
+    {
+        result.push_back(ids[x]);
+    }
+    result.push_back(ids[lca]);
+    size_t middle = result.size();
+    for (int x = b; x != lca; x = ancestor[x])
+    {
+        result.push_back(ids[x]);
+    }
+    std::reverse(result.begin() + middle, result.end());
+    return result;
+}
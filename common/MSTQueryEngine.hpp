@@ -0,0 +1,41 @@
+#pragma once
+#include "Graph.hpp"
+#include "SpanningForest.hpp"
+#include <unordered_map>
+#include <vector>
+
+// Answers path queries on a spanning forest after an O(V log V) build:
+// distance and bottleneck (heaviest edge) between two vertices in O(log V), the path itself in
+// O(log V + path length). Uses binary lifting with prefix sums of the edge weights from each root.
+// The engine is immutable once built, so any number of threads may query it at the same time.
+class MSTQueryEngine
+{
+public:
+    explicit MSTQueryEngine(const SpanningForest &forest);
+
+    bool contains(int vertex) const;
+    // True if both vertices are in the same tree; throws std::invalid_argument for unknown vertices
+    bool connected(int u, int v) const;
+    // The following throw std::invalid_argument if a vertex is unknown or the vertices are not connected
+    long long distance(int u, int v) const;
+    Edge bottleneck(int u, int v) const; // Heaviest edge on the path; u and v must differ
+    std::vector<int> path(int u, int v) const;
+    size_t getVertexCount() const { return ids.size(); }
+
+private:
+    std::vector<int> ids;                // Dense index -> vertex ID
+    std::unordered_map<int, int> indexOf;
+    std::vector<int> component;
+    std::vector<int> depth;
+    std::vector<long long> rootDistance; // Weighted distance from the root of the vertex's tree
+    std::vector<int> parentWeight;
+    int levels;
+    std::vector<int> ancestor;           // ancestor[k * n + v]: 2^k-th ancestor of v (roots point to themselves)
+    std::vector<int> heaviest;           // heaviest[k * n + v]: vertex whose parent edge is heaviest on that jump
+
+    int indexFor(int vertex) const;
+    int lowestCommonAncestor(int u, int v) const;
+    int heavier(int a, int b) const;
+    // Climbs from v towards the root by `steps` edges; tracks the heaviest parent edge passed
+    int climb(int v, int steps, int &heaviestBelow) const;
+};
@@ -1,9 +1,11 @@
 // This file implements Prim's algorithm for finding the Minimum Spanning Tree (MST) of a graph.
 
 #include "PrimMST.hpp"
+#include "CancellationToken.hpp"
 #include <queue>
 #include <iostream>
 #include <limits>
+#include <unordered_map>
 
 using namespace std;
 
@@ -31,6 +33,7 @@ vector<Edge> PrimMST::findMST(const Graph &graph)
 
     // Start with vertex 0
     int startVertex = 0;
+    size_t visitedCount = 0;
     pq.push({0, startVertex});
     key[startVertex] = 0;
 
@@ -45,6 +48,7 @@ vector<Edge> PrimMST::findMST(const Graph &graph)
             continue;
 
         visited[u] = true;
+        CancellationToken::checkpoint(++visitedCount);
 
         // Add the edge to the MST if it's not the starting vertex
         if (parent[u] != -1)
@@ -74,4 +78,74 @@ vector<Edge> PrimMST::findMST(const Graph &graph)
 
     std::cout << "Prim's algorithm finished. MST has " << mst.size() << " edges" << std::endl;
     return mst;
-}
\ No newline at end of file
+}
+
+// Runs Prim's algorithm from every vertex not reached yet, so each connected component gets
+// its own tree. Components are discovered (and numbered) in ascending order of their smallest vertex.
+SpanningForest PrimMST::findSpanningForest(const Graph &graph)
+{
+    SpanningForest forest;
+    std::vector<int> ids = graph.getVertexIds();
+    int n = static_cast<int>(ids.size());
+
+    // Map vertex IDs to dense indices so the arrays below stay compact even after removals
+    std::unordered_map<int, int> indexOf;
+    indexOf.reserve(n);
+    for (int i = 0; i < n; ++i)
+    {
+        indexOf[ids[i]] = i;
+    }
+
+    vector<bool> visited(n, false);
+    vector<int> key(n, numeric_limits<int>::max());
+    vector<int> parent(n, -1);
+    priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> pq;
+
+    size_t visitedCount = 0;
+    forest.componentOffsets.push_back(0);
+    forest.componentOf.reserve(n);
+    for (int start = 0; start < n; ++start)
+    {
+        if (visited[start])
+        {
+            continue;
+        }
+
+        // A new component begins at the smallest unvisited vertex
+        int component = static_cast<int>(forest.componentSizes.size());
+        forest.componentRoots.push_back(ids[start]);
+        forest.componentSizes.push_back(0);
+        key[start] = 0;
+        pq.push({0, start});
+
+        while (!pq.empty())
+        {
+            int u = pq.top().second;
+            pq.pop();
+            if (visited[u])
+                continue;
+
+            visited[u] = true;
+            CancellationToken::checkpoint(++visitedCount);
+            forest.componentOf[ids[u]] = component;
+            ++forest.componentSizes[component];
+            if (parent[u] != -1)
+            {
+                forest.edges.push_back({ids[parent[u]], ids[u], key[u]});
+            }
+
+            for (const auto &neighbor : graph.getAdjacentEdges(ids[u]))
+            {
+                int v = indexOf[neighbor.destination];
+                if (!visited[v] && neighbor.weight < key[v])
+                {
+                    parent[v] = u;
+                    key[v] = neighbor.weight;
+                    pq.push({key[v], v});
+                }
+            }
+        }
+        forest.componentOffsets.push_back(forest.edges.size());
+    }
+    return forest;
+}
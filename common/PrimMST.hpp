@@ -6,4 +6,5 @@ class PrimMST : public MST
 {
 public:
     std::vector<Edge> findMST(const Graph &graph) override;
+    SpanningForest findSpanningForest(const Graph &graph) override;
 };
\ No newline at end of file
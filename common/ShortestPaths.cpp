@@ -0,0 +1,346 @@
+// This file implements the ShortestPaths class: heap-based Dijkstra and multi-threaded delta-stepping.
+
+#include "ShortestPaths.hpp"
+#include "CancellationToken.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace
+{
+    const long long infinity = LLONG_MAX;
+    const size_t relaxChunk = 512; // Frontier vertices per work item of a delta-stepping phase
+
+    // Lazy-deletion Dijkstra: a vertex may sit in the heap several times, only its lowest entry counts
+    void dijkstra(const CSRGraph &graph, size_t source, std::vector<long long> &distances)
+    {
+        distances.assign(graph.getVertexCount(), infinity);
+        distances[source] = 0;
+        using Entry = std::pair<long long, size_t>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+        heap.emplace(0, source);
+        size_t settled = 0;
+        while (!heap.empty())
+        {
+            auto [distance, u] = heap.top();
+            heap.pop();
+            if (distance != distances[u])
+            {
+                continue;
+            }
+            CancellationToken::checkpoint(++settled);
+            for (size_t arc = graph.begin(u); arc < graph.end(u); ++arc)
+            {
+                size_t v = static_cast<size_t>(graph.getTarget(arc));
+                long long candidate = distance + graph.getWeight(arc);
+                if (candidate < distances[v])
+                {
+                    distances[v] = candidate;
+                    heap.emplace(candidate, v);
+                }
+            }
+        }
+    }
+
+    ShortestPathSummary summarize(const CSRGraph &graph, size_t source, const std::vector<long long> &distances)
+    {
+        ShortestPathSummary summary;
+        summary.source = graph.getId(source);
+        double sum = 0.0;
+        for (size_t i = 0; i < distances.size(); ++i)
+        {
+            if (distances[i] == infinity)
+            {
+                continue;
+            }
+            ++summary.reached;
+            sum += static_cast<double>(distances[i]);
+            if (summary.farthest < 0 || distances[i] > summary.eccentricity)
+            {
+                summary.eccentricity = distances[i];
+                summary.farthest = graph.getId(i);
+            }
+        }
+        summary.averageDistance = summary.reached > 1 ? sum / (summary.reached - 1) : 0.0;
+        return summary;
+    }
+}
+
+// Constructor: checks the weights and picks the algorithm and bucket width for this graph
+ShortestPaths::ShortestPaths(const CSRGraph &g, WorkerPool *workers, size_t threads) : graph(g), pool(workers)
+{
+    if (graph.getMinWeight() < 0)
+    {
+        throw std::invalid_argument("The graph has a negative edge weight (" + std::to_string(graph.getMinWeight()) +
+                                    "), so shortest paths are undefined");
+    }
+    threadLimit = pool ? pool->getThreadCount() : 1;
+    if (threads > 0)
+    {
+        threadLimit = std::min(threadLimit, threads);
+    }
+    if (threadLimit < 2)
+    {
+        pool = nullptr;
+    }
+    size_t n = graph.getVertexCount();
+    parallel = pool && n >= parallelThreshold;
+
+    // About one bucket per maxWeight / degree: a vertex's lightest arcs then tend to stay within it
+    long long degree = std::max<long long>(1, static_cast<long long>(graph.getArcCount() / std::max<size_t>(1, n)));
+    delta = std::max<long long>(1, graph.getMaxWeight() / degree);
+}
+
+size_t ShortestPaths::sourceIndex(int source) const
+{
+    long long index = graph.indexOf(source);
+    if (index < 0)
+    {
+        throw std::invalid_argument("Vertex " + std::to_string(source) + " does not exist");
+    }
+    return static_cast<size_t>(index);
+}
+
+std::vector<long long> ShortestPaths::run(int source)
+{
+    auto started = std::chrono::steady_clock::now();
+    size_t index = sourceIndex(source);
+    std::vector<long long> distances;
+    if (parallel)
+    {
+        deltaStepping(index, distances);
+        threadsUsed = threadLimit;
+    }
+    else
+    {
+        dijkstra(graph, index, distances);
+        threadsUsed = 1;
+    }
+    for (long long &distance : distances)
+    {
+        distance = distance == infinity ? -1 : distance;
+    }
+    milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return distances;
+}
+
+// Breadth-first search backwards from target over tight arcs (those on some shortest path), so
+// zero-weight edges between equally distant vertices cannot send the walk in circles
+std::vector<int> ShortestPaths::path(const std::vector<long long> &distances, int source, int target) const
+{
+    size_t from = sourceIndex(source);
+    size_t to = sourceIndex(target);
+    if (distances[to] < 0)
+    {
+        return {};
+    }
+    std::unordered_map<size_t, size_t> towardTarget;
+    towardTarget[to] = to;
+    std::queue<size_t> queue;
+    queue.push(to);
+    while (!queue.empty() && !towardTarget.count(from))
+    {
+        size_t v = queue.front();
+        queue.pop();
+        for (size_t arc = graph.begin(v); arc < graph.end(v); ++arc)
+        {
+            size_t u = static_cast<size_t>(graph.getTarget(arc));
+            if (distances[u] >= 0 && distances[u] + graph.getWeight(arc) == distances[v] && !towardTarget.count(u))
+            {
+                towardTarget[u] = v;
+                queue.push(u);
+            }
+        }
+    }
+
+    std::vector<int> vertices{graph.getId(from)};
+    for (size_t v = from; v != to; v = towardTarget.at(v))
+    {
+        vertices.push_back(graph.getId(towardTarget.at(v)));
+    }
+    return vertices;
+}
+
+// Large graphs run the sources one after another, each spread over all threads; small graphs run
+// one Dijkstra per thread. Workers install the request's token themselves and stop at a cancellation,
+// which the caller then rethrows.
+std::vector<ShortestPathSummary> ShortestPaths::runBatch(const std::vector<int> &sources)
+{
+    auto started = std::chrono::steady_clock::now();
+    std::vector<size_t> indices;
+    for (int source : sources)
+    {
+        indices.push_back(sourceIndex(source));
+    }
+
+    std::vector<ShortestPathSummary> summaries(indices.size());
+    if (parallel)
+    {
+        std::vector<long long> distances;
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            deltaStepping(indices[i], distances);
+            summaries[i] = summarize(graph, indices[i], distances);
+        }
+        threadsUsed = threadLimit;
+    }
+    else if (pool && indices.size() > 1)
+    {
+        std::shared_ptr<const CancellationToken> token = CancellationToken::current();
+        std::atomic<bool> stopped(false);
+        pool->forEach(indices.size(), [&](size_t i)
+                      {
+            if (stopped.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            CancellationToken::Scope scope(token);
+            try
+            {
+                std::vector<long long> distances;
+                dijkstra(graph, indices[i], distances);
+                summaries[i] = summarize(graph, indices[i], distances);
+            }
+            catch (const OperationCancelled &)
+            {
+                stopped.store(true, std::memory_order_relaxed);
+            } }, threadLimit);
+        CancellationToken::checkpoint();
+        threadsUsed = std::min(threadLimit, indices.size());
+    }
+    else
+    {
+        std::vector<long long> distances;
+        for (size_t i = 0; i < indices.size(); ++i)
+        {
+            dijkstra(graph, indices[i], distances);
+            summaries[i] = summarize(graph, indices[i], distances);
+        }
+        threadsUsed = 1;
+    }
+    milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    return summaries;
+}
+
+// Buckets are a ring: every pending distance lies within maxWeight of the current bucket, so
+// maxWeight / delta + 2 slots never hold two different buckets at once. Bucket entries are not removed
+// when a vertex moves to a lower bucket; stale ones are skipped when their slot comes up.
+void ShortestPaths::deltaStepping(size_t source, std::vector<long long> &distances)
+{
+    size_t n = graph.getVertexCount();
+    std::unique_ptr<std::atomic<long long>[]> tentative(new std::atomic<long long>[n]);
+    for (size_t i = 0; i < n; ++i)
+    {
+        tentative[i].store(infinity, std::memory_order_relaxed);
+    }
+    tentative[source].store(0, std::memory_order_relaxed);
+
+    size_t slots = static_cast<size_t>(graph.getMaxWeight() / delta) + 2;
+    std::vector<std::vector<int>> buckets(slots);
+    buckets[0].push_back(static_cast<int>(source));
+    size_t pending = 1;
+
+    // Each chunk of a phase collects the vertices it improved; the caller files them afterwards
+    std::vector<std::vector<int>> improved;
+    auto relax = [&](const std::vector<int> &vertices, bool light)
+    {
+        size_t chunks = (vertices.size() + relaxChunk - 1) / relaxChunk;
+        if (improved.size() < chunks)
+        {
+            improved.resize(chunks);
+        }
+        auto work = [&](size_t chunk)
+        {
+            std::vector<int> &out = improved[chunk];
+            out.clear();
+            size_t last = std::min(vertices.size(), (chunk + 1) * relaxChunk);
+            for (size_t i = chunk * relaxChunk; i < last; ++i)
+            {
+                size_t u = static_cast<size_t>(vertices[i]);
+                long long distance = tentative[u].load(std::memory_order_relaxed);
+                size_t split = graph.lightEnd(u, delta);
+                size_t first = light ? graph.begin(u) : split;
+                size_t end = light ? split : graph.end(u);
+                for (size_t arc = first; arc < end; ++arc)
+                {
+                    int v = graph.getTarget(arc);
+                    long long candidate = distance + graph.getWeight(arc);
+                    long long current = tentative[v].load(std::memory_order_relaxed);
+                    while (candidate < current)
+                    {
+                        if (tentative[v].compare_exchange_weak(current, candidate, std::memory_order_relaxed))
+                        {
+                            out.push_back(v);
+                            break;
+                        }
+                    }
+                }
+            }
+        };
+        if (chunks > 1)
+        {
+            pool->forEach(chunks, work, threadLimit);
+        }
+        else if (chunks == 1)
+        {
+            work(0);
+        }
+        for (size_t chunk = 0; chunk < chunks; ++chunk)
+        {
+            for (int v : improved[chunk])
+            {
+                long long bucket = tentative[v].load(std::memory_order_relaxed) / delta;
+                buckets[static_cast<size_t>(bucket) % slots].push_back(v);
+                ++pending;
+            }
+        }
+    };
+
+    std::vector<size_t> expandedIn(n, 0); // Phase that last expanded the vertex
+    std::vector<size_t> settledIn(n, 0);  // Bucket (plus one) that last settled the vertex
+    std::vector<int> frontier;
+    std::vector<int> settled;
+    size_t phase = 0;
+    for (size_t current = 0; pending > 0; ++current)
+    {
+        std::vector<int> &bucket = buckets[current % slots];
+        settled.clear();
+        while (!bucket.empty())
+        {
+            CancellationToken::checkpoint();
+            ++phase;
+            frontier.clear();
+            for (int v : bucket)
+            {
+                if (static_cast<size_t>(tentative[v].load(std::memory_order_relaxed) / delta) == current &&
+                    expandedIn[v] != phase)
+                {
+                    expandedIn[v] = phase;
+                    frontier.push_back(v);
+                    if (settledIn[v] != current + 1)
+                    {
+                        settledIn[v] = current + 1;
+                        settled.push_back(v);
+                    }
+                }
+            }
+            pending -= bucket.size();
+            bucket.clear();
+            relax(frontier, true);
+        }
+        relax(settled, false);
+    }
+
+    distances.resize(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        distances[i] = tentative[i].load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include "CSRGraph.hpp"
+#include "WorkerPool.hpp"
+#include <cstddef>
+#include <vector>
+
+// Distances from one source, reduced to a few numbers for batch answers
+struct ShortestPathSummary
+{
+    int source = -1;
+    int reached = 0;              // Vertices with a path from source, source included
+    long long eccentricity = 0;   // Distance to the farthest of them
+    int farthest = -1;
+    double averageDistance = 0.0; // Mean distance to the reached vertices other than source
+};
+
+// Single-source shortest paths over the whole graph (not just its MST), on a CSR snapshot.
+//
+// Small graphs use Dijkstra's algorithm with a binary heap; a batch of sources is spread over the
+// threads, one source per thread at a time. Graphs of at least parallelThreshold vertices use
+// delta-stepping: tentative distances are grouped into buckets of width delta, and all vertices of the
+// lowest bucket are expanded at once, their arcs split over the threads. Arcs of weight up to delta may
+// put vertices back into the same bucket and are relaxed until it stays empty; heavier arcs only reach
+// later buckets and are relaxed once per bucket. Distances are lowered with compare-and-swap.
+//
+// Negative weights are rejected: in an undirected graph a negative edge is already a negative cycle.
+class ShortestPaths
+{
+public:
+    static const size_t parallelThreshold = 50000;
+    static const size_t maxBatchSources = 1024;
+
+    // Runs on at most threads threads of pool (0 = all of them; no pool = one thread).
+    // Throws std::invalid_argument if graph has a negative weight.
+    explicit ShortestPaths(const CSRGraph &graph, WorkerPool *pool = nullptr, size_t threads = 0);
+
+    // Distance from source to every vertex, indexed like the CSR (-1 if there is no path).
+    // Throws std::invalid_argument for an unknown source.
+    std::vector<long long> run(int source);
+    // Vertex IDs of one shortest path from source to target, given run(source)'s distances; empty if none
+    std::vector<int> path(const std::vector<long long> &distances, int source, int target) const;
+    // Summaries of the distances from each source, in the given order
+    std::vector<ShortestPathSummary> runBatch(const std::vector<int> &sources);
+
+    const CSRGraph &getGraph() const { return graph; }
+    // Details of the last run or batch
+    const char *getAlgorithm() const { return parallel ? "delta-stepping" : "dijkstra"; }
+    long long getDelta() const { return parallel ? delta : 0; }
+    size_t getThreads() const { return threadsUsed; }
+    double getMilliseconds() const { return milliseconds; }
+
+private:
+    const CSRGraph &graph;
+    WorkerPool *pool;   // Shared with other queries; null when only one thread is allowed
+    size_t threadLimit; // Most threads of pool one batch may use
+    bool parallel;      // Delta-stepping rather than Dijkstra
+    long long delta;
+    size_t threadsUsed = 1;
+    double milliseconds = 0.0;
+
+    size_t sourceIndex(int source) const;
+    void deltaStepping(size_t source, std::vector<long long> &distances);
+};
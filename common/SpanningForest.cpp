@@ -0,0 +1,89 @@
+// This file implements the SpanningForest helpers shared by the MST algorithms.
+
+#include "SpanningForest.hpp"
+#include <algorithm>
+
+// Returns a copy of the edges of one component
+std::vector<Edge> SpanningForest::getComponentEdges(size_t component) const
+{
+    return std::vector<Edge>(edges.begin() + componentOffsets[component],
+                             edges.begin() + componentOffsets[component + 1]);
+}
+
+// Labels the connected components of the graph with a breadth-first search from every unlabeled vertex
+void SpanningForest::assignComponents(const Graph &graph)
+{
+    componentOf.clear();
+    componentSizes.clear();
+    componentRoots.clear();
+    componentOf.reserve(graph.getVertices());
+
+    std::vector<int> frontier;
+    for (int root : graph.getVertexIds())
+    {
+        if (componentOf.count(root))
+        {
+            continue;
+        }
+        int component = static_cast<int>(componentSizes.size());
+        componentRoots.push_back(root);
+        componentSizes.push_back(0);
+
+        componentOf[root] = component;
+        frontier.assign(1, root);
+        while (!frontier.empty())
+        {
+            int u = frontier.back();
+            frontier.pop_back();
+            ++componentSizes[component];
+            for (const Edge &edge : graph.getAdjacentEdges(u))
+            {
+                if (componentOf.emplace(edge.destination, component).second)
+                {
+                    frontier.push_back(edge.destination);
+                }
+            }
+        }
+    }
+}
+
+// Buckets forest edges by component (components must already be assigned) and fills the offsets
+void SpanningForest::groupEdges(const std::vector<Edge> &forestEdges)
+{
+    size_t count = componentSizes.size();
+    componentOffsets.assign(count + 1, 0);
+    for (const Edge &edge : forestEdges)
+    {
+        ++componentOffsets[componentOf.at(edge.source) + 1];
+    }
+    for (size_t c = 0; c < count; ++c)
+    {
+        componentOffsets[c + 1] += componentOffsets[c];
+    }
+
+    std::vector<size_t> next(componentOffsets.begin(), componentOffsets.end() - 1);
+    edges.assign(forestEdges.size(), Edge(0, 0, 0));
+    for (const Edge &edge : forestEdges)
+    {
+        edges[next[componentOf.at(edge.source)]++] = edge;
+    }
+}
+
+// Returns the sorted vertex IDs of every component
+std::vector<std::vector<int>> SpanningForest::getComponentVertices() const
+{
+    std::vector<std::vector<int>> vertices(componentSizes.size());
+    for (size_t c = 0; c < componentSizes.size(); ++c)
+    {
+        vertices[c].reserve(componentSizes[c]);
+    }
+    for (const auto &pair : componentOf)
+    {
+        vertices[pair.second].push_back(pair.first);
+    }
+    for (auto &list : vertices)
+    {
+        std::sort(list.begin(), list.end());
+    }
+    return vertices;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "Graph.hpp"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// Minimum spanning forest: one minimum spanning tree per connected component.
+// Components are numbered by their smallest vertex ID, in ascending order.
+struct SpanningForest
+{
+    std::vector<Edge> edges;                 // Forest edges, grouped by component
+    std::vector<size_t> componentOffsets;    // Edges of component c are [offsets[c], offsets[c + 1])
+    std::vector<int> componentSizes;         // Number of vertices in each component
+    std::vector<int> componentRoots;         // Smallest vertex ID of each component
+    std::unordered_map<int, int> componentOf; // Vertex ID -> component ID
+
+    size_t getComponentCount() const { return componentSizes.size(); }
+    std::vector<Edge> getComponentEdges(size_t component) const;
+    void assignComponents(const Graph &graph);
+    void groupEdges(const std::vector<Edge> &forestEdges);
+    std::vector<std::vector<int>> getComponentVertices() const;
+};
@@ -0,0 +1,209 @@
+// This file implements the WeightKernels class: scalar and AVX2 reductions over edge weights.
+
+#include "WeightKernels.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WEIGHT_KERNELS_AVX2 1
+#endif
+
+namespace
+{
+    using Summary = WeightKernels::Summary;
+
+    // Edge is read as three packed ints; its weight is the third
+    static_assert(sizeof(Edge) == 3 * sizeof(int), "Edge weight gathers assume three packed ints");
+    const size_t edgeStride = 3;
+    const size_t weightOffset = 2;
+
+    struct Implementation
+    {
+        const char *name;
+        Summary (*summarize)(const int *weights, size_t count, size_t stride);
+        void (*histogram)(const int *weights, size_t count, int base, double width, int *counts, size_t buckets);
+    };
+
+    void add(Summary &summary, int weight)
+    {
+        summary.sum += weight;
+        summary.min = std::min(summary.min, weight);
+        summary.max = std::max(summary.max, weight);
+    }
+
+    // Bucket arithmetic is done in double, clamped before truncation, so both versions agree exactly
+    size_t bucketOf(int weight, double base, double width, double last)
+    {
+        double offset = (static_cast<double>(weight) - base) / width;
+        return static_cast<size_t>(std::min(std::max(offset, 0.0), last));
+    }
+
+    Summary summarizeScalar(const int *weights, size_t count, size_t stride)
+    {
+        Summary summary;
+        for (size_t i = 0; i < count; ++i)
+        {
+            add(summary, weights[i * stride]);
+        }
+        return summary;
+    }
+
+    void histogramScalar(const int *weights, size_t count, int base, double width, int *counts, size_t buckets)
+    {
+        double last = static_cast<double>(buckets - 1);
+        for (size_t i = 0; i < count; ++i)
+        {
+            ++counts[bucketOf(weights[i], base, width, last)];
+        }
+    }
+
+    const Implementation scalarImplementation{"scalar", summarizeScalar, histogramScalar};
+
+#ifdef WEIGHT_KERNELS_AVX2
+    // Eight lanes of minimum and maximum, and two sets of four 64-bit sums so totals cannot overflow
+    __attribute__((target("avx2"))) Summary summarizeAvx2(const int *weights, size_t count, size_t stride)
+    {
+        __m256i minimum = _mm256_set1_epi32(INT_MAX);
+        __m256i maximum = _mm256_set1_epi32(INT_MIN);
+        __m256i sumLow = _mm256_setzero_si256();
+        __m256i sumHigh = _mm256_setzero_si256();
+        const __m256i gatherIndex = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8)
+        {
+            __m256i w = stride == 1 ? _mm256_loadu_si256(reinterpret_cast<const __m256i *>(weights + i))
+                                    : _mm256_i32gather_epi32(weights + i * stride, gatherIndex, 4);
+            minimum = _mm256_min_epi32(minimum, w);
+            maximum = _mm256_max_epi32(maximum, w);
+            sumLow = _mm256_add_epi64(sumLow, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(w)));
+            sumHigh = _mm256_add_epi64(sumHigh, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(w, 1)));
+        }
+
+        alignas(32) int32_t minimums[8], maximums[8];
+        alignas(32) int64_t sums[4];
+        _mm256_store_si256(reinterpret_cast<__m256i *>(minimums), minimum);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(maximums), maximum);
+        _mm256_store_si256(reinterpret_cast<__m256i *>(sums), _mm256_add_epi64(sumLow, sumHigh));
+        Summary summary;
+        summary.sum = sums[0] + sums[1] + sums[2] + sums[3];
+        summary.min = *std::min_element(minimums, minimums + 8);
+        summary.max = *std::max_element(maximums, maximums + 8);
+        for (; i < count; ++i)
+        {
+            add(summary, weights[i * stride]);
+        }
+        return summary;
+    }
+
+    // Bucket indices are computed four at a time; the increments stay scalar (AVX2 has no scatter)
+    __attribute__((target("avx2"))) void histogramAvx2(const int *weights, size_t count, int base, double width,
+                                                      int *counts, size_t buckets)
+    {
+        const __m256d baseVector = _mm256_set1_pd(static_cast<double>(base));
+        const __m256d widthVector = _mm256_set1_pd(width);
+        const __m256d zero = _mm256_setzero_pd();
+        const double last = static_cast<double>(buckets - 1);
+        const __m256d lastVector = _mm256_set1_pd(last);
+        alignas(16) int32_t index[4];
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+        {
+            __m256d w = _mm256_cvtepi32_pd(_mm_loadu_si128(reinterpret_cast<const __m128i *>(weights + i)));
+            __m256d offset = _mm256_div_pd(_mm256_sub_pd(w, baseVector), widthVector);
+            offset = _mm256_min_pd(_mm256_max_pd(offset, zero), lastVector);
+            _mm_store_si128(reinterpret_cast<__m128i *>(index), _mm256_cvttpd_epi32(offset));
+            ++counts[index[0]];
+            ++counts[index[1]];
+            ++counts[index[2]];
+            ++counts[index[3]];
+        }
+        for (; i < count; ++i)
+        {
+            ++counts[bucketOf(weights[i], base, width, last)];
+        }
+    }
+
+    const Implementation avx2Implementation{"avx2", summarizeAvx2, histogramAvx2};
+#endif
+
+    bool avx2Supported()
+    {
+#ifdef WEIGHT_KERNELS_AVX2
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+    }
+
+    const Implementation *fastest()
+    {
+#ifdef WEIGHT_KERNELS_AVX2
+        if (avx2Supported())
+        {
+            return &avx2Implementation;
+        }
+#endif
+        return &scalarImplementation;
+    }
+
+    std::atomic<const Implementation *> &active()
+    {
+        static std::atomic<const Implementation *> current(fastest());
+        return current;
+    }
+}
+
+WeightKernels::Summary WeightKernels::summarize(const int *weights, size_t count)
+{
+    return active().load(std::memory_order_relaxed)->summarize(weights, count, 1);
+}
+
+WeightKernels::Summary WeightKernels::summarize(const std::vector<Edge> &edges)
+{
+    if (edges.empty())
+    {
+        return Summary();
+    }
+    const int *weights = reinterpret_cast<const int *>(edges.data()) + weightOffset;
+    return active().load(std::memory_order_relaxed)->summarize(weights, edges.size(), edgeStride);
+}
+
+void WeightKernels::histogram(const int *weights, size_t count, int base, double width, std::vector<int> &counts)
+{
+    if (!(width > 0))
+    {
+        counts[0] += static_cast<int>(count);
+        return;
+    }
+    active().load(std::memory_order_relaxed)->histogram(weights, count, base, width, counts.data(), counts.size());
+}
+
+const char *WeightKernels::getImplementation()
+{
+    return active().load(std::memory_order_relaxed)->name;
+}
+
+bool WeightKernels::setImplementation(const std::string &name)
+{
+    if (name == "auto")
+    {
+        active().store(fastest());
+        return true;
+    }
+    if (name == "scalar")
+    {
+        active().store(&scalarImplementation);
+        return true;
+    }
+#ifdef WEIGHT_KERNELS_AVX2
+    if (name == "avx2" && avx2Supported())
+    {
+        active().store(&avx2Implementation);
+        return true;
+    }
+#endif
+    return false;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "Graph.hpp"
+#include <climits>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Reductions over edge weights: sum, minimum and maximum in one pass, and bucket counts. Each kernel has
+// a portable scalar version and an AVX2 version; the AVX2 one is chosen at run time when the CPU
+// supports it, and both produce exactly the same results.
+//
+// The kernels read weights from a contiguous int array (see EdgeColumns). The Edge overload reads the
+// weight field of each Edge in place; the AVX2 version gathers eight weights at a time.
+class WeightKernels
+{
+public:
+    struct Summary
+    {
+        long long sum = 0;
+        int min = INT_MAX; // INT_MAX / INT_MIN when there are no weights
+        int max = INT_MIN;
+    };
+
+    static Summary summarize(const int *weights, size_t count);
+    static Summary summarize(const std::vector<Edge> &edges);
+
+    // Adds each weight w to counts[(w - base) / width], clamped to the existing buckets; with a width of
+    // zero or less every weight lands in bucket 0. counts must not be empty.
+    static void histogram(const int *weights, size_t count, int base, double width, std::vector<int> &counts);
+
+    // "avx2" or "scalar"
+    static const char *getImplementation();
+    // Selects "auto" (the fastest the CPU supports), "avx2" or "scalar"; false if unavailable
+    static bool setImplementation(const std::string &name);
+};
@@ -0,0 +1,109 @@
+// This file implements WorkerPool, the fork-join helper threads of the APSP and shortest path engines.
+
+#include "WorkerPool.hpp"
+#include <algorithm>
+
+// Constructor: starts threads - 1 helpers that sleep until the first batch
+WorkerPool::WorkerPool(size_t threads) : stopping(false)
+{
+    for (size_t i = 1; i < threads; ++i)
+    {
+        helpers.emplace_back(&WorkerPool::run, this);
+    }
+}
+
+// Destructor: wakes the helpers for the last time and waits for them to exit
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto &helper : helpers)
+    {
+        helper.join();
+    }
+}
+
+void WorkerPool::forEach(size_t count, const std::function<void(size_t)> &work, size_t maxThreads)
+{
+    size_t threads = maxThreads == 0 ? getThreadCount() : std::min(maxThreads, getThreadCount());
+    Batch batch{&work, count, 0, count, threads - 1, 0};
+    std::unique_lock<std::mutex> lock(mutex);
+    if (batch.helperLimit > 0 && count > 1)
+    {
+        open.push_back(&batch);
+        wake.notify_all();
+    }
+
+    // The caller keeps claiming items of its own batch; helpers may still be finishing theirs after
+    size_t index;
+    while (claim(batch, index))
+    {
+        lock.unlock();
+        work(index);
+        lock.lock();
+        --batch.unfinished;
+    }
+    done.wait(lock, [&batch]()
+              { return batch.unfinished == 0; });
+}
+
+// Takes the next item of batch; the batch leaves the open list with its last item. Called under the lock.
+bool WorkerPool::claim(Batch &batch, size_t &index)
+{
+    if (batch.next == batch.count)
+    {
+        return false;
+    }
+    index = batch.next++;
+    if (batch.next == batch.count)
+    {
+        open.remove(&batch);
+    }
+    return true;
+}
+
+// The first open batch that may take another helper, moved to the back so that the next helper
+// prefers another one. Called under the lock.
+WorkerPool::Batch *WorkerPool::pick()
+{
+    for (auto it = open.begin(); it != open.end(); ++it)
+    {
+        if ((*it)->helping < (*it)->helperLimit)
+        {
+            Batch *batch = *it;
+            open.splice(open.end(), open, it);
+            return batch;
+        }
+    }
+    return nullptr;
+}
+
+// Helper thread loop: one item of some open batch at a time
+void WorkerPool::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        Batch *batch = nullptr;
+        wake.wait(lock, [this, &batch]()
+                  { return stopping || (batch = pick()) != nullptr; });
+        if (stopping)
+        {
+            return;
+        }
+        size_t index;
+        claim(*batch, index);
+        ++batch->helping;
+        lock.unlock();
+        (*batch->work)(index);
+        lock.lock();
+        --batch->helping;
+        if (--batch->unfinished == 0)
+        {
+            done.notify_all();
+        }
+    }
+}
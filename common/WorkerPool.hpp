@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads shared by any number of callers, each running a batch of independent work items. A caller
+// works on its own batch too and may cap how many threads help it; the helpers take turns between
+// the open batches, one item at a time. Items must not throw: an exception would leave the helpers
+// running a batch whose caller is gone.
+class WorkerPool
+{
+public:
+    // threads counts the caller, so a pool of 1 starts no threads and runs everything inline
+    explicit WorkerPool(size_t threads);
+    ~WorkerPool();
+
+    // Calls work(i) for every i in [0, count) on at most maxThreads threads, the caller included
+    // (0 = all of them), and returns once all calls have finished. Several threads may call it at once.
+    void forEach(size_t count, const std::function<void(size_t)> &work, size_t maxThreads = 0);
+    size_t getThreadCount() const { return helpers.size() + 1; }
+
+private:
+    struct Batch
+    {
+        const std::function<void(size_t)> *work;
+        size_t count;
+        size_t next;        // First unclaimed item
+        size_t unfinished;  // Items not yet completed
+        size_t helperLimit; // Most helpers working on the batch at once
+        size_t helping;
+    };
+
+    std::list<Batch *> open; // Batches with unclaimed items, in the order helpers turn to them
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::vector<std::thread> helpers;
+
+    bool claim(Batch &batch, size_t &index);
+    Batch *pick();
+    void run();
+};
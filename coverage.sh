@@ -38,10 +38,10 @@ if is_port_in_use; then
 fi
 
 # Update server code with new port
-sed -i "s/Server server([0-9]\+)/Server server($PORT)/" server/src/main.cpp
+sed -i "s/Server server([0-9]\+/Server server($PORT/" server/src/main.cpp
 
 # Compile the program with coverage flags
-if ! make CXXFLAGS="-std=c++17 -Wall -Wextra -pthread -Icommon -fprofile-arcs -ftest-coverage --coverage"; then
+if ! make CXXFLAGS="-std=c++20 -Wall -Wextra -pthread -Icommon -fprofile-arcs -ftest-coverage --coverage"; then
     echo "Compilation failed. Please fix the errors and try again."
     exit 1
 fi
@@ -55,7 +55,7 @@ fi
 # Function to run server and restart if it crashes
 run_server() {
     while true; do
-        ./server_exe &
+        ./server_exe --sssp-threads 2 &
         SERVER_PID=$!
         wait $SERVER_PID
         if [ $? -eq 0 ]; then
@@ -69,8 +69,9 @@ run_server() {
 # Run server in background
 run_server &
 
-# Wait for server to start
+# Wait for server to start (run_server sets SERVER_PID only in its own subshell)
 sleep 2
+SERVER_PID=$(pgrep -n -x server_exe)
 
 # Function to send a command to the server
 send_command() {
@@ -79,6 +80,20 @@ send_command() {
     sleep 0.5
 }
 
+# Function to send a command and check that the response contains the expected text
+# (an optional third argument gives slow commands more than one idle second)
+FAILURES=0
+expect_response() {
+    local response
+    response=$(printf '%s\n' "$1" | nc -w ${3:-1} localhost $PORT)
+    if echo "$response" | grep -q -- "$2"; then
+        echo "OK: $1"
+    else
+        echo "FAILED: $1 (expected \"$2\", got \"$response\")"
+        FAILURES=$((FAILURES+1))
+    fi
+}
+
 # Run test commands
 commands=(
     "add_vertex"
@@ -117,18 +132,46 @@ commands=(
     "calculate_mst invalid_algorithm"
     "get_adjacent_vertices 10"
     "remove_vertex 10"
+    "generate tree 50 20 seed 7"
+    "calculate_mst kruskal"
+    "shortest_path 0 49"
+    "shortest_paths 0 10 20"
+    "generate random 60000 0.0001 seed 7"
+    "shortest_paths 0 100 200"
+    "generate nope"
     "quit"
 )
 
 for cmd in "${commands[@]}"; do
     send_command "$cmd"
     if ! kill -0 $SERVER_PID 2>/dev/null; then
-        echo "Server crashed. Restarting..."
-        run_server &
+        echo "Server crashed. Waiting for it to restart..."
         sleep 2
+        SERVER_PID=$(pgrep -n -x server_exe)
     fi
 done
 
+# Check the MST, metrics and query responses on a forest of two trees (vertices 0-49 and 50-51)
+expect_response "generate tree 50 20 seed 7" "50 vertices, 69 edges"
+expect_response $'add_vertex\nadd_vertex\nadd_edge 50 51 4' "Edge added successfully"
+expect_response "calculate_mst kruskal forest" "Components: 2"
+expect_response "calculate_mst prim forest edges" "^50 51 4$"
+expect_response "metrics_mst prim forest" "Component 1: vertices=2 edges=1 weight=4"
+expect_response "metrics_mst kruskal" "Longest Distance: 627"
+expect_response "metrics_mst prim full" "Diameter: 627"
+expect_response "metrics_mst prim approx" "MST Metrics (approximate)"
+expect_response "mst_path 0 49" "(distance: 512)"
+expect_response "mst_distance 50 51" "MST distance between 50 and 51: 4"
+expect_response "mst_bottleneck 50 51" "\[weight: 4\]"
+expect_response "mst_distance 0 50" "are not connected"
+expect_response "mst_batch distance 0 49 50 51" "^0 49 512$"
+
+# Tagged requests are answered in frames; deadlines and cancel stop a running request
+expect_response $'#1 mst_distance 50 51\n#2 health' "^#1 34$"
+expect_response $'#2 health\n#1 mst_distance 50 51' "^#2 [0-9]"
+expect_response $'use_graph scratch\ndeadline 1\ngenerate random 200000 0.0001 seed 3' "Request deadline exceeded"
+expect_response $'use_graph scratch\n#9 generate random 200000 0.0001 seed 3\ncancel 9' "Request cancelled"
+
 # Kill the server
 echo "Stopping server..."
 kill -SIGINT $SERVER_PID
@@ -140,6 +183,28 @@ if kill -0 $SERVER_PID 2>/dev/null; then
     kill -9 $SERVER_PID
 fi
 
+# With one-task stage queues, requests that arrive while the first one runs are refused
+./server_exe --io-threads 1 --shards 1 --queue-capacity 1 &
+BUSY_PID=$!
+sleep 2
+expect_response "generate random 20000 0.001 seed 7" "20000 vertices" 10
+expect_response "$(for i in $(seq 1 8); do echo "#$i calculate_mst prim edges"; done)" "Server busy, try again later"
+kill -SIGINT $BUSY_PID
+wait $BUSY_PID
+
+# A failed mutation log write makes the graph read-only. Files may not grow past 1 KB here
+# (SIGXFSZ is ignored, so the write fails with EFBIG instead of killing the server).
+DATA_DIR=$(mktemp -d)
+(trap '' XFSZ; ulimit -f 1; exec ./server_exe --data-dir "$DATA_DIR") &
+DURABLE_PID=$!
+sleep 2
+for i in $(seq 1 100); do echo "add_vertex"; done | nc -w 2 localhost $PORT > /dev/null
+expect_response "add_vertex" "read-only until the server restarts"
+expect_response "remove_vertex 0" "read-only until the server restarts"
+kill -SIGINT $DURABLE_PID
+wait $DURABLE_PID
+rm -rf "$DATA_DIR"
+
 # Wait a moment to ensure all files are written
 sleep 2
 
@@ -154,3 +219,8 @@ genhtml coverage.info --output-directory coverage_report
 
 echo "Code coverage report generated in coverage_report/index.html"
 
+if [ $FAILURES -gt 0 ]; then
+    echo "$FAILURES response checks failed"
+    exit 1
+fi
+
@@ -1,10 +1,65 @@
 // This file implements the ActiveObject class, which provides a mechanism for asynchronous task execution.
 
 #include "ActiveObject.hpp"
+#include "CpuAffinity.hpp"
+#include <algorithm>
 #include <iostream>
 
-// Constructor: Initializes the ActiveObject with running set to false
-ActiveObject::ActiveObject() : running(false) {}
+const uint64_t ActiveObject::weights[ActiveObject::priorityCount] = {4, 2, 1};
+thread_local TaskClass ActiveObject::currentClass;
+thread_local bool ActiveObject::mayWait = true;
+
+ActiveObject::ClassScope::ClassScope(Priority priority, uint64_t flow) : previous(currentClass)
+{
+    currentClass = TaskClass{priority, flow};
+}
+
+ActiveObject::ClassScope::~ClassScope()
+{
+    currentClass = previous;
+}
+
+ActiveObject::NoWaitScope::NoWaitScope() : previous(mayWait)
+{
+    mayWait = false;
+}
+
+ActiveObject::NoWaitScope::~NoWaitScope()
+{
+    mayWait = previous;
+}
+
+const char *ActiveObject::getPriorityName(Priority priority)
+{
+    switch (priority)
+    {
+    case Priority::Interactive:
+        return "interactive";
+    case Priority::Batch:
+        return "batch";
+    default:
+        return "normal";
+    }
+}
+
+// Maps a class name from a command to the enum; returns false for unknown names
+bool ActiveObject::parsePriority(std::string_view name, Priority &priority)
+{
+    for (Priority candidate : {Priority::Interactive, Priority::Normal, Priority::Batch})
+    {
+        if (name == getPriorityName(candidate))
+        {
+            priority = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Constructor: Initializes the ActiveObject with a queue bound (0 = unbounded) and overflow policy
+ActiveObject::ActiveObject(size_t cap, OverflowPolicy pol)
+    : queuedCount(0), virtualTime(0), capacity(cap), policy(pol), rejectedCount(0), droppedCount(0), running(false),
+      stopping(false), executing(false) {}
 
 // Destructor: Ensures that the ActiveObject is stopped before destruction
 ActiveObject::~ActiveObject()
@@ -12,14 +67,112 @@ ActiveObject::~ActiveObject()
     stop();
 }
 
-// Enqueues a task for later execution
-void ActiveObject::enqueue(std::function<void()> task)
+// Enqueues a task for later execution. When the queue is full the overflow policy decides:
+// Block waits for space (or refuses, inside a NoWaitScope), Reject returns false, DropOldest sheds the
+// oldest task of the lowest class with queued work (calling its onDropped). Once the worker is stopping
+// every task is refused, since nothing would run it.
+bool ActiveObject::enqueue(std::function<void()> task, std::function<void()> onDropped)
 {
+    std::function<void()> shed;
     {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        taskQueue.push(std::move(task));
+        std::unique_lock<std::mutex> lock(queueMutex);
+        if (stopping)
+        {
+            ++rejectedCount;
+            return false;
+        }
+        if (capacity > 0 && queuedCount >= capacity)
+        {
+            if (policy == OverflowPolicy::Block && mayWait)
+            {
+                spaceCondition.wait(lock, [this]
+                                    { return queuedCount < capacity || stopping; });
+                if (stopping)
+                {
+                    ++rejectedCount;
+                    return false;
+                }
+            }
+            else if (policy != OverflowPolicy::DropOldest)
+            {
+                ++rejectedCount;
+                return false;
+            }
+            else if (shedOne(shed))
+            {
+                ++droppedCount;
+            }
+            else
+            {
+                // Everything queued is fan-out work that must not be shed
+                ++rejectedCount;
+                return false;
+            }
+        }
+        push(Task{std::move(task), std::move(onDropped), std::chrono::steady_clock::now(), currentClass, true});
     }
     condition.notify_one(); // Notify the worker thread that a new task is available
+
+    // Tell the owner of the shed task outside the lock; it usually sends a busy response
+    if (shed)
+    {
+        shed();
+    }
+    return true;
+}
+
+// Enqueues a task only if there is room right now, whatever the overflow policy.
+// Used for fan-out from worker threads, which must never block on another worker's queue.
+// On success the task is moved from; on failure it is left untouched so the caller can run it.
+// Such a task is part of a request that is already running, so shed-oldest never drops it: its
+// siblings would wait for it forever.
+bool ActiveObject::tryEnqueue(std::function<void()> &task)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (!running || stopping || (capacity > 0 && queuedCount >= capacity))
+        {
+            return false;
+        }
+        push(Task{std::move(task), nullptr, std::chrono::steady_clock::now(), currentClass, false});
+    }
+    condition.notify_one();
+    return true;
+}
+
+// Returns the number of tasks waiting to run
+size_t ActiveObject::getQueueDepth() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queuedCount;
+}
+
+// Returns the number of tasks waiting or running; a worker busy with a long task has load 1 even
+// though its queue is empty
+size_t ActiveObject::getLoad() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queuedCount + (executing ? 1 : 0);
+}
+
+// Returns how many tasks were refused because the queue was full
+uint64_t ActiveObject::getRejectedCount() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return rejectedCount;
+}
+
+// Returns how many queued tasks were shed to make room for newer ones
+uint64_t ActiveObject::getDroppedCount() const
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return droppedCount;
+}
+
+// Pins the worker thread to the given CPUs when it starts (call before start)
+void ActiveObject::setAffinity(const std::vector<int> &cpuList)
+{
+    cpus = cpuList;
 }
 
 // Starts the ActiveObject's worker thread
@@ -32,8 +185,13 @@ void ActiveObject::start()
             return; // Already running, do nothing
         }
         running = true;
+        stopping = false;
     }
     workerThread = std::thread(&ActiveObject::run, this); // Start the worker thread
+    if (!cpus.empty() && !CpuAffinity::pin(workerThread, cpus))
+    {
+        std::cerr << "Could not pin worker thread to CPUs " << CpuAffinity::formatCpuList(cpus) << std::endl;
+    }
 }
 
 // Stops the ActiveObject's worker thread
@@ -41,12 +199,14 @@ void ActiveObject::stop()
 {
     {
         std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
         if (!running)
         {
             return;
         }
         running = false;
         condition.notify_one();
+        spaceCondition.notify_all(); // Release producers blocked on a full queue
     }
     if (workerThread.joinable())
     {
@@ -60,35 +220,40 @@ void ActiveObject::run()
     while (true)
     {
         // Declare a function object to hold the task
-        std::function<void()> task;
+        Task task;
         {
             // Lock the queue mutex to safely access shared data
             std::unique_lock<std::mutex> lock(queueMutex);
 
             // Wait until there's a task in the queue or the thread is stopped
             condition.wait(lock, [this]
-                           { return !taskQueue.empty() || !running; });
+                           { return queuedCount > 0 || !running; });
 
             // If the thread is stopped and there are no tasks, exit the loop
-            if (!running && taskQueue.empty())
+            if (!running && queuedCount == 0)
             {
                 break; // Exit the loop if stopped and no tasks left
             }
 
             // If there's a task in the queue, move it to our local variable
-            if (!taskQueue.empty())
+            if (queuedCount > 0)
             {
-                task = std::move(taskQueue.front());
-                taskQueue.pop();
+                task = pop();
+                queueWait.recordSince(task.enqueued);
+                classWait[static_cast<int>(task.taskClass.priority)].recordSince(task.enqueued);
+                executing = true;
             }
         } // The lock is released here
+        spaceCondition.notify_one(); // A slot is free for a blocked producer
 
         // If we got a task, execute it
-        if (task)
+        if (task.run)
         {
+            auto started = std::chrono::steady_clock::now();
             try
             {
-                task(); // Execute the task
+                ClassScope scope(task.taskClass.priority, task.taskClass.flow);
+                task.run(); // Execute the task
             }
             catch (const std::exception &e)
             {
@@ -100,6 +265,109 @@ void ActiveObject::run()
                 // Handle any other types of exceptions
                 std::cerr << "Unknown exception in task execution" << std::endl;
             }
+            auto elapsed = std::chrono::steady_clock::now() - started;
+            uint64_t micros = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+            serviceTime.record(micros);
+            std::lock_guard<std::mutex> lock(queueMutex);
+            charge(task.taskClass.priority, micros);
+            executing = false;
         }
     }
-}
\ No newline at end of file
+}
+
+// Queues a task behind the other tasks of its flow (call with queueMutex held). A class that was idle
+// rejoins at the current virtual time, so it cannot claim the service it missed while idle.
+void ActiveObject::push(Task task)
+{
+    ClassQueue &queue = classes[static_cast<int>(task.taskClass.priority)];
+    if (queue.size == 0)
+    {
+        queue.pass = std::max(queue.pass, virtualTime);
+    }
+    auto flow = std::find_if(queue.flows.begin(), queue.flows.end(), [&task](const Flow &f)
+                             { return f.id == task.taskClass.flow; });
+    if (flow == queue.flows.end())
+    {
+        queue.flows.push_back(Flow{task.taskClass.flow, {}});
+        flow = queue.flows.end() - 1;
+    }
+    flow->tasks.push_back(std::move(task));
+    ++queue.size;
+    ++queuedCount;
+}
+
+// Takes the next task (call with queueMutex held and work queued): from the class with the smallest
+// pass, ties going to the higher class, and from the flow whose turn it is
+ActiveObject::Task ActiveObject::pop()
+{
+    ClassQueue *next = nullptr;
+    for (ClassQueue &queue : classes)
+    {
+        if (queue.size > 0 && (!next || queue.pass < next->pass))
+        {
+            next = &queue;
+        }
+    }
+    virtualTime = next->pass;
+
+    Flow &flow = next->flows.front();
+    Task task = std::move(flow.tasks.front());
+    flow.tasks.pop_front();
+    if (flow.tasks.empty())
+    {
+        next->flows.pop_front();
+    }
+    else
+    {
+        // One task per turn: the flow goes to the back of the line
+        next->flows.push_back(std::move(flow));
+        next->flows.pop_front();
+    }
+    --next->size;
+    --queuedCount;
+    return task;
+}
+
+// Removes the oldest sheddable task of the lowest class that has one and hands out its onDropped
+// callback (call with queueMutex held). Returns false if no queued task may be shed.
+bool ActiveObject::shedOne(std::function<void()> &onDropped)
+{
+    for (int c = priorityCount - 1; c >= 0; --c)
+    {
+        ClassQueue &queue = classes[c];
+        auto oldestFlow = queue.flows.end();
+        std::deque<Task>::iterator oldest;
+        for (auto flow = queue.flows.begin(); flow != queue.flows.end(); ++flow)
+        {
+            auto candidate = std::find_if(flow->tasks.begin(), flow->tasks.end(), [](const Task &task)
+                                          { return task.sheddable; });
+            if (candidate != flow->tasks.end() && (oldestFlow == queue.flows.end() || candidate->enqueued < oldest->enqueued))
+            {
+                oldestFlow = flow;
+                oldest = candidate;
+            }
+        }
+        if (oldestFlow == queue.flows.end())
+        {
+            continue;
+        }
+        onDropped = std::move(oldest->onDropped);
+        oldestFlow->tasks.erase(oldest);
+        if (oldestFlow->tasks.empty())
+        {
+            queue.flows.erase(oldestFlow);
+        }
+        --queue.size;
+        --queuedCount;
+        return true;
+    }
+    return false;
+}
+
+// Advances the class's virtual time by the service it just received, scaled by 1 / weight
+// (call with queueMutex held)
+void ActiveObject::charge(Priority priority, uint64_t microseconds)
+{
+    int c = static_cast<int>(priority);
+    classes[c].pass += std::max<uint64_t>(microseconds, 1) * weights[0] / weights[c];
+}
@@ -1,25 +1,149 @@
 #pragma once
-#include <queue>
+#include "LatencyHistogram.hpp"
+#include <array>
+#include <chrono>
+#include <deque>
 #include <mutex>
 #include <condition_variable>
 #include <functional>
 #include <thread>
+#include <cstdint>
+#include <string_view>
+#include <vector>
 
+// What enqueue does when the task queue is full
+enum class OverflowPolicy
+{
+    Block,     // wait until the worker frees a slot
+    Reject,    // refuse the new task
+    DropOldest // discard the oldest queued task to make room
+};
+
+// Scheduling classes. Each class gets a share of a worker's time in proportion to its weight
+// (interactive 4, normal 2, batch 1) while it has queued work.
+enum class Priority
+{
+    Interactive,
+    Normal,
+    Batch
+};
+
+// Who a task is queued for: its class, and the flow (client connection) it belongs to
+struct TaskClass
+{
+    Priority priority = Priority::Normal;
+    uint64_t flow = 0;
+};
+
+// A worker thread with a bounded task queue. Queued tasks are scheduled by weighted fair queueing:
+// the class with the least weighted service so far goes next, and within a class the flows take
+// turns, one task each. A task's class is the one current on the thread that enqueued it (see
+// ClassScope); the worker makes it current while the task runs, so follow-up work stays in its class.
 class ActiveObject
 {
 public:
-    ActiveObject();
+    static const int priorityCount = 3;
+
+    // Makes a class current on this thread until the scope ends
+    class ClassScope
+    {
+    public:
+        ClassScope(Priority priority, uint64_t flow);
+        ~ClassScope();
+        ClassScope(const ClassScope &) = delete;
+        ClassScope &operator=(const ClassScope &) = delete;
+
+    private:
+        TaskClass previous;
+    };
+    // Until the scope ends, enqueue on this thread refuses a task instead of waiting for space under
+    // the Block policy. Reactor threads serve many connections and must not sleep on one full queue.
+    class NoWaitScope
+    {
+    public:
+        NoWaitScope();
+        ~NoWaitScope();
+        NoWaitScope(const NoWaitScope &) = delete;
+        NoWaitScope &operator=(const NoWaitScope &) = delete;
+
+    private:
+        bool previous;
+    };
+    static const TaskClass &getCurrentClass() { return currentClass; }
+    static const char *getPriorityName(Priority priority);
+    static bool parsePriority(std::string_view name, Priority &priority);
+
+    ActiveObject(size_t capacity = 0, OverflowPolicy policy = OverflowPolicy::Block);
     ~ActiveObject();
 
-    void enqueue(std::function<void()> task);
+    bool enqueue(std::function<void()> task, std::function<void()> onDropped = nullptr);
+    bool tryEnqueue(std::function<void()> &task);
+    void setAffinity(const std::vector<int> &cpus);
     void start();
     void stop();
+    size_t getQueueDepth() const;
+    size_t getLoad() const; // Queued tasks plus the one running, if any
+    std::thread::id getThreadId() const { return workerThread.get_id(); }
+    size_t getCapacity() const { return capacity; }
+    uint64_t getRejectedCount() const;
+    uint64_t getDroppedCount() const;
+    // How long tasks waited in the queue and how long they ran
+    const LatencyHistogram &getQueueWait() const { return queueWait; }
+    const LatencyHistogram &getQueueWait(Priority priority) const { return classWait[static_cast<int>(priority)]; }
+    const LatencyHistogram &getServiceTime() const { return serviceTime; }
 
 private:
-    std::queue<std::function<void()>> taskQueue;
-    std::mutex queueMutex;
+    // A queued task plus the callback to run if the task is shed before it executes
+    struct Task
+    {
+        std::function<void()> run;
+        std::function<void()> onDropped;
+        std::chrono::steady_clock::time_point enqueued;
+        TaskClass taskClass;
+        bool sheddable = true; // False for fan-out chunks of a running request
+    };
+
+    // The queued tasks of one flow
+    struct Flow
+    {
+        uint64_t id;
+        std::deque<Task> tasks;
+    };
+
+    // Queued work of one class. Flows with work take turns from the front; pass is the class's virtual
+    // time: its service so far, scaled by 1 / weight
+    struct ClassQueue
+    {
+        std::deque<Flow> flows;
+        size_t size = 0;
+        uint64_t pass = 0;
+    };
+
+    static const uint64_t weights[priorityCount];
+    static thread_local TaskClass currentClass;
+    static thread_local bool mayWait; // False inside a NoWaitScope
+
+    std::array<ClassQueue, priorityCount> classes;
+    size_t queuedCount;
+    uint64_t virtualTime; // Pass of the class served last; an idle class rejoins here
+    size_t capacity; // 0 = unbounded
+    OverflowPolicy policy;
+    uint64_t rejectedCount;
+    uint64_t droppedCount;
+    LatencyHistogram queueWait;
+    LatencyHistogram serviceTime;
+    std::array<LatencyHistogram, priorityCount> classWait;
+    mutable std::mutex queueMutex;
     std::condition_variable condition;
+    std::condition_variable spaceCondition;
     std::thread workerThread;
+    std::vector<int> cpus; // CPUs the worker is pinned to (empty = not pinned)
     bool running;
+    bool stopping;  // stop() was called: new tasks are refused
+    bool executing; // The worker is running a task
     void run();
-};
\ No newline at end of file
+    void push(Task task);
+    Task pop();
+    bool shedOne(std::function<void()> &onDropped);
+    void charge(Priority priority, uint64_t microseconds);
+};
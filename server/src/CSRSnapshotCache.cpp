@@ -0,0 +1,24 @@
+// This file implements CSRSnapshotCache, the per-graph cache of adjacency-array snapshots.
+
+#include "CSRSnapshotCache.hpp"
+
+std::shared_ptr<const CSRGraph> CSRSnapshotCache::get(const std::shared_ptr<const Graph> &graph, uint64_t version)
+{
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        if (snapshot && snapshotVersion >= version)
+        {
+            return snapshot;
+        }
+    }
+
+    // Built without the lock, so a slow conversion never blocks queries that can use the cached one
+    auto built = std::make_shared<const CSRGraph>(*graph);
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!snapshot || version > snapshotVersion)
+    {
+        snapshot = built;
+        snapshotVersion = version;
+    }
+    return built;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "../../common/CSRGraph.hpp"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+// Keeps the CSR form of one graph, tagged with the graph version it was built from, so shortest
+// path queries on an unchanged graph skip the conversion. Conversions run on the caller's thread
+// (a pipeline worker); two that race both finish and the newer one stays.
+class CSRSnapshotCache
+{
+public:
+    // The CSR snapshot of graph at version, reusing the cached one when it is at least that new
+    std::shared_ptr<const CSRGraph> get(const std::shared_ptr<const Graph> &graph, uint64_t version);
+
+private:
+    std::mutex cacheMutex;
+    std::shared_ptr<const CSRGraph> snapshot;
+    uint64_t snapshotVersion = 0;
+};
@@ -0,0 +1,432 @@
+// This file implements the Connection class, which serializes writes to a client socket.
+//
+// Tagged requests ("#<id> <command> ...") receive framed responses: "#<id> <length>\n<payload>".
+// A response streamed in pieces sends "#<id> +<length>\n<payload>" for every piece but the last.
+// Frames from different requests may arrive in any order; untagged requests get the raw payload.
+//
+// Responses are queued as reference-counted segments (frame header, payload pieces) and written with
+// non-blocking sendmsg() over an iovec, so headers are never prepended by copying the payload. A short
+// write resumes inside the segment where it stopped, once the reactor reports the socket writable.
+// Batches of at least zeroCopyThreshold bytes are sent with MSG_ZEROCOPY; their segments stay
+// referenced until the kernel reports completion on the socket's error queue.
+//
+// Pipeline workers never write: a streamed tree is queued as fast as it is rendered and the worker
+// returns to its stage loop. A client that lets more than maxQueuedBytes pile up is disconnected.
+
+#include "Connection.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <iostream>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+extern std::mutex coutMutex;
+
+std::atomic<uint64_t> Connection::nextId(1);
+
+// Constructor: takes ownership of the socket, makes it non-blocking and opts in to zero-copy sends
+// when available
+Connection::Connection(int s, Reactor &r, std::shared_ptr<const CancellationToken> parentToken)
+    : socket(s), writeSocket(::dup(s)), reactor(r), id(nextId.fetch_add(1, std::memory_order_relaxed)), queuedBytes(0),
+      writing(false), closed(false), batchIndex(0), batchOffset(0), zeroCopyEnabled(false), zeroCopySequence(0),
+      token(std::make_shared<CancellationToken>(std::move(parentToken))), requestTimeout(0), priority(Priority::Normal)
+{
+    ::fcntl(socket, F_SETFL, ::fcntl(socket, F_GETFL) | O_NONBLOCK);
+    if (writeSocket < 0)
+    {
+        closed = true; // Without a second descriptor the writer could not wait; refuse all output
+    }
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY)
+    int one = 1;
+    zeroCopyEnabled = setsockopt(socket, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0;
+#endif
+}
+
+// Destructor: the socket is closed once the last pending response has released the connection
+Connection::~Connection()
+{
+    if (writeSocket >= 0)
+    {
+        ::close(writeSocket);
+    }
+    ::close(socket);
+}
+
+// Queues data for the client without copying it
+void Connection::send(std::string data)
+{
+    std::vector<Segment> segments;
+    segments.push_back(BufferPool::adopt(std::move(data)));
+    send(std::move(segments));
+}
+
+// Queues segments for the client. A reactor thread that finds the queue idle writes what the socket
+// takes without blocking; any other thread hands the writing to the reactor. While a writer is active,
+// callers just append and return, so writes never interleave.
+void Connection::send(std::vector<Segment> segments)
+{
+    size_t overflow = 0;
+    {
+        std::lock_guard<std::mutex> lock(writeMutex);
+        if (closed)
+        {
+            return; // Client is gone; drop the response
+        }
+        for (auto &segment : segments)
+        {
+            if (segment && !segment->empty())
+            {
+                queuedBytes += segment->size();
+                writeQueue.push_back(std::move(segment));
+            }
+        }
+        if (queuedBytes > maxQueuedBytes)
+        {
+            // The client stopped reading; drop it rather than buffer without bound
+            overflow = queuedBytes;
+            closed = true;
+            writeQueue.clear();
+            queuedBytes = 0;
+            token->cancel();
+            ::shutdown(socket, SHUT_RDWR);
+        }
+        else if (writing)
+        {
+            return; // The active writer will pick it up
+        }
+        else
+        {
+            writing = true;
+        }
+    }
+    if (overflow > 0)
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cerr << "Closing connection " << id << ": " << overflow << " bytes of output not read" << std::endl;
+    }
+    else if (reactor.isPoolThread())
+    {
+        flush();
+    }
+    else
+    {
+        reactor.spawn(flushOnReactor(shared_from_this()));
+    }
+}
+
+// Writes queued batches until the queue is empty or the socket buffer is full (called by the current
+// writer). In the second case the writer coroutine takes over and the calling thread returns.
+void Connection::flush()
+{
+    std::unique_lock<std::mutex> lock(writeMutex);
+    while (!closed)
+    {
+        if (batchIndex == batch.size())
+        {
+            if (writeQueue.empty())
+            {
+                break;
+            }
+            // Take everything queued so far and write it as one scatter-gather batch
+            batch.assign(std::make_move_iterator(writeQueue.begin()), std::make_move_iterator(writeQueue.end()));
+            writeQueue.clear();
+            queuedBytes = 0;
+            batchIndex = 0;
+            batchOffset = 0;
+        }
+        lock.unlock();
+        WriteStatus status = writeSegments();
+        lock.lock();
+        if (status == WriteStatus::Blocked)
+        {
+            lock.unlock();
+            reactor.spawn(flushWhenWritable(shared_from_this())); // Still the writer
+            return;
+        }
+        if (status == WriteStatus::Failed)
+        {
+            closed = true;
+            writeQueue.clear();
+            queuedBytes = 0;
+            token->cancel(); // Nobody is left to read what the pending requests produce
+        }
+    }
+    batch.clear();
+    batchIndex = 0;
+    writing = false;
+}
+
+// Writer coroutine for output queued off the reactor: starts the flush on a pool thread
+Task<void> Connection::flushOnReactor(std::shared_ptr<Connection> self)
+{
+    self->flush();
+    co_return;
+}
+
+// Writer coroutine: resumes the flush once the socket has room (or has failed, which sendmsg reports)
+Task<void> Connection::flushWhenWritable(std::shared_ptr<Connection> self)
+{
+    co_await self->reactor.writable(self->writeSocket);
+    self->flush();
+}
+
+// Frames a payload made of segments: the header is its own small segment
+void Connection::sendFramed(const std::string &tag, std::vector<Segment> payload, bool last)
+{
+    if (!tag.empty())
+    {
+        size_t size = 0;
+        for (const auto &segment : payload)
+        {
+            size += segment ? segment->size() : 0;
+        }
+        payload.insert(payload.begin(), BufferPool::instance().copy(frameHeader(tag, size, last)));
+    }
+    send(std::move(payload));
+}
+
+// Writes the rest of the current batch, retrying after short writes and interrupted calls, until it is
+// done or the socket buffer is full
+Connection::WriteStatus Connection::writeSegments()
+{
+    while (batchIndex < batch.size())
+    {
+        iovec iov[64];
+        int count = 0;
+        size_t bytes = 0;
+        for (size_t i = batchIndex; i < batch.size() && count < 64; ++i, ++count)
+        {
+            size_t skip = (i == batchIndex) ? batchOffset : 0;
+            iov[count].iov_base = const_cast<char *>(batch[i]->data() + skip);
+            iov[count].iov_len = batch[i]->size() - skip;
+            bytes += iov[count].iov_len;
+        }
+
+        msghdr message{};
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        int flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+        bool zeroCopy = false;
+#ifdef MSG_ZEROCOPY
+        zeroCopy = zeroCopyEnabled && bytes >= zeroCopyThreshold;
+        if (zeroCopy)
+        {
+            flags |= MSG_ZEROCOPY;
+        }
+#endif
+        ssize_t n = ::sendmsg(socket, &message, flags);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return WriteStatus::Blocked;
+            }
+            if (zeroCopy && errno == ENOBUFS)
+            {
+                zeroCopyEnabled = false; // Out of pinned-page budget: fall back to copying sends
+                continue;
+            }
+            return WriteStatus::Failed;
+        }
+
+        // Advance past what was written
+        size_t written = static_cast<size_t>(n);
+        size_t firstTouched = batchIndex;
+        while (written > 0)
+        {
+            size_t remaining = batch[batchIndex]->size() - batchOffset;
+            if (written < remaining)
+            {
+                batchOffset += written;
+                break;
+            }
+            written -= remaining;
+            ++batchIndex;
+            batchOffset = 0;
+        }
+        if (zeroCopy)
+        {
+            // The kernel may still read from these segments until it reports this send as done
+            size_t lastTouched = std::min(batch.size(), batchIndex + (batchOffset > 0 ? 1 : 0));
+            zeroCopyInFlight.emplace_back(zeroCopySequence++,
+                                          std::vector<Segment>(batch.begin() + firstTouched, batch.begin() + lastTouched));
+        }
+        if (!zeroCopyInFlight.empty())
+        {
+            reapZeroCopy();
+        }
+    }
+    return WriteStatus::Done;
+}
+
+// Releases the segments of zero-copy sends the kernel has finished with. If the kernel had to copy
+// anyway (e.g. loopback), zero-copy is switched off for this connection since it only adds overhead.
+void Connection::reapZeroCopy()
+{
+#ifdef MSG_ZEROCOPY
+    while (!zeroCopyInFlight.empty())
+    {
+        char control[128];
+        msghdr message{};
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        if (::recvmsg(socket, &message, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            return; // Nothing completed yet (EAGAIN) or the socket is gone
+        }
+        for (cmsghdr *cm = CMSG_FIRSTHDR(&message); cm; cm = CMSG_NXTHDR(&message, cm))
+        {
+            bool ipError = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                           (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            if (!ipError)
+            {
+                continue;
+            }
+            const sock_extended_err *error = reinterpret_cast<const sock_extended_err *>(CMSG_DATA(cm));
+            if (error->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            // [ee_info, ee_data] is the range of completed send numbers
+            uint32_t first = error->ee_info;
+            uint32_t last = error->ee_data;
+            while (!zeroCopyInFlight.empty() &&
+                   zeroCopyInFlight.front().first - first <= last - first)
+            {
+                zeroCopyInFlight.pop_front();
+            }
+            if (error->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                zeroCopyEnabled = false;
+            }
+        }
+    }
+#endif
+}
+
+// Marks the connection closed and wakes up a blocked reader
+void Connection::close()
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    if (!closed)
+    {
+        closed = true;
+        writeQueue.clear();
+        queuedBytes = 0;
+        token->cancel();
+        ::shutdown(socket, SHUT_RDWR);
+    }
+}
+
+// Finished requests drop their token, so expired entries are pruned whenever the map has grown
+void Connection::trackRequest(const std::string &tag, const std::shared_ptr<CancellationToken> &requestToken)
+{
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    if (requests.size() >= 64)
+    {
+        for (auto it = requests.begin(); it != requests.end();)
+        {
+            it = it->second.expired() ? requests.erase(it) : std::next(it);
+        }
+    }
+    requests[tag] = requestToken;
+}
+
+// Cancels the tagged request if it is still running; returns false if there is no such request
+bool Connection::cancelRequest(const std::string &tag)
+{
+    std::lock_guard<std::mutex> lock(requestsMutex);
+    auto it = requests.find(tag);
+    if (it == requests.end())
+    {
+        return false;
+    }
+    std::shared_ptr<CancellationToken> requestToken = it->second.lock();
+    requests.erase(it);
+    if (!requestToken)
+    {
+        return false;
+    }
+    requestToken->cancel();
+    return true;
+}
+
+// Returns true once the client has disconnected or a write failed
+bool Connection::isClosed() const
+{
+    std::lock_guard<std::mutex> lock(writeMutex);
+    return closed;
+}
+
+// Header of a response frame for the given request tag; continuation frames are marked '+'
+std::string Connection::frameHeader(const std::string &tag, size_t payloadSize, bool last)
+{
+    return "#" + tag + (last ? " " : " +") + std::to_string(payloadSize) + "\n";
+}
+
+// Sends a complete response for the request with this tag. The text is copied into a pooled buffer,
+// so it may live in the caller's request arena.
+void Connection::respond(const std::string &tag, std::string_view response)
+{
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "Sending response" << (tag.empty() ? "" : " #" + tag) << ": " << response << std::endl;
+    }
+    sendFramed(tag, {BufferPool::instance().copy(response.data(), response.size())});
+}
+
+// Returns a callback that sends a response for the request with this tag.
+// The callback keeps the connection alive, so it is safe to call from any thread at any time.
+ResponseCallback Connection::makeResponder(const std::string &tag)
+{
+    std::shared_ptr<Connection> self(shared_from_this());
+    return [self, tag](std::string_view response)
+    { self->respond(tag, response); };
+}
+
+// Like makeResponder, for responses built from several segments (e.g. a cached tree plus its metrics)
+SegmentCallback Connection::makeSegmentResponder(const std::string &tag)
+{
+    std::shared_ptr<Connection> self(shared_from_this());
+    return [self, tag](std::vector<Segment> segments)
+    {
+        {
+            size_t size = 0;
+            for (const auto &segment : segments)
+            {
+                size += segment->size();
+            }
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "Sending response" << (tag.empty() ? "" : " #" + tag) << ": " << size << " bytes in "
+                      << segments.size() << " segments" << std::endl;
+        }
+        self->sendFramed(tag, std::move(segments));
+    };
+}
+
+// Returns a callback that sends a response in pieces as it is produced. Each piece is only queued;
+// the reactor writes it while the producer goes on rendering the next one.
+ChunkCallback Connection::makeStreamResponder(const std::string &tag)
+{
+    std::shared_ptr<Connection> self(shared_from_this());
+    return [self, tag](std::string chunk, bool last)
+    {
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "Sending response" << (tag.empty() ? "" : " #" + tag) << ": " << chunk.size()
+                      << " bytes" << (last ? "" : " (more to come)") << std::endl;
+        }
+        if (!chunk.empty() || (last && !tag.empty()))
+        {
+            self->sendFramed(tag, {BufferPool::adopt(std::move(chunk))}, last);
+        }
+    };
+}
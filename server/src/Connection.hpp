@@ -0,0 +1,108 @@
+#pragma once
+#include "ResponseBuffer.hpp"
+#include "ActiveObject.hpp"
+#include "Reactor.hpp"
+#include "../../common/CancellationToken.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Callback used by asynchronous work to deliver the response of one request
+using ResponseCallback = std::function<void(std::string_view)>;
+
+// Callback that delivers a response assembled from segments (see ResponseBuilder) without joining them
+using SegmentCallback = std::function<void(std::vector<Segment>)>;
+
+// Callback used to deliver a response in pieces; the piece with last == true completes the request
+using ChunkCallback = std::function<void(std::string chunk, bool last)>;
+
+// One client connection. Owns the socket and a write queue that any thread may append to,
+// so responses produced on pipeline workers can outlive the loop iteration that issued them.
+// Queued segments are written with non-blocking sendmsg() in scatter-gather batches; large batches use
+// MSG_ZEROCOPY where the kernel supports it. Only reactor threads write: other threads (pipeline
+// workers) append to the queue and leave the writing to a coroutine on the reactor. When the socket
+// buffer is full, that coroutine waits for it to drain, so no thread ever blocks on a slow client.
+class Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    Connection(int socket, Reactor &reactor, std::shared_ptr<const CancellationToken> parentToken = nullptr);
+    ~Connection();
+
+    int getSocket() const { return socket; }
+    // Identifies the connection as a flow for fair queueing between clients
+    uint64_t getId() const { return id; }
+    void send(std::string data);
+    void send(std::vector<Segment> segments);
+    void sendFramed(const std::string &tag, std::vector<Segment> payload, bool last = true);
+    void respond(const std::string &tag, std::string_view response);
+    void close();
+    bool isClosed() const;
+    ResponseCallback makeResponder(const std::string &tag);
+    SegmentCallback makeSegmentResponder(const std::string &tag);
+    ChunkCallback makeStreamResponder(const std::string &tag);
+    static std::string frameHeader(const std::string &tag, size_t payloadSize, bool last = true);
+
+    // Cancelled when the connection closes or a write fails; tagged requests are its children
+    const std::shared_ptr<CancellationToken> &getCancellationToken() const { return token; }
+    // Remembers the token of a tagged request so "cancel <tag>" can find it while it runs
+    void trackRequest(const std::string &tag, const std::shared_ptr<CancellationToken> &requestToken);
+    bool cancelRequest(const std::string &tag);
+    // How long each new request may run (zero = no deadline)
+    void setRequestTimeout(std::chrono::milliseconds timeout) { requestTimeout = timeout; }
+    std::chrono::milliseconds getRequestTimeout() const { return requestTimeout; }
+    // Scheduling class of requests that do not name one
+    void setPriority(Priority p) { priority = p; }
+    Priority getPriority() const { return priority; }
+
+private:
+    static const size_t zeroCopyThreshold = 256 * 1024;     // Smallest sendmsg() worth pinning pages for
+    static const size_t maxQueuedBytes = 256 * 1024 * 1024; // Unsent output at which a client is dropped
+
+    static std::atomic<uint64_t> nextId;
+
+    int socket;
+    int writeSocket; // Duplicate of socket, so the writer can wait in epoll while the reader does too
+    Reactor &reactor;
+    uint64_t id;
+    std::deque<Segment> writeQueue;
+    size_t queuedBytes; // In writeQueue, not counting the batch being written
+    bool writing; // a thread or the writer coroutine owns the batch below and drains writeQueue
+    bool closed;
+    mutable std::mutex writeMutex;
+
+    // Only touched by the current writer
+    std::vector<Segment> batch; // Taken from writeQueue, written from batchIndex / batchOffset on
+    size_t batchIndex;
+    size_t batchOffset;
+    bool zeroCopyEnabled;
+    uint32_t zeroCopySequence; // Number of the next MSG_ZEROCOPY send
+    std::deque<std::pair<uint32_t, std::vector<Segment>>> zeroCopyInFlight; // Kept alive until the kernel is done
+
+    std::shared_ptr<CancellationToken> token;
+    std::chrono::milliseconds requestTimeout; // Only used by the thread reading requests
+    Priority priority;                        // Likewise
+    std::mutex requestsMutex;
+    std::unordered_map<std::string, std::weak_ptr<CancellationToken>> requests; // In flight, by tag
+
+    enum class WriteStatus
+    {
+        Done,
+        Blocked, // The socket buffer is full
+        Failed
+    };
+
+    void flush();
+    static Task<void> flushOnReactor(std::shared_ptr<Connection> self);
+    static Task<void> flushWhenWritable(std::shared_ptr<Connection> self);
+    WriteStatus writeSegments();
+    void reapZeroCopy();
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+// Coroutine types for writing asynchronous server code as straight-line functions.
+//
+// Task<T> is a lazily started coroutine that produces a T. It runs when it is co_awaited and hands
+// control straight back to its awaiter when it finishes (symmetric transfer), so chains of awaited
+// tasks neither grow the stack nor need a scheduler. Exceptions thrown inside the task are rethrown
+// from the co_await.
+//
+// Detached is an eagerly started coroutine nobody awaits; its frame frees itself when it finishes.
+// It is the root of a chain of tasks, e.g. one per client connection (see Reactor::spawn).
+
+template <typename T>
+class Task;
+
+namespace coroutine_detail
+{
+    // Resumes whoever awaited the finished task, or returns to the resumer if nobody did
+    struct FinalAwaiter
+    {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> finished) noexcept
+        {
+            std::coroutine_handle<> continuation = finished.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() const noexcept {}
+    };
+
+    struct PromiseBase
+    {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr error;
+
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        FinalAwaiter final_suspend() const noexcept { return {}; }
+        void unhandled_exception() { error = std::current_exception(); }
+        void rethrowIfFailed() const
+        {
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+    };
+
+    template <typename T>
+    struct Promise : PromiseBase
+    {
+        std::optional<T> value;
+
+        Task<T> get_return_object();
+        void return_value(T result) { value.emplace(std::move(result)); }
+        T take()
+        {
+            rethrowIfFailed();
+            return std::move(*value);
+        }
+    };
+
+    template <>
+    struct Promise<void> : PromiseBase
+    {
+        Task<void> get_return_object();
+        void return_void() const noexcept {}
+        void take() const { rethrowIfFailed(); }
+    };
+}
+
+template <typename T = void>
+class Task
+{
+public:
+    using promise_type = coroutine_detail::Promise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle h) : handle(h) {}
+    Task(Task &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    Task &operator=(Task &&other) noexcept
+    {
+        if (this != &other)
+        {
+            if (handle)
+            {
+                handle.destroy();
+            }
+            handle = std::exchange(other.handle, nullptr);
+        }
+        return *this;
+    }
+    Task(const Task &) = delete;
+    Task &operator=(const Task &) = delete;
+    ~Task()
+    {
+        if (handle)
+        {
+            handle.destroy();
+        }
+    }
+
+    // Awaiting a task starts it; the awaiter resumes with its result once it finishes
+    auto operator co_await() const noexcept
+    {
+        struct Awaiter
+        {
+            Handle task;
+            bool await_ready() const noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+            {
+                task.promise().continuation = awaiting;
+                return task;
+            }
+            T await_resume() { return task.promise().take(); }
+        };
+        return Awaiter{handle};
+    }
+
+private:
+    Handle handle;
+};
+
+namespace coroutine_detail
+{
+    template <typename T>
+    Task<T> Promise<T>::get_return_object()
+    {
+        return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+    }
+
+    inline Task<void> Promise<void>::get_return_object()
+    {
+        return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+    }
+}
+
+// A fire-and-forget coroutine. It runs up to its first suspension in the caller and frees its frame
+// when it finishes; it must catch its own exceptions.
+struct Detached
+{
+    struct promise_type
+    {
+        Detached get_return_object() const noexcept { return {}; }
+        std::suspend_never initial_suspend() const noexcept { return {}; }
+        std::suspend_never final_suspend() const noexcept { return {}; }
+        void return_void() const noexcept {}
+        void unhandled_exception() const noexcept { std::terminate(); }
+    };
+};
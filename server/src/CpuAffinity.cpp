@@ -0,0 +1,134 @@
+// This file implements the CPU affinity helpers with pthread_setaffinity_np and sysfs.
+
+#include "CpuAffinity.hpp"
+#include <filesystem>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+std::vector<int> CpuAffinity::parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    size_t position = 0;
+    while (position < list.size())
+    {
+        size_t comma = list.find(',', position);
+        std::string item = list.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+        position = comma == std::string::npos ? list.size() : comma + 1;
+        size_t dash = item.find('-');
+        try
+        {
+            size_t used = 0;
+            int first = std::stoi(item, &used);
+            int last = first;
+            if (dash != std::string::npos)
+            {
+                size_t usedLast = 0;
+                last = std::stoi(item.substr(dash + 1), &usedLast);
+                used = dash + 1 + usedLast;
+            }
+            if (used != item.size() || first < 0 || last < first || last >= CPU_SETSIZE)
+            {
+                throw std::invalid_argument(item);
+            }
+            for (int cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        catch (const std::exception &)
+        {
+            throw std::invalid_argument("Invalid CPU list '" + list + "' (use e.g. 0-3,8)");
+        }
+    }
+    if (cpus.empty())
+    {
+        throw std::invalid_argument("Invalid CPU list '" + list + "' (use e.g. 0-3,8)");
+    }
+    return cpus;
+}
+
+std::string CpuAffinity::formatCpuList(const std::vector<int> &cpus)
+{
+    std::string result;
+    for (int cpu : cpus)
+    {
+        result += (result.empty() ? "" : ",") + std::to_string(cpu);
+    }
+    return result;
+}
+
+namespace
+{
+    bool setAffinity(pthread_t thread, const std::vector<int> &cpus)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+        {
+            CPU_SET(cpu, &set);
+        }
+        return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+    }
+}
+
+bool CpuAffinity::pin(std::thread &thread, const std::vector<int> &cpus)
+{
+    return !cpus.empty() && setAffinity(thread.native_handle(), cpus);
+}
+
+bool CpuAffinity::pinCurrentThread(const std::vector<int> &cpus)
+{
+    return !cpus.empty() && setAffinity(pthread_self(), cpus);
+}
+
+// sysfs lists a "node<N>" link in the directory of every CPU on a NUMA machine
+int CpuAffinity::getNodeOfCpu(int cpu)
+{
+    std::error_code error;
+    std::filesystem::directory_iterator entries("/sys/devices/system/cpu/cpu" + std::to_string(cpu), error);
+    if (error)
+    {
+        return -1;
+    }
+    for (const auto &entry : entries)
+    {
+        std::string name = entry.path().filename().string();
+        if (name.size() > 4 && name.compare(0, 4, "node") == 0 && name.find_first_not_of("0123456789", 4) == std::string::npos)
+        {
+            return std::stoi(name.substr(4));
+        }
+    }
+    return -1;
+}
+
+int CpuAffinity::getCurrentNode()
+{
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (getcpu(&cpu, &node) != 0)
+    {
+        return -1;
+    }
+    return static_cast<int>(node);
+}
+
+// get_mempolicy(MPOL_F_NODE | MPOL_F_ADDR) reports the node of the page behind an address. It is
+// called through syscall() because glibc only declares it in libnuma's numaif.h.
+int CpuAffinity::getNodeOfAddress(const void *address)
+{
+#ifdef SYS_get_mempolicy
+    const unsigned long nodeFlag = 1;    // MPOL_F_NODE
+    const unsigned long addressFlag = 2; // MPOL_F_ADDR
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0UL, address, nodeFlag | addressFlag) == 0)
+    {
+        return node;
+    }
+#else
+    (void)address;
+#endif
+    return -1;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <string>
+#include <thread>
+#include <vector>
+
+// Helpers for pinning threads to CPUs and finding the NUMA node they run on. CPU lists use the
+// kernel's syntax, e.g. "0-3,8,10-11". Node lookups read sysfs or ask the kernel directly, so no NUMA
+// library is needed.
+class CpuAffinity
+{
+public:
+    static std::vector<int> parseCpuList(const std::string &list);
+    static std::string formatCpuList(const std::vector<int> &cpus);
+
+    // Restricts the thread to the given CPUs; returns false if the kernel refuses (e.g. offline CPU)
+    static bool pin(std::thread &thread, const std::vector<int> &cpus);
+    static bool pinCurrentThread(const std::vector<int> &cpus);
+
+    // NUMA node of a CPU, or -1 if the machine does not report one
+    static int getNodeOfCpu(int cpu);
+    // NUMA node of the CPU the calling thread is running on right now, or -1
+    static int getCurrentNode();
+    // NUMA node holding the (already touched) page of address, or -1 if the kernel cannot tell
+    static int getNodeOfAddress(const void *address);
+};
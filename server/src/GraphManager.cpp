@@ -3,46 +3,330 @@
 // ensuring that all operations on the graph are thread-safe.
 
 #include "GraphManager.hpp"
+#include "../../common/GraphSnapshot.hpp"
+#include "RequestArena.hpp"
 #include <sstream>
 #include <iostream>
+#include <filesystem>
+#include <stdexcept>
+
+extern std::mutex coutMutex;
 
 // Constructor: Initializes the GraphManager with an empty graph
-GraphManager::GraphManager() : graph(std::make_shared<Graph>(0)) {}
+GraphManager::GraphManager()
+    : graph(std::make_shared<Graph>(0)), version(0), snapshotTakenAt(0), snapshotInterval(0), mutationsSinceSnapshot(0),
+      compacting(false), replaceLsn(0), savedLsn(0), replaceFailed(false) {}
 
 // Destructor: Clears any remaining resources
 GraphManager::~GraphManager()
 {
+    if (mutationLog)
+    {
+        mutationLog->close();
+    }
     graph.reset();
 }
 
+// Restores the graph from the latest snapshot plus the mutation log in directory,
+// then logs every further mutation there. A snapshot is taken every snapshotInterval mutations
+// (never when it is 0; the log is then only folded in on restart and by replaceGraph).
+void GraphManager::enableDurability(const std::string &directory, size_t interval)
+{
+    std::filesystem::create_directories(directory);
+
+    std::unique_lock<std::mutex> lock(graphMutex);
+    dataDirectory = directory;
+    snapshotInterval = interval;
+
+    // Load the snapshot (if any), then replay the records written after it. A "replace" record newer
+    // than the snapshot means the replacement's own snapshot never reached disk, so the records after
+    // it belong to a graph that is lost; none of them were acknowledged, and they are discarded.
+    uint64_t snapshotLsn = 0;
+    GraphSnapshot::readFile(dataDirectory + "/graph.snapshot", *graph, snapshotLsn);
+    size_t replayed = 0;
+    size_t discarded = 0;
+    uint64_t lastLsn = MutationLog::replay(dataDirectory, snapshotLsn, [this, &replayed, &discarded](const std::string &record)
+                                           {
+                                               if (discarded > 0 || record == "replace")
+                                               {
+                                                   ++discarded;
+                                                   return;
+                                               }
+                                               applyRecord(*graph, record);
+                                               ++replayed;
+                                           });
+
+    ++version; // The graph was rebuilt in place
+    savedLsn = snapshotLsn;
+    mutationLog = std::make_unique<MutationLog>(dataDirectory);
+    mutationLog->open(lastLsn);
+
+    {
+        std::lock_guard<std::mutex> coutLock(coutMutex);
+        std::cout << "Restored graph from " << dataDirectory << ": " << graph->getVertices() << " vertices, "
+                  << graph->getEdges() << " edges (" << replayed << " log records replayed";
+        if (discarded > 0)
+        {
+            std::cout << ", " << discarded << " discarded after an unfinished replacement";
+        }
+        std::cout << ")" << std::endl;
+    }
+    lock.unlock();
+
+    // Fold the replayed records into a fresh snapshot so the next boot does not replay them again
+    if (replayed > 0 || discarded > 0)
+    {
+        compact();
+    }
+    else
+    {
+        mutationLog->removeGenerationsThrough(mutationLog->currentGeneration() - 1);
+    }
+}
+
+// Refuses mutations once the log has failed (caller holds graphMutex). Applying them would let the
+// graph in memory drift from what a restart restores, so the graph stays read-only until then.
+void GraphManager::checkWritable() const
+{
+    if (mutationLog && mutationLog->hasFailed())
+    {
+        throw std::runtime_error("The mutation log cannot be written; the graph is read-only until the server restarts");
+    }
+}
+
+// Appends a mutation record to the log (caller holds graphMutex); returns 0 when durability is off
+uint64_t GraphManager::logMutation(const std::string &record)
+{
+    if (!mutationLog)
+    {
+        return 0;
+    }
+    ++mutationsSinceSnapshot;
+    return mutationLog->append(record);
+}
+
+// Waits for a logged mutation to reach disk (called after graphMutex is released, so that
+// concurrent writers share one group commit) and compacts the log when it has grown enough.
+// A mutation logged after a replacement is not acknowledged before the replacement's snapshot is
+// on disk, because replay cannot apply it to the graph that was replaced.
+void GraphManager::commit(uint64_t lsn)
+{
+    if (lsn == 0)
+    {
+        return;
+    }
+    mutationLog->waitDurable(lsn);
+
+    {
+        std::unique_lock<std::mutex> lock(compactionMutex);
+        compactionDone.wait(lock, [this, lsn]
+                            { return lsn < replaceLsn || savedLsn >= replaceLsn || replaceFailed; });
+        if (lsn > replaceLsn && savedLsn < replaceLsn)
+        {
+            throw std::runtime_error("Snapshot of the replaced graph failed");
+        }
+        if (snapshotInterval == 0 || mutationsSinceSnapshot < snapshotInterval || compacting)
+        {
+            return;
+        }
+        compacting = true;
+    }
+    try
+    {
+        compact();
+    }
+    catch (const std::exception &e)
+    {
+        std::lock_guard<std::mutex> coutLock(coutMutex);
+        std::cerr << "Snapshot compaction failed: " << e.what() << std::endl;
+    }
+    finishCompaction();
+}
+
+// Writes a snapshot of the current graph and drops the log generations it covers
+void GraphManager::compact()
+{
+    std::unique_lock<std::mutex> lock(graphMutex);
+    writeSnapshot(lock);
+}
+
+// Serializes the graph and rotates the log while graphLock is held, so the snapshot and the new
+// generation split the records exactly; the file itself is written after the lock is released
+void GraphManager::writeSnapshot(std::unique_lock<std::mutex> &graphLock)
+{
+    std::ostringstream out;
+    uint64_t lsn = mutationLog->lastLsn();
+    GraphSnapshot::write(*graph, out, lsn);
+    int closedGeneration = mutationLog->rotate();
+    mutationsSinceSnapshot = 0;
+    graphLock.unlock();
+
+    GraphSnapshot::writeFile(dataDirectory + "/graph.snapshot", out.str());
+    mutationLog->removeGenerationsThrough(closedGeneration);
+    {
+        std::lock_guard<std::mutex> lock(compactionMutex);
+        savedLsn = lsn;
+    }
+    compactionDone.notify_all();
+}
+
+// Hands the compaction slot to the next waiting writer
+void GraphManager::finishCompaction()
+{
+    {
+        std::lock_guard<std::mutex> lock(compactionMutex);
+        compacting = false;
+    }
+    compactionDone.notify_all();
+}
+
+// Applies one logged mutation during replay
+void GraphManager::applyRecord(Graph &target, const std::string &record)
+{
+    std::istringstream iss(record);
+    std::string operation;
+    int a = 0, b = 0, c = 0;
+    iss >> operation >> a >> b >> c;
+
+    if (operation == "add_vertex")
+    {
+        target.insertVertex(a);
+    }
+    else if (operation == "add_edge")
+    {
+        target.addEdge(a, b, c);
+    }
+    else if (operation == "remove_vertex")
+    {
+        target.removeVertex(a);
+    }
+    else if (operation == "remove_edge")
+    {
+        target.removeEdge(a, b);
+    }
+    else if (operation == "change_weight")
+    {
+        target.changeWeight(a, b, c);
+    }
+    else
+    {
+        throw std::runtime_error("Unknown mutation log record: " + record);
+    }
+}
+
 // Adds a new vertex to the graph in a thread-safe manner
 void GraphManager::addVertex()
 {
-    // This code adds a new vertex to the graph in a thread-safe manner
-    std::lock_guard<std::mutex> lock(graphMutex); // Acquire a lock on the graph mutex
-    graph->addVertex();                           // Call the addVertex method on the graph object
-    // The lock is automatically released when it goes out of scope
+    uint64_t lsn;
+    {
+        // This code adds a new vertex to the graph in a thread-safe manner
+        std::lock_guard<std::mutex> lock(graphMutex); // Acquire a lock on the graph mutex
+        checkWritable();
+        int id = graph->addVertex();                  // Call the addVertex method on the graph object
+        ++version;
+        lsn = logMutation("add_vertex " + std::to_string(id));
+    } // The lock is released before waiting for the log, so other writers can join the same commit
+    commit(lsn);
 }
 
 // Adds a new edge to the graph in a thread-safe manner
 void GraphManager::addEdge(int source, int destination, int weight)
 {
-    std::lock_guard<std::mutex> lock(graphMutex);
-    graph->addEdge(source, destination, weight);
+    uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        checkWritable();
+        graph->addEdge(source, destination, weight);
+        ++version;
+        lsn = logMutation("add_edge " + std::to_string(source) + " " + std::to_string(destination) + " " +
+                          std::to_string(weight));
+    }
+    commit(lsn);
 }
 
 // Removes a vertex from the graph in a thread-safe manner
-void GraphManager::removeVertex(int vertex)
+bool GraphManager::removeVertex(int vertex)
 {
-    std::lock_guard<std::mutex> lock(graphMutex);
-    graph->removeVertex(vertex);
+    uint64_t lsn = 0;
+    bool removed;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        checkWritable();
+        removed = graph->removeVertex(vertex);
+        if (removed)
+        {
+            ++version;
+            lsn = logMutation("remove_vertex " + std::to_string(vertex));
+        }
+    }
+    commit(lsn);
+    return removed;
 }
 
 // Removes an edge from the graph in a thread-safe manner
-void GraphManager::removeEdge(int source, int destination)
+bool GraphManager::removeEdge(int source, int destination)
 {
-    std::lock_guard<std::mutex> lock(graphMutex);
-    graph->removeEdge(source, destination);
+    uint64_t lsn = 0;
+    bool removed;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        checkWritable();
+        removed = graph->removeEdge(source, destination);
+        if (removed)
+        {
+            ++version;
+            lsn = logMutation("remove_edge " + std::to_string(source) + " " + std::to_string(destination));
+        }
+    }
+    commit(lsn);
+    return removed;
+}
+
+// Swaps in a whole new graph (e.g. a generated one). With durability on, the replacement is not
+// logged edge by edge: a "replace" record marks it in the log, and a snapshot of the new graph is
+// taken and the log rotated under the same lock as the swap, so no other mutation can fall in between.
+void GraphManager::replaceGraph(Graph &&replacement)
+{
+    auto fresh = std::make_shared<Graph>(std::move(replacement));
+    if (!mutationLog)
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        graph = std::move(fresh);
+        ++version;
+        return;
+    }
+
+    // Wait out a compaction already running, so that its older snapshot cannot land after this one
+    {
+        std::unique_lock<std::mutex> lock(compactionMutex);
+        compactionDone.wait(lock, [this]
+                            { return !compacting; });
+        compacting = true;
+    }
+    try
+    {
+        std::unique_lock<std::mutex> lock(graphMutex);
+        checkWritable();
+        graph = std::move(fresh);
+        ++version;
+        uint64_t lsn = mutationLog->append("replace");
+        {
+            std::lock_guard<std::mutex> compactionLock(compactionMutex);
+            replaceLsn = lsn;
+            replaceFailed = false;
+        }
+        writeSnapshot(lock);
+    }
+    catch (...)
+    {
+        {
+            std::lock_guard<std::mutex> lock(compactionMutex);
+            replaceFailed = true;
+        }
+        finishCompaction();
+        throw;
+    }
+    finishCompaction();
 }
 
 // Returns a shared pointer to the graph in a thread-safe manner
@@ -52,10 +336,43 @@ std::shared_ptr<Graph> GraphManager::getGraph() const
     return graph;
 }
 
-bool GraphManager::changeWeight(int source, int destination, int newWeight)
+// Returns a read-only copy of the graph that stays consistent while mutations continue, optionally
+// with the version it was taken at. Requests between two mutations share one copy, so caches keyed
+// by the snapshot (e.g. the pipeline's NUMA-local copies) are hit until the graph changes.
+std::shared_ptr<const Graph> GraphManager::getSnapshot(uint64_t *snapshotVersion) const
 {
     std::lock_guard<std::mutex> lock(graphMutex);
-    return graph->changeWeight(source, destination, newWeight);
+    uint64_t current = version.load(std::memory_order_relaxed);
+    if (snapshotVersion)
+    {
+        *snapshotVersion = current;
+    }
+    if (!snapshot || snapshotTakenAt != current)
+    {
+        snapshot = std::make_shared<const Graph>(*graph);
+        snapshotTakenAt = current;
+    }
+    return snapshot;
+}
+
+// Changes the weight of an edge in a thread-safe manner
+bool GraphManager::changeWeight(int source, int destination, int newWeight)
+{
+    uint64_t lsn = 0;
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(graphMutex);
+        checkWritable();
+        changed = graph->changeWeight(source, destination, newWeight);
+        if (changed)
+        {
+            ++version;
+            lsn = logMutation("change_weight " + std::to_string(source) + " " + std::to_string(destination) + " " +
+                              std::to_string(newWeight));
+        }
+    }
+    commit(lsn);
+    return changed;
 }
 
 std::vector<Edge> GraphManager::getAdjacentEdges(int vertex) const
@@ -76,20 +393,36 @@ int GraphManager::getEdges() const
 
 // Returns a string representation of the graph for debugging purposes
 std::string GraphManager::getGraphString() const
+{
+    std::pmr::string text;
+    appendGraphString(text);
+    return std::string(text);
+}
+
+// Appends the graph listing to text, formatting numbers in place so a response built in a request
+// arena does not touch the heap
+void GraphManager::appendGraphString(std::pmr::string &text) const
 {
     std::lock_guard<std::mutex> lock(graphMutex);
-    std::stringstream ss;
-    ss << "Current graph:\n";
-    ss << "Graph has " << graph->getVertices() << " vertices.\n";
+    text += "Current graph:\nGraph has ";
+    appendNumber(text, graph->getVertices());
+    text += " vertices.\n";
     for (int i = 0; i < graph->getVertices(); ++i)
     {
-        ss << "Vertex " << i << ":\n";
+        text += "Vertex ";
+        appendNumber(text, i);
+        text += ":\n";
         const auto &edges = graph->getAdjacentEdges(i);
-        ss << "This vertex has " << edges.size() << " edges.\n";
+        text += "This vertex has ";
+        appendNumber(text, static_cast<long long>(edges.size()));
+        text += " edges.\n";
         for (const auto &edge : edges)
         {
-            ss << "-> " << edge.destination << " (weight: " << edge.weight << ")\n";
+            text += "-> ";
+            appendNumber(text, edge.destination);
+            text += " (weight: ";
+            appendNumber(text, edge.weight);
+            text += ")\n";
         }
     }
-    return ss.str();
 }
\ No newline at end of file
@@ -1,20 +1,29 @@
 #pragma once
 #include "../../common/Graph.hpp"
+#include "MutationLog.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <string>
 #include <memory>
+#include <memory_resource>
 
 class GraphManager
 {
 public:
     GraphManager();
 
+    void enableDurability(const std::string &directory, size_t snapshotInterval);
     void addVertex();
     void addEdge(int source, int destination, int weight);
-    void removeVertex(int vertex);
-    void removeEdge(int source, int destination);
+    bool removeVertex(int vertex);
+    bool removeEdge(int source, int destination);
+    void replaceGraph(Graph &&replacement);
     std::shared_ptr<Graph> getGraph() const;
+    std::shared_ptr<const Graph> getSnapshot(uint64_t *snapshotVersion = nullptr) const;
+    uint64_t getVersion() const { return version.load(std::memory_order_acquire); }
     std::string getGraphString() const;
+    void appendGraphString(std::pmr::string &text) const;
     bool changeWeight(int source, int destination, int newWeight);
     std::vector<Edge> getAdjacentEdges(int vertex) const;
     int getVertices() const;
@@ -24,4 +33,27 @@ public:
 private:
     std::shared_ptr<Graph> graph;
     mutable std::mutex graphMutex;
-};
\ No newline at end of file
+    std::atomic<uint64_t> version; // Bumped by every mutation, so derived data can tell it is stale
+    mutable std::shared_ptr<const Graph> snapshot; // Copy handed out for snapshotTakenAt (guarded by graphMutex)
+    mutable uint64_t snapshotTakenAt;
+
+    // Durability (only active after enableDurability)
+    std::unique_ptr<MutationLog> mutationLog;
+    std::string dataDirectory;
+    size_t snapshotInterval;
+    std::atomic<size_t> mutationsSinceSnapshot;
+    std::mutex compactionMutex; // Guards the fields below; taken after graphMutex when both are held
+    std::condition_variable compactionDone;
+    bool compacting;     // A snapshot is being written; only one may be in flight
+    uint64_t replaceLsn; // LSN of the last "replace" record
+    uint64_t savedLsn;   // LSN covered by the snapshot file on disk
+    bool replaceFailed;  // The snapshot of the last replacement could not be written
+
+    void checkWritable() const;
+    uint64_t logMutation(const std::string &record);
+    void commit(uint64_t lsn);
+    void compact();
+    void writeSnapshot(std::unique_lock<std::mutex> &graphLock);
+    void finishCompaction();
+    static void applyRecord(Graph &graph, const std::string &record);
+};
@@ -0,0 +1,213 @@
+// This file implements the GraphRegistry class, which gives every tenant its own named graph.
+// Each graph is pinned to one pipeline shard so that independent graphs never share a lock or a worker.
+
+#include "GraphRegistry.hpp"
+#include "CpuAffinity.hpp"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+extern std::mutex coutMutex;
+
+namespace
+{
+    // Threads of the shared compute pool: enough for the larger of the APSP and shortest path limits
+    size_t computeThreads(const ServerConfig &config)
+    {
+        size_t cores = std::max(1u, std::thread::hardware_concurrency());
+        return std::max(config.apspThreads > 0 ? config.apspThreads : cores,
+                        config.ssspThreads > 0 ? config.ssspThreads : cores);
+    }
+}
+
+// Constructor: creates the pipeline shards and restores any graphs stored in the data directory
+GraphRegistry::GraphRegistry(const ServerConfig &cfg)
+    : config(cfg), computePool(computeThreads(cfg)), apspSlots(static_cast<std::ptrdiff_t>(cfg.apspConcurrency))
+{
+    size_t shardCount = config.shardCount;
+    if (shardCount == 0)
+    {
+        shardCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (size_t i = 0; i < shardCount; ++i)
+    {
+        shards.push_back(std::make_unique<Pipeline>(config.stageQueueCapacity, config.overflowPolicy));
+    }
+
+    // Give every shard a contiguous block of the stage CPUs, so that a shard stays on one NUMA node
+    // when the list is ordered by node; with fewer CPUs than shards, blocks of one CPU are reused
+    const std::vector<int> &cpus = config.stageCpus;
+    for (size_t i = 0; i < shardCount && !cpus.empty(); ++i)
+    {
+        std::vector<int> block(1, cpus[i % cpus.size()]);
+        if (cpus.size() >= shardCount)
+        {
+            block.assign(cpus.begin() + i * cpus.size() / shardCount, cpus.begin() + (i + 1) * cpus.size() / shardCount);
+        }
+        shards[i]->setAffinity(block);
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "Shard " << i << " pinned to CPUs " << CpuAffinity::formatCpuList(block);
+        if (shards[i]->getNumaNode() >= 0)
+        {
+            std::cout << " (NUMA node " << shards[i]->getNumaNode() << ")";
+        }
+        std::cout << std::endl;
+    }
+    graphsPerShard.assign(shardCount, 0);
+
+    // Every subdirectory of the data directory holds one named graph
+    if (!config.dataDirectory.empty())
+    {
+        std::filesystem::create_directories(config.dataDirectory);
+        for (const auto &entry : std::filesystem::directory_iterator(config.dataDirectory))
+        {
+            std::string name = entry.path().filename().string();
+            if (entry.is_directory() && isValidName(name))
+            {
+                create(name);
+            }
+        }
+    }
+    // Every connection starts on the default graph, so it exists before the first one arrives
+    if (!contains("default"))
+    {
+        create("default");
+    }
+}
+
+// Destructor: stops all shards
+GraphRegistry::~GraphRegistry()
+{
+    stop();
+}
+
+// Starts the worker threads of every shard
+void GraphRegistry::start()
+{
+    for (auto &shard : shards)
+    {
+        shard->start();
+    }
+}
+
+// Stops the worker threads of every shard
+void GraphRegistry::stop()
+{
+    for (auto &shard : shards)
+    {
+        shard->stop();
+    }
+}
+
+// Graph names are used as directory names, so only allow a safe character set
+bool GraphRegistry::isValidName(const std::string &name)
+{
+    if (name.empty() || name.size() > 64)
+    {
+        return false;
+    }
+    return std::all_of(name.begin(), name.end(), [](char c)
+                       { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-'; });
+}
+
+// Returns the named graph, creating it on first use. Creating a durable graph reads and syncs its
+// directory, so callers serving other clients must not create one (see contains). Each graph has its
+// own log flusher thread, which is why their number is capped.
+std::shared_ptr<GraphContext> GraphRegistry::getOrCreate(const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = graphs.find(name);
+        if (it != graphs.end())
+        {
+            return it->second;
+        }
+    }
+    std::lock_guard<std::mutex> creationLock(creationMutex);
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        auto it = graphs.find(name);
+        if (it != graphs.end())
+        {
+            return it->second; // Created by another connection while this one waited
+        }
+        if (config.maxGraphs > 0 && graphs.size() >= config.maxGraphs)
+        {
+            throw std::runtime_error("Too many graphs (the limit is " + std::to_string(config.maxGraphs) +
+                                     "); use an existing one");
+        }
+    }
+    return create(name);
+}
+
+// Returns true if the named graph exists
+bool GraphRegistry::contains(const std::string &name) const
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    return graphs.count(name) > 0;
+}
+
+// Creates a graph and pins it to the shard with the fewest graphs (caller holds creationMutex, or is
+// the constructor). The registry lock is not held while the graph is restored from disk.
+std::shared_ptr<GraphContext> GraphRegistry::create(const std::string &name)
+{
+    size_t shard;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        shard = std::min_element(graphsPerShard.begin(), graphsPerShard.end()) - graphsPerShard.begin();
+        ++graphsPerShard[shard];
+    }
+
+    auto context = std::make_shared<GraphContext>();
+    context->name = name;
+    context->shard = shard;
+    context->pipeline = shards[shard].get();
+    if (!config.dataDirectory.empty())
+    {
+        try
+        {
+            context->manager.enableDurability(config.dataDirectory + "/" + name, config.snapshotInterval);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            --graphsPerShard[shard];
+            throw;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        graphs[name] = context;
+    }
+
+    {
+        std::lock_guard<std::mutex> coutLock(coutMutex);
+        std::cout << "Graph '" << name << "' assigned to shard " << shard << std::endl;
+    }
+    return context;
+}
+
+// Returns all graphs sorted by name
+std::vector<std::shared_ptr<GraphContext>> GraphRegistry::listGraphs() const
+{
+    std::vector<std::shared_ptr<GraphContext>> result;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto &pair : graphs)
+        {
+            result.push_back(pair.second);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const auto &a, const auto &b)
+              { return a->name < b->name; });
+    return result;
+}
+
+// Returns the number of pipeline shards
+size_t GraphRegistry::getShardCount() const
+{
+    return shards.size();
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "CSRSnapshotCache.hpp"
+#include "GraphManager.hpp"
+#include "Pipeline.hpp"
+#include "QueryEngineCache.hpp"
+#include "ServerConfig.hpp"
+#include "../../common/WorkerPool.hpp"
+#include <memory>
+#include <mutex>
+#include <semaphore>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// A named graph: its own manager (and lock) plus the pipeline shard that runs its heavy work
+struct GraphContext
+{
+    std::string name;
+    size_t shard;
+    Pipeline *pipeline;
+    GraphManager manager;
+    QueryEngineCache queryEngines; // Answers mst_path / mst_distance / mst_bottleneck
+    CSRSnapshotCache csrSnapshots; // Feeds shortest_path / shortest_paths
+};
+
+// Owns all named graphs, the pipeline shards they are pinned to, and the compute threads the shards share.
+// Connections resolve a graph once (use_graph) and keep the shared_ptr, so the registry lock
+// is never touched while executing graph commands.
+class GraphRegistry
+{
+public:
+    GraphRegistry(const ServerConfig &config);
+    ~GraphRegistry();
+
+    void start();
+    void stop();
+    std::shared_ptr<GraphContext> getOrCreate(const std::string &name);
+    bool contains(const std::string &name) const;
+    std::vector<std::shared_ptr<GraphContext>> listGraphs() const;
+    size_t getShardCount() const;
+    const std::vector<std::unique_ptr<Pipeline>> &getShards() const { return shards; }
+    WorkerPool &getComputePool() { return computePool; }
+    std::counting_semaphore<> &getApspSlots() { return apspSlots; }
+    static bool isValidName(const std::string &name);
+
+private:
+    ServerConfig config;
+    WorkerPool computePool;               // Helper threads of apsp_stats and shortest path queries on every shard
+    std::counting_semaphore<> apspSlots;  // All-pairs matrices that may be in memory at once, server-wide
+    std::vector<std::unique_ptr<Pipeline>> shards; // Declared after the pool: their tasks use it until they stop
+    std::vector<size_t> graphsPerShard;
+    std::unordered_map<std::string, std::shared_ptr<GraphContext>> graphs;
+    mutable std::mutex registryMutex; // Guards graphs and graphsPerShard; never held during disk I/O
+    std::mutex creationMutex;         // Serializes creating graphs, which may restore them from disk
+
+    std::shared_ptr<GraphContext> create(const std::string &name);
+};
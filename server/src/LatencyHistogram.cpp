@@ -0,0 +1,89 @@
+// This file implements LatencyHistogram.
+//
+// Bucket layout: values below 32 map to themselves. A larger value with its highest set bit at
+// position m (m >= 5) maps to one of 16 buckets for [2^m, 2^(m+1)), chosen by the four bits below
+// the highest one.
+
+#include "LatencyHistogram.hpp"
+
+LatencyHistogram::LatencyHistogram() : count(0), sum(0), max(0)
+{
+    for (auto &bucket : buckets)
+    {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+int LatencyHistogram::bucketFor(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(linearBuckets))
+    {
+        return static_cast<int>(value);
+    }
+    int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude > maxMagnitude)
+    {
+        return bucketCount - 1;
+    }
+    int subBucket = static_cast<int>((value >> (magnitude - subBucketBits)) & ((1 << subBucketBits) - 1));
+    return linearBuckets + (magnitude - 5) * (1 << subBucketBits) + subBucket;
+}
+
+// Largest value that falls into the bucket
+uint64_t LatencyHistogram::upperBound(int bucket)
+{
+    if (bucket < linearBuckets)
+    {
+        return static_cast<uint64_t>(bucket);
+    }
+    int magnitude = 5 + (bucket - linearBuckets) / (1 << subBucketBits);
+    uint64_t subBucket = static_cast<uint64_t>((bucket - linearBuckets) % (1 << subBucketBits));
+    uint64_t width = uint64_t(1) << (magnitude - subBucketBits);
+    return (uint64_t(1) << magnitude) + (subBucket + 1) * width - 1;
+}
+
+void LatencyHistogram::record(uint64_t microseconds)
+{
+    buckets[bucketFor(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(microseconds, std::memory_order_relaxed);
+    uint64_t seen = max.load(std::memory_order_relaxed);
+    while (microseconds > seen && !max.compare_exchange_weak(seen, microseconds, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::recordSince(std::chrono::steady_clock::time_point start)
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+}
+
+// Walks the buckets until the requested share of values is covered. Concurrent records may make the
+// bucket total differ slightly from count; the walk uses its own total so the result stays consistent.
+uint64_t LatencyHistogram::getPercentile(double quantile) const
+{
+    uint64_t total = 0;
+    for (const auto &bucket : buckets)
+    {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total) + 0.5);
+    rank = rank < 1 ? 1 : (rank > total ? total : rank);
+    uint64_t seen = 0;
+    for (int i = 0; i < bucketCount; ++i)
+    {
+        seen += buckets[i].load(std::memory_order_relaxed);
+        if (seen >= rank)
+        {
+            uint64_t bound = upperBound(i);
+            uint64_t largest = getMax();
+            return bound < largest ? bound : largest;
+        }
+    }
+    return getMax();
+}
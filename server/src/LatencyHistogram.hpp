@@ -0,0 +1,37 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Lock-free latency histogram in the spirit of HDR histograms. Values below 32 us get a bucket each;
+// larger values get 16 buckets per power of two, so a reported percentile is within 1/16 of the true
+// value. Recording is a few relaxed atomic operations and never allocates.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(uint64_t microseconds);
+    void recordSince(std::chrono::steady_clock::time_point start);
+
+    uint64_t getCount() const { return count.load(std::memory_order_relaxed); }
+    uint64_t getSum() const { return sum.load(std::memory_order_relaxed); }
+    uint64_t getMax() const { return max.load(std::memory_order_relaxed); }
+    // Smallest bucket bound that at least quantile of the recorded values fall under (in microseconds)
+    uint64_t getPercentile(double quantile) const;
+
+private:
+    static const int linearBuckets = 32; // Values 0..31 are exact
+    static const int subBucketBits = 4;  // 16 buckets per power of two above that
+    static const int maxMagnitude = 40;  // Values from 2^41 us (about 25 days) share the last bucket
+    static const int bucketCount = linearBuckets + (maxMagnitude - 4) * (1 << subBucketBits);
+
+    std::array<std::atomic<uint64_t>, bucketCount> buckets;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> max;
+
+    static int bucketFor(uint64_t value);
+    static uint64_t upperBound(int bucket);
+};
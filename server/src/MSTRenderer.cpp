@@ -0,0 +1,269 @@
+// This file implements MSTRenderer.
+//
+// A tree is first turned into a flat adjacency array (offsets into one neighbor array, in the order
+// the edges were given, so the output matches the old recursive renderer). The tree format then walks
+// it with an explicit stack and one shared prefix string that grows by three characters on the way
+// down and shrinks on the way up, instead of copying two prefix strings per node.
+
+#include "MSTRenderer.hpp"
+#include <algorithm>
+#include <charconv>
+#include <unordered_map>
+
+namespace
+{
+    // Neighbors of every vertex of one tree, in edge order
+    struct FlatTree
+    {
+        std::vector<int> ids;
+        std::vector<size_t> offsets;
+        std::vector<int> neighbors;
+        std::vector<int> weights;
+    };
+
+    FlatTree flatten(const std::vector<Edge> &tree)
+    {
+        FlatTree flat;
+        std::unordered_map<int, int> indexOf;
+        indexOf.reserve(tree.size() + 1);
+        std::vector<int> degree;
+        auto indexFor = [&](int id)
+        {
+            auto [it, inserted] = indexOf.emplace(id, static_cast<int>(flat.ids.size()));
+            if (inserted)
+            {
+                flat.ids.push_back(id);
+                degree.push_back(0);
+            }
+            return it->second;
+        };
+        std::vector<std::pair<int, int>> endpoints;
+        endpoints.reserve(tree.size());
+        for (const Edge &edge : tree)
+        {
+            int u = indexFor(edge.source);
+            int v = indexFor(edge.destination);
+            ++degree[u];
+            ++degree[v];
+            endpoints.emplace_back(u, v);
+        }
+
+        flat.offsets.assign(flat.ids.size() + 1, 0);
+        for (size_t v = 0; v < degree.size(); ++v)
+        {
+            flat.offsets[v + 1] = flat.offsets[v] + degree[v];
+        }
+        flat.neighbors.resize(2 * tree.size());
+        flat.weights.resize(2 * tree.size());
+        std::vector<size_t> fill(flat.offsets.begin(), flat.offsets.end() - 1);
+        for (size_t e = 0; e < tree.size(); ++e)
+        {
+            auto [u, v] = endpoints[e];
+            flat.neighbors[fill[u]] = v;
+            flat.weights[fill[u]++] = tree[e].weight;
+            flat.neighbors[fill[v]] = u;
+            flat.weights[fill[v]++] = tree[e].weight;
+        }
+        return flat;
+    }
+}
+
+MSTRenderer::MSTRenderer(Format f, Sink s, size_t size) : format(f), sink(std::move(s)), chunkSize(size)
+{
+    buffer.reserve(chunkSize + 256);
+}
+
+// Maps a format name from a command to the enum; returns false for unknown names
+bool MSTRenderer::parseFormat(const std::string &name, Format &result)
+{
+    if (name == "tree")
+    {
+        result = Format::Tree;
+    }
+    else if (name == "edges")
+    {
+        result = Format::Edges;
+    }
+    else if (name == "parents")
+    {
+        result = Format::Parents;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+void MSTRenderer::flushIfFull()
+{
+    if (buffer.size() >= chunkSize)
+    {
+        sink(buffer);
+        buffer.clear();
+    }
+}
+
+void MSTRenderer::appendNumber(long long value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.append(digits, result.ptr);
+}
+
+void MSTRenderer::write(const std::string &text)
+{
+    buffer += text;
+    flushIfFull();
+}
+
+void MSTRenderer::finish()
+{
+    if (!buffer.empty())
+    {
+        sink(buffer);
+        buffer.clear();
+    }
+}
+
+// Renders one tree in the configured format
+void MSTRenderer::renderTree(const std::vector<Edge> &tree)
+{
+    if (tree.empty())
+    {
+        return;
+    }
+    if (format == Format::Edges)
+    {
+        for (const Edge &edge : tree)
+        {
+            appendNumber(edge.source);
+            buffer += ' ';
+            appendNumber(edge.destination);
+            buffer += ' ';
+            appendNumber(edge.weight);
+            buffer += '\n';
+            flushIfFull();
+        }
+        return;
+    }
+
+    FlatTree flat = flatten(tree);
+    const int root = 0; // The source of the first edge, as before
+
+    if (format == Format::Parents)
+    {
+        // Breadth-first from the root, so every parent is listed before its children
+        std::vector<int> parent(flat.ids.size(), -1);
+        std::vector<int> queue{root};
+        parent[root] = root;
+        for (size_t head = 0; head < queue.size(); ++head)
+        {
+            int u = queue[head];
+            appendNumber(flat.ids[u]);
+            buffer += ' ';
+            if (u == root)
+            {
+                buffer += "-1 0\n";
+            }
+            else
+            {
+                appendNumber(flat.ids[parent[u]]);
+                buffer += ' ';
+                for (size_t i = flat.offsets[u]; i < flat.offsets[u + 1]; ++i)
+                {
+                    if (flat.neighbors[i] == parent[u])
+                    {
+                        appendNumber(flat.weights[i]);
+                        break;
+                    }
+                }
+                buffer += '\n';
+            }
+            flushIfFull();
+            for (size_t i = flat.offsets[u]; i < flat.offsets[u + 1]; ++i)
+            {
+                int v = flat.neighbors[i];
+                if (parent[v] == -1)
+                {
+                    parent[v] = u;
+                    queue.push_back(v);
+                }
+            }
+        }
+        return;
+    }
+
+    // Tree format. Each frame remembers where its node's children start in the neighbor array and
+    // how long the prefix was before descending into it.
+    struct Frame
+    {
+        int node;
+        int parent;
+        size_t next;       // Next neighbor slot to visit
+        size_t prefixSize; // Prefix length for this node's children
+    };
+    std::string prefix;
+    std::vector<Frame> stack;
+
+    // Emits the line of a node and pushes its frame; the node is the last child of its parent if no
+    // other non-parent neighbor follows it
+    auto enter = [&](int node, int parent, int weight, bool isLast)
+    {
+        buffer += prefix;
+        if (parent != -1)
+        {
+            buffer += isLast ? "└─ " : "├─ ";
+            buffer += "Node ";
+            appendNumber(flat.ids[node]);
+            buffer += " [weight: ";
+            appendNumber(weight);
+            buffer += "]\n";
+        }
+        else
+        {
+            buffer += "Node ";
+            appendNumber(flat.ids[node]);
+            buffer += '\n';
+        }
+        flushIfFull();
+        prefix += isLast ? "   " : "│  ";
+        stack.push_back({node, parent, flat.offsets[node], prefix.size()});
+    };
+
+    enter(root, -1, 0, true);
+    while (!stack.empty())
+    {
+        Frame &frame = stack.back();
+        size_t end = flat.offsets[frame.node + 1];
+        while (frame.next < end && flat.neighbors[frame.next] == frame.parent)
+        {
+            ++frame.next;
+        }
+        if (frame.next == end)
+        {
+            stack.pop_back();
+            prefix.resize(stack.empty() ? 0 : stack.back().prefixSize);
+            continue;
+        }
+        size_t slot = frame.next++;
+        size_t after = frame.next;
+        while (after < end && flat.neighbors[after] == frame.parent)
+        {
+            ++after;
+        }
+        int node = frame.node;
+        prefix.resize(frame.prefixSize);
+        enter(flat.neighbors[slot], node, flat.weights[slot], after == end);
+    }
+}
+
+std::string MSTRenderer::toString(Format format, const std::vector<Edge> &tree)
+{
+    std::string result;
+    MSTRenderer renderer(format, [&result](std::string &chunk)
+                         { result += chunk; });
+    renderer.renderTree(tree);
+    renderer.finish();
+    return result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "../../common/Graph.hpp"
+#include "../../common/SpanningForest.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Renders spanning trees for clients without recursion and without building the whole text first.
+// Output is handed to a sink in chunks of about chunkSize bytes, so a pipeline worker can write a
+// huge tree to the socket while rendering it.
+class MSTRenderer
+{
+public:
+    enum class Format
+    {
+        Tree,   // Indented hierarchy with box-drawing characters (the classic output)
+        Edges,  // One "source destination weight" line per edge
+        Parents // One "vertex parent weight" line per vertex, parent -1 for the root
+    };
+
+    // Receives the next chunk of output; the renderer reuses its buffer after the call returns
+    using Sink = std::function<void(std::string &chunk)>;
+
+    MSTRenderer(Format format, Sink sink, size_t chunkSize = 64 * 1024);
+
+    static bool parseFormat(const std::string &name, Format &format);
+    Format getFormat() const { return format; }
+
+    void write(const std::string &text);
+    void renderTree(const std::vector<Edge> &tree);
+    // Flushes whatever is buffered; call once after the last render/write
+    void finish();
+
+    // Convenience for callers that need the whole text as one string
+    static std::string toString(Format format, const std::vector<Edge> &tree);
+
+private:
+    Format format;
+    Sink sink;
+    size_t chunkSize;
+    std::string buffer;
+
+    void flushIfFull();
+    void appendNumber(long long value);
+};
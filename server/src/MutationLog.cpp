@@ -0,0 +1,298 @@
+// This file implements the MutationLog class, a write-ahead log for graph mutations.
+// Log files are named mutations.<generation>.log; every line is "<lsn> <operation> <args...>".
+
+#include "MutationLog.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+extern std::mutex coutMutex;
+
+namespace
+{
+    // Returns the generation numbers of all log files in the directory, oldest first
+    std::vector<int> listGenerations(const std::string &directory)
+    {
+        std::vector<int> generations;
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(directory, ec))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.size() > 14 && name.compare(0, 10, "mutations.") == 0 &&
+                name.compare(name.size() - 4, 4, ".log") == 0)
+            {
+                generations.push_back(std::atoi(name.c_str() + 10));
+            }
+        }
+        std::sort(generations.begin(), generations.end());
+        return generations;
+    }
+
+    // Syncs the directory itself, so that a file just created in it survives a crash
+    void syncDirectory(const std::string &directory)
+    {
+        int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+        if (dirFd < 0 || ::fsync(dirFd) != 0)
+        {
+            std::string reason = std::strerror(errno);
+            if (dirFd >= 0)
+            {
+                ::close(dirFd);
+            }
+            throw std::runtime_error("Cannot sync directory " + directory + ": " + reason);
+        }
+        ::close(dirFd);
+    }
+}
+
+// Constructor: the log is not usable until open() is called
+MutationLog::MutationLog(const std::string &dir)
+    : directory(dir), fd(-1), generation(0), assignedLsn(0), durableLsn(0), syncCount(0),
+      flushing(false), running(false), failed(false) {}
+
+// Destructor: flushes outstanding records and closes the file
+MutationLog::~MutationLog()
+{
+    close();
+}
+
+// Builds the file name of a log generation
+std::string MutationLog::generationPath(const std::string &dir, int gen)
+{
+    return dir + "/mutations." + std::to_string(gen) + ".log";
+}
+
+// Opens a fresh generation after replay and starts the flusher thread
+void MutationLog::open(uint64_t lastLsn)
+{
+    std::vector<int> generations = listGenerations(directory);
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        generation = generations.empty() ? 0 : generations.back();
+        assignedLsn = lastLsn;
+        durableLsn = lastLsn;
+        openGeneration();
+        running = true;
+    }
+    flusherThread = std::thread(&MutationLog::run, this);
+}
+
+// Creates the next generation file (caller holds logMutex). fdatasync on the file does not cover
+// its directory entry, so the directory is synced before any record is acknowledged in it.
+void MutationLog::openGeneration()
+{
+    ++generation;
+    std::string path = generationPath(directory, generation);
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open mutation log " + path + ": " + std::strerror(errno));
+    }
+    syncDirectory(directory);
+}
+
+// Stops the flusher after it has written everything that was appended
+void MutationLog::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        if (!running)
+        {
+            return;
+        }
+        running = false;
+    }
+    flushCondition.notify_one();
+    if (flusherThread.joinable())
+    {
+        flusherThread.join();
+    }
+    if (fd != -1)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// Buffers a record for the next group commit and returns its LSN.
+// Callers append while holding the lock that ordered the mutation, so LSN order matches apply order.
+uint64_t MutationLog::append(const std::string &record)
+{
+    uint64_t lsn;
+    {
+        std::lock_guard<std::mutex> lock(logMutex);
+        lsn = ++assignedLsn;
+        pending += std::to_string(lsn);
+        pending += ' ';
+        pending += record;
+        pending += '\n';
+    }
+    flushCondition.notify_one();
+    return lsn;
+}
+
+// Blocks until the record with the given LSN has been synced to disk
+void MutationLog::waitDurable(uint64_t lsn)
+{
+    std::unique_lock<std::mutex> lock(logMutex);
+    durableCondition.wait(lock, [this, lsn]
+                          { return durableLsn >= lsn || failed; });
+    if (failed)
+    {
+        throw std::runtime_error("Mutation log write failed");
+    }
+}
+
+// Returns the LSN of the most recently appended record
+uint64_t MutationLog::lastLsn() const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    return assignedLsn;
+}
+
+// True once a write or sync has failed; nothing appended after that can become durable
+bool MutationLog::hasFailed() const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    return failed;
+}
+
+// Returns how many fdatasync calls the flusher has made (one per group commit)
+uint64_t MutationLog::getSyncCount() const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    return syncCount;
+}
+
+// Returns the generation new records are appended to
+int MutationLog::currentGeneration() const
+{
+    std::lock_guard<std::mutex> lock(logMutex);
+    return generation;
+}
+
+// Switches appends to a new generation once everything buffered so far is durable.
+// Returns the generation that was closed; it can be deleted after a snapshot covers it.
+int MutationLog::rotate()
+{
+    std::unique_lock<std::mutex> lock(logMutex);
+    durableCondition.wait(lock, [this]
+                          { return (pending.empty() && !flushing) || failed; });
+    int closedGeneration = generation;
+    ::close(fd);
+    openGeneration();
+    return closedGeneration;
+}
+
+// Deletes log generations that are fully covered by a snapshot
+void MutationLog::removeGenerationsThrough(int gen)
+{
+    for (int existing : listGenerations(directory))
+    {
+        if (existing <= gen)
+        {
+            std::remove(generationPath(directory, existing).c_str());
+        }
+    }
+}
+
+// Flusher loop: each iteration writes and syncs one batch of records
+void MutationLog::run()
+{
+    while (true)
+    {
+        std::string batch;
+        uint64_t batchLsn;
+        int batchFd;
+        {
+            std::unique_lock<std::mutex> lock(logMutex);
+            flushCondition.wait(lock, [this]
+                                { return !pending.empty() || !running; });
+            if (pending.empty())
+            {
+                break; // Stopped and nothing left to write
+            }
+            batch.swap(pending);
+            batchLsn = assignedLsn;
+            batchFd = fd;
+            flushing = true;
+        } // Appenders keep filling the next batch while this one is written
+
+        bool ok = true;
+        size_t written = 0;
+        while (ok && written < batch.size())
+        {
+            ssize_t n = ::write(batchFd, batch.data() + written, batch.size() - written);
+            if (n < 0 && errno != EINTR)
+            {
+                ok = false;
+            }
+            else if (n > 0)
+            {
+                written += static_cast<size_t>(n);
+            }
+        }
+        if (ok && ::fdatasync(batchFd) != 0)
+        {
+            ok = false;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(logMutex);
+            flushing = false;
+            if (ok)
+            {
+                durableLsn = batchLsn;
+                ++syncCount;
+            }
+            else
+            {
+                failed = true;
+                std::lock_guard<std::mutex> coutLock(coutMutex);
+                std::cerr << "Mutation log write failed: " << std::strerror(errno) << std::endl;
+            }
+        }
+        durableCondition.notify_all();
+    }
+    durableCondition.notify_all();
+}
+
+// Reads all generations in order and hands each complete record newer than afterLsn to apply.
+// A torn final line (crash in the middle of a write) is ignored.
+uint64_t MutationLog::replay(const std::string &dir, uint64_t afterLsn,
+                             const std::function<void(const std::string &)> &apply)
+{
+    uint64_t lastLsn = afterLsn;
+    for (int gen : listGenerations(dir))
+    {
+        std::ifstream in(generationPath(dir, gen), std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        const std::string data = buffer.str();
+
+        size_t lineStart = 0;
+        size_t lineEnd;
+        while ((lineEnd = data.find('\n', lineStart)) != std::string::npos)
+        {
+            char *afterNumber = nullptr;
+            uint64_t lsn = std::strtoull(data.c_str() + lineStart, &afterNumber, 10);
+            if (afterNumber != data.c_str() + lineStart && lsn > lastLsn)
+            {
+                size_t recordStart = static_cast<size_t>(afterNumber - data.c_str()) + 1;
+                apply(data.substr(recordStart, lineEnd - recordStart));
+                lastLsn = lsn;
+            }
+            lineStart = lineEnd + 1;
+        }
+    }
+    return lastLsn;
+}
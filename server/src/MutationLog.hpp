@@ -0,0 +1,53 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Append-only, fsync'ed log of graph mutations with group commit.
+// Writers append records under their own lock and then wait for durability; a single
+// flusher thread writes and syncs everything that accumulated since the previous sync,
+// so many concurrent mutations share one fdatasync.
+class MutationLog
+{
+public:
+    MutationLog(const std::string &directory);
+    ~MutationLog();
+
+    void open(uint64_t lastLsn);
+    void close();
+    uint64_t append(const std::string &record);
+    void waitDurable(uint64_t lsn);
+    uint64_t lastLsn() const;
+    bool hasFailed() const;
+    int rotate();
+    void removeGenerationsThrough(int generation);
+    uint64_t getSyncCount() const;
+    int currentGeneration() const;
+
+    // Replays every record with an LSN greater than afterLsn; returns the highest LSN seen
+    static uint64_t replay(const std::string &directory, uint64_t afterLsn,
+                           const std::function<void(const std::string &)> &apply);
+
+private:
+    std::string directory;
+    int fd;
+    int generation;
+    std::string pending;  // records waiting for the next group commit
+    uint64_t assignedLsn; // last LSN handed out by append
+    uint64_t durableLsn;  // last LSN known to be on disk
+    uint64_t syncCount;
+    bool flushing;
+    bool running;
+    bool failed;
+    mutable std::mutex logMutex;
+    std::condition_variable flushCondition;
+    std::condition_variable durableCondition;
+    std::thread flusherThread;
+
+    void run();
+    void openGeneration();
+    static std::string generationPath(const std::string &directory, int generation);
+};
@@ -1,8 +1,17 @@
 #include "Pipeline.hpp"
 #include "../../common/MSTMetrics.hpp"
+#include "Tracer.hpp"
+#include "CpuAffinity.hpp"
+#include "../../common/CancellationToken.hpp"
 #include <sstream>
 #include <iostream>
 #include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+#include <stdexcept>
+#include <chrono>
+#include <thread>
 
 // This line declares an external mutex named 'coutMutex'
 // It's used to synchronize access to std::cout across multiple threads
@@ -10,13 +19,17 @@
 // (likely in another source file) and we're just referencing it here
 extern std::mutex coutMutex;
 
+// Response sent when a request is refused or shed because a stage queue is full
+const char *const Pipeline::busyMessage = "Error: Server busy, try again later.";
+
 // The Pipeline class manages the processing of graph-related tasks using Active Objects
-Pipeline::Pipeline(GraphManager &gm) : graphManager(gm)
+Pipeline::Pipeline(size_t queueCapacity, OverflowPolicy policy) : nextWorker(0), numaNode(-1), tasksSinceReplan(0)
 {
-    // Initialize the pipeline with multiple Active Objects
-    for (int i = 0; i < 5; ++i)
+    // Initialize the pipeline with multiple Active Objects, each with a bounded queue
+    for (int i = 0; i < stageCount; ++i)
     {
-        activeObjects.push_back(std::make_unique<ActiveObject>());
+        activeObjects.push_back(std::make_unique<ActiveObject>(queueCapacity, policy));
+        plans[i].firstWorker = i; // Until costs are measured, every stage has its own worker
     }
 }
 
@@ -25,6 +38,65 @@ Pipeline::~Pipeline()
     stop();
 }
 
+// Pins stage k to cpus[k % cpus.size()]. When all of them are on one NUMA node, graph snapshots
+// whose memory is on another node are copied before use (see localize).
+void Pipeline::setAffinity(const std::vector<int> &cpus)
+{
+    if (cpus.empty())
+    {
+        return;
+    }
+    numaNode = CpuAffinity::getNodeOfCpu(cpus[0]);
+    for (size_t i = 0; i < activeObjects.size(); ++i)
+    {
+        int cpu = cpus[i % cpus.size()];
+        activeObjects[i]->setAffinity({cpu});
+        if (CpuAffinity::getNodeOfCpu(cpu) != numaNode)
+        {
+            numaNode = -1;
+        }
+    }
+}
+
+// First-touch placement: a copy made on a (pinned) worker allocates its adjacency lists on the
+// worker's node, so the MST, forest and metrics stages read local memory instead of crossing the
+// interconnect for every edge. Snapshots whose memory already is on this node are used as they are.
+// Each snapshot is copied once; later stages and requests for the same graph version reuse the copy.
+std::shared_ptr<const Graph> Pipeline::localize(std::shared_ptr<const Graph> graph)
+{
+    if (numaNode < 0 || !graph || CpuAffinity::getNodeOfAddress(graph.get()) == numaNode)
+    {
+        return graph;
+    }
+    {
+        std::lock_guard<std::mutex> lock(localMutex);
+        for (const LocalCopy &copy : localCopies)
+        {
+            if (copy.source.lock() == graph)
+            {
+                return copy.local;
+            }
+        }
+    }
+
+    // Copied without the lock; if two stages race, the first copy is kept
+    auto local = std::make_shared<const Graph>(*graph);
+    std::lock_guard<std::mutex> lock(localMutex);
+    for (const LocalCopy &copy : localCopies)
+    {
+        if (copy.source.lock() == graph)
+        {
+            return copy.local;
+        }
+    }
+    localCopies.push_front(LocalCopy{graph, local});
+    if (localCopies.size() > localCopyLimit)
+    {
+        localCopies.pop_back();
+    }
+    return local;
+}
+
 // Start all Active Objects in the pipeline
 void Pipeline::start()
 {
@@ -43,90 +115,836 @@ void Pipeline::stop()
     }
 }
 
-// Calculate metrics for a given graph and its Minimum Spanning Tree (MST)
-void Pipeline::calculateMetrics(const Graph &graph, const std::vector<Edge> &mst, std::function<void(const std::string &)> responseCallback)
+// Names of the stages in traces
+const char *const Pipeline::stageNames[stageCount] = {"mst", "metrics stage 1", "metrics stage 2",
+                                                      "metrics stage 3", "metrics stage 4", "metrics stage 5"};
+
+namespace
 {
-    activeObjects[0]->enqueue([this, graph, mst, responseCallback]()
-                              {
+    // What a stage calls when it refuses or sheds a task: the owner's error callback, or a log line
+    // when the task has no owner to tell
+    std::function<void()> makeBusyCallback(const char *stageName, const std::function<void(const std::string &)> &onBusy)
+    {
+        return [stageName, onBusy]()
+        {
+            if (onBusy)
+            {
+                onBusy(Pipeline::busyMessage);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cerr << "Dropped " << stageName << " task: " << Pipeline::busyMessage << std::endl;
+        };
+    }
+
+    // Gives back a server-wide slot when the task that took it ends
+    struct SlotGuard
+    {
+        std::counting_semaphore<> &slots;
+        ~SlotGuard() { slots.release(); }
+    };
+}
+
+// Enqueue a task on a stage; if the stage refuses or later sheds it, the request gets a busy response.
+// While tracing is on, the task carries the current request ID and records its queue wait and run time.
+void Pipeline::dispatch(int stage, std::function<void()> task, const std::function<void(const std::string &)> &onBusy)
+{
+    std::function<void()> busy = makeBusyCallback(stageNames[stage], onBusy);
+    if (!activeObjects[stage]->enqueue(Tracer::wrap(CancellationToken::bind(std::move(task)), stageNames[stage], stage), busy))
+    {
+        busy();
+    }
+}
+
+// True on one of this pipeline's worker threads, where a task may run the next stage inline
+bool Pipeline::isWorkerThread() const
+{
+    std::thread::id self = std::this_thread::get_id();
+    for (const auto &ao : activeObjects)
+    {
+        if (ao->getThreadId() == self)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Microseconds spent in stages run inline by the stage currently running on this thread
+static thread_local uint64_t nestedStageMicros = 0;
+
+// Dispatches a metrics stage according to the current plan: a fused stage runs inline when called
+// from a worker; otherwise the least loaded of the stage's workers gets the task. If that worker is
+// the calling one, the task runs inline too: queueing onto its own full queue would block forever.
+// Either way the task's run time, minus any later stages it ran inline, feeds the stage's cost average.
+void Pipeline::dispatchAdaptive(int stage, std::function<void()> task, const std::function<void(const std::string &)> &onBusy)
+{
+    StagePlan &plan = plans[stage];
+    auto timed = [this, stage, task = std::move(task)]()
+    {
+        uint64_t outer = nestedStageMicros;
+        nestedStageMicros = 0;
+        auto started = std::chrono::steady_clock::now();
+        task();
+        uint64_t elapsed = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                                     std::chrono::steady_clock::now() - started)
+                                                     .count());
+        uint64_t nested = std::min(nestedStageMicros, elapsed);
+        nestedStageMicros = outer + elapsed;
+        recordStageCost(stage, elapsed - nested);
+    };
+
+    int workers = plan.workers.load(std::memory_order_relaxed);
+    if (workers == 0 && isWorkerThread())
+    {
+        Tracer::wrap(timed, stageNames[stage], stage)();
+        return;
+    }
+
+    int first = plan.firstWorker.load(std::memory_order_relaxed);
+    int best = workers == 0 ? stage : first;
+    size_t bestLoad = activeObjects[best]->getLoad();
+    for (int i = 1; i < workers && bestLoad > 0; ++i)
+    {
+        size_t load = activeObjects[first + i]->getLoad();
+        if (load < bestLoad)
+        {
+            best = first + i;
+            bestLoad = load;
+        }
+    }
+    if (activeObjects[best]->getThreadId() == std::this_thread::get_id())
+    {
+        Tracer::wrap(timed, stageNames[stage], stage)();
+        return;
+    }
+    std::function<void()> busy = makeBusyCallback(stageNames[stage], onBusy);
+    if (!activeObjects[best]->enqueue(Tracer::wrap(CancellationToken::bind(std::move(timed)), stageNames[stage], stage), busy))
+    {
+        busy();
+    }
+}
+
+// Folds one measured run time into the stage's moving average (weight 1/8) and replans periodically
+void Pipeline::recordStageCost(int stage, uint64_t micros)
+{
+    StagePlan &plan = plans[stage];
+    uint64_t average = plan.averageMicros.load(std::memory_order_relaxed);
+    uint64_t updated;
+    do
+    {
+        updated = plan.samples.load(std::memory_order_relaxed) == 0 ? micros : average - average / 8 + micros / 8;
+    } while (!plan.averageMicros.compare_exchange_weak(average, updated, std::memory_order_relaxed));
+    plan.samples.fetch_add(1, std::memory_order_relaxed);
+
+    if (tasksSinceReplan.fetch_add(1, std::memory_order_relaxed) + 1 >= replanInterval)
+    {
+        std::unique_lock<std::mutex> lock(planMutex, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            tasksSinceReplan.store(0, std::memory_order_relaxed);
+            replan();
+        }
+    }
+}
+
+// Splits the metric workers (1-5) among the metric stages in proportion to their average cost.
+// Stages with too few samples keep a worker; stages under the fuse threshold get none.
+void Pipeline::replan()
+{
+    const int workerCount = stageCount - firstMetricStage;
+    std::array<uint64_t, stageCount> cost{};
+    std::array<int, stageCount> share{};
+    uint64_t totalCost = 0;
+    int assigned = 0;
+    for (int stage = firstMetricStage; stage < stageCount; ++stage)
+    {
+        bool measured = plans[stage].samples.load(std::memory_order_relaxed) >= minSamples;
+        cost[stage] = measured ? plans[stage].averageMicros.load(std::memory_order_relaxed) : fuseThresholdMicros;
+        if (measured && cost[stage] < fuseThresholdMicros)
+        {
+            continue; // Fused
+        }
+        cost[stage] = std::max<uint64_t>(cost[stage], 1);
+        share[stage] = 1;
+        totalCost += cost[stage];
+        ++assigned;
+    }
+    if (assigned == 0)
+    {
+        // Everything is cheap: fuse all stages into stage 1's task, which still runs on worker 1
+        share[firstMetricStage] = 1;
+        assigned = 1;
+        totalCost = 1;
+    }
+
+    // Hand out the remaining workers one at a time to the stage with the highest cost per worker
+    for (; assigned < workerCount; ++assigned)
+    {
+        int heaviest = -1;
+        for (int stage = firstMetricStage; stage < stageCount; ++stage)
+        {
+            if (share[stage] > 0 && (heaviest < 0 || cost[stage] * share[heaviest] > cost[heaviest] * share[stage]))
+            {
+                heaviest = stage;
+            }
+        }
+        ++share[heaviest];
+    }
+
+    int nextFree = firstMetricStage;
+    for (int stage = firstMetricStage; stage < stageCount; ++stage)
+    {
+        plans[stage].firstWorker.store(share[stage] > 0 ? nextFree : stage, std::memory_order_relaxed);
+        plans[stage].workers.store(share[stage], std::memory_order_relaxed);
+        nextFree += share[stage];
+    }
+}
+
+// One line per metrics stage: its average cost and how many workers it has (or that it is fused)
+std::string Pipeline::getPlanString() const
+{
+    std::stringstream ss;
+    for (int stage = firstMetricStage; stage < stageCount; ++stage)
+    {
+        const StagePlan &plan = plans[stage];
+        int workers = plan.workers.load(std::memory_order_relaxed);
+        int first = plan.firstWorker.load(std::memory_order_relaxed);
+        ss << stageNames[stage] << ": avg=" << plan.averageMicros.load(std::memory_order_relaxed) << "us ";
+        if (workers == 0)
+        {
+            ss << "fused\n";
+        }
+        else
+        {
+            ss << "workers=" << first << "-" << first + workers - 1 << "\n";
+        }
+    }
+    return ss.str();
+}
+
+// Total number of tasks queued across all stages
+size_t Pipeline::getQueueDepth() const
+{
+    size_t depth = 0;
+    for (const auto &ao : activeObjects)
+    {
+        depth += ao->getQueueDepth();
+    }
+    return depth;
+}
+
+// Number of tasks queued at each stage
+std::vector<size_t> Pipeline::getStageDepths() const
+{
+    std::vector<size_t> depths;
+    for (const auto &ao : activeObjects)
+    {
+        depths.push_back(ao->getQueueDepth());
+    }
+    return depths;
+}
+
+// True while every stage queue has a free slot, so a new request can enter and move through the stages
+bool Pipeline::hasRoom() const
+{
+    for (const auto &ao : activeObjects)
+    {
+        if (ao->getCapacity() > 0 && ao->getQueueDepth() >= ao->getCapacity())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Combined capacity of all stage queues (0 = unbounded)
+size_t Pipeline::getQueueCapacity() const
+{
+    return activeObjects[0]->getCapacity() * activeObjects.size();
+}
+
+// Tasks refused by full stage queues
+uint64_t Pipeline::getRejectedCount() const
+{
+    uint64_t count = 0;
+    for (const auto &ao : activeObjects)
+    {
+        count += ao->getRejectedCount();
+    }
+    return count;
+}
+
+// Tasks shed from full stage queues
+uint64_t Pipeline::getDroppedCount() const
+{
+    uint64_t count = 0;
+    for (const auto &ao : activeObjects)
+    {
+        count += ao->getDroppedCount();
+    }
+    return count;
+}
+
+// Calculate the MST of a graph snapshot on the first Active Object and hand it to resultCallback
+void Pipeline::calculateMST(std::shared_ptr<const Graph> graph, const std::string &algorithm,
+                            std::function<void(const std::vector<Edge> &)> resultCallback,
+                            std::function<void(const std::string &)> errorCallback)
+{
+    dispatch(0, [this, graph, algorithm, resultCallback, errorCallback]()
+             {
         try {
-            // Log initial information about the graph and MST
+            auto local = localize(graph);
+            auto mstCalculator = MSTFactory::createMST(algorithm);
+            auto mst = mstCalculator->findMST(*local);
             {
                 std::lock_guard<std::mutex> lock(coutMutex);
-                std::cout << "Calculating metrics" << std::endl;
-                std::cout << "Graph vertices: " << graph.getVertices() << std::endl;
                 std::cout << "MST edges: " << mst.size() << std::endl;
             }
-
-            // Check if the MST is valid
-            if (mst.empty() || graph.getVertices() < 2)
+            resultCallback(mst);
+        } catch (const std::exception& e) {
             {
                 std::lock_guard<std::mutex> lock(coutMutex);
-                std::cerr << "Error: MST is empty or graph has less than 2 vertices" << std::endl;
-                responseCallback("Error: Cannot calculate metrics. MST is empty or graph has less than 2 vertices.");
-                return;
+                std::cerr << "Error calculating MST: " << e.what() << std::endl;
             }
+            errorCallback("Error calculating MST: " + std::string(e.what()));
+        } }, errorCallback);
+}
+
+// Records the first error reported by any task of a fan-out
+void Pipeline::FanIn::fail(const std::string &message)
+{
+    std::lock_guard<std::mutex> lock(errorMutex);
+    if (error.empty())
+    {
+        error = message;
+    }
+}
+
+// Spreads tasks over all workers of the pipeline. Fan-out often starts on a worker thread, so it
+// never blocks: a task whose worker queue is full runs inline instead. Queued chunks are exempt from
+// shed-oldest, since the FanIn only answers once every chunk has reported.
+void Pipeline::runParallel(std::vector<std::function<void()>> &tasks)
+{
+    for (auto &task : tasks)
+    {
+        size_t stage = nextWorker++ % activeObjects.size();
+        task = Tracer::wrap(CancellationToken::bind(std::move(task)), "fan-out", static_cast<int>(stage));
+        if (!activeObjects[stage]->tryEnqueue(task))
+        {
+            task();
+        }
+    }
+}
+
+// Groups components into at most `bins` chunks of similar total size (largest component first,
+// always into the lightest chunk) so that one huge component does not serialize the rest
+std::vector<std::vector<size_t>> Pipeline::balanceComponents(const std::vector<int> &componentSizes, size_t bins)
+{
+    std::vector<size_t> order(componentSizes.size());
+    for (size_t c = 0; c < order.size(); ++c)
+    {
+        order[c] = c;
+    }
+    std::sort(order.begin(), order.end(), [&componentSizes](size_t a, size_t b)
+              { return componentSizes[a] > componentSizes[b]; });
+
+    bins = std::max<size_t>(1, std::min(bins, componentSizes.size()));
+    std::vector<std::vector<size_t>> chunks(bins);
+    std::vector<long long> load(bins, 0);
+    for (size_t c : order)
+    {
+        size_t lightest = std::min_element(load.begin(), load.end()) - load.begin();
+        chunks[lightest].push_back(c);
+        load[lightest] += componentSizes[c];
+    }
+    return chunks;
+}
 
-            // Log MST edges for debugging
+// Calculate a minimum spanning forest (one tree per component). The MST stage labels the
+// connected components; the components are then solved in parallel on all workers of the
+// pipeline and merged in component order by whichever task finishes last.
+void Pipeline::calculateForest(std::shared_ptr<const Graph> graph, const std::string &algorithm,
+                               std::function<void(std::shared_ptr<const SpanningForest>)> resultCallback,
+                               std::function<void(const std::string &)> errorCallback)
+{
+    dispatch(0, [this, graph, algorithm, resultCallback, errorCallback]()
+             {
+        try {
+            auto local = localize(graph);
+            auto forest = std::make_shared<SpanningForest>();
+            forest->assignComponents(*local);
+            auto componentVertices = std::make_shared<const std::vector<std::vector<int>>>(forest->getComponentVertices());
+            auto trees = std::make_shared<std::vector<std::vector<Edge>>>(forest->getComponentCount());
+            std::vector<std::vector<size_t>> chunks = balanceComponents(forest->componentSizes, activeObjects.size());
+            auto state = std::make_shared<FanIn>(chunks.size());
             {
                 std::lock_guard<std::mutex> lock(coutMutex);
-                std::cout << "MST edges:" << std::endl;
-                for (const auto &edge : mst)
-                {
-                    std::cout << "(" << edge.source << ", " << edge.destination << ", " << edge.weight << ")" << std::endl;
-                }
+                std::cout << "Forest components: " << forest->getComponentCount() << ", solving in " << chunks.size() << " chunks" << std::endl;
             }
 
-            // Use the second Active Object to calculate total weight and longest distance
-            activeObjects[1]->enqueue([this, graph, mst, responseCallback]()
+            std::vector<std::function<void()>> tasks;
+            for (auto &chunk : chunks)
             {
-                MSTMetrics metrics;
-                int totalWeight = metrics.getTotalWeight(mst);
-                
-                
-                // Use the third Active Object to calculate shortest and average distance
-                activeObjects[2]->enqueue([this, graph, mst, totalWeight, responseCallback]()
+                tasks.push_back([graph = local, algorithm, chunk, componentVertices, trees, forest, state, resultCallback, errorCallback]()
                 {
-                    MSTMetrics metrics;
-                    int longestDistance = metrics.getLongestDistance(graph, mst);
-                    
-                    activeObjects[3]->enqueue([this, graph, mst , totalWeight, longestDistance, responseCallback]()
-                    {   
-                        MSTMetrics metrics;
-                        int shortestDistance = metrics.getShortestDistance(mst);
-                        
-                        activeObjects[4]->enqueue([this, graph, mst , totalWeight, longestDistance, shortestDistance, responseCallback]()
-                        {   
-                            MSTMetrics metrics;
-                            double averageDistance = metrics.getAverageDistance(graph, mst);
-                            
-                            // Prepare the response string with calculated metrics
-                            std::stringstream ss;
-                            ss << "MST Metrics:\n";
-                            ss << "Total Weight: " << totalWeight << "\n";
-                            ss << "Longest Distance: " << longestDistance << "\n";
-                            ss << "Shortest Distance: " << shortestDistance << "\n";
-                            ss << "Average Distance: " << averageDistance << "\n";
-
-                            // Log and send the response
+                    try {
+                        auto mstCalculator = MSTFactory::createMST(algorithm);
+                        for (size_t c : chunk)
+                        {
+                            if ((*componentVertices)[c].size() > 1)
                             {
-                                std::lock_guard<std::mutex> lock(coutMutex);
-                                std::cout << "Sending response" << std::endl;
+                                Graph component = graph->getSubgraph((*componentVertices)[c]);
+                                (*trees)[c] = mstCalculator->findSpanningForest(component).edges;
                             }
-                            responseCallback(ss.str());
-                    
-                        });
-                    });
+                        }
+                    } catch (const std::exception& e) {
+                        state->fail(e.what());
+                    }
+                    if (!state->finishOne())
+                    {
+                        return;
+                    }
+
+                    // Last chunk: merge the trees in component order
+                    if (!state->error.empty())
+                    {
+                        errorCallback("Error calculating spanning forest: " + state->error);
+                        return;
+                    }
+                    forest->componentOffsets.assign(1, 0);
+                    for (auto &tree : *trees)
+                    {
+                        forest->edges.insert(forest->edges.end(), tree.begin(), tree.end());
+                        forest->componentOffsets.push_back(forest->edges.size());
+                    }
+                    resultCallback(forest);
                 });
+            }
+            runParallel(tasks);
+        } catch (const std::exception& e) {
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cerr << "Error calculating spanning forest: " << e.what() << std::endl;
+            }
+            errorCallback("Error calculating spanning forest: " + std::string(e.what()));
+        } }, errorCallback);
+}
+
+// Calculate a minimum spanning forest with the external-memory Kruskal on the MST stage.
+// Files live in directory, which also holds the sorted runs. If graph is set it is first exported to
+// edgeFile; the forest edges are written to "<edgeFile>.mst" as they are found, so neither the input
+// nor the result has to fit in memory.
+void Pipeline::calculateExternalMST(std::shared_ptr<const Graph> graph, const std::string &directory,
+                                    const std::string &edgeFile, size_t memoryBudget,
+                                    std::function<void(const ExternalKruskal::Stats &)> resultCallback,
+                                    std::function<void(const std::string &)> errorCallback)
+{
+    dispatch(0, [graph, directory, edgeFile, memoryBudget, resultCallback, errorCallback]()
+             {
+        std::string inputPath = directory + "/" + edgeFile;
+        std::string resultFile = inputPath + ".mst";
+        try {
+            if (graph)
+            {
+                ExternalKruskal::writeEdgeFile(*graph, inputPath);
+            }
+
+            std::ofstream out(resultFile, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                throw std::runtime_error("Cannot create " + resultFile);
+            }
+            out.write(ExternalKruskal::fileMagic, sizeof(ExternalKruskal::fileMagic));
+            std::vector<EdgeRecord> pending;
+            auto flush = [&out, &pending, &resultFile]()
+            {
+                out.write(reinterpret_cast<const char *>(pending.data()), pending.size() * sizeof(EdgeRecord));
+                if (!out)
+                {
+                    throw std::runtime_error("Failed to write " + resultFile);
+                }
+                pending.clear();
+            };
+
+            ExternalKruskal kruskal(memoryBudget, directory);
+            ExternalKruskal::Stats stats = kruskal.run(inputPath, [&pending, &flush](const Edge &edge)
+            {
+                pending.push_back({edge.source, edge.destination, edge.weight});
+                if (pending.size() == 4096)
+                {
+                    flush();
+                }
             });
+            flush();
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cout << "External MST: " << stats.edgesRead << " edges read, " << stats.runs << " runs, "
+                          << stats.forestEdges << " forest edges" << std::endl;
+            }
+            resultCallback(stats);
+        } catch (const std::exception& e) {
+            std::remove(resultFile.c_str()); // Never leave a partial forest behind
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cerr << "Error calculating external MST: " << e.what() << std::endl;
+            }
+            errorCallback("Error calculating external MST: " + std::string(e.what()));
+        } }, errorCallback);
+}
+
+// Builds a synthetic graph off the connection threads; resultCallback may move the graph away
+void Pipeline::generateGraph(const GraphGenerator::Spec &spec, std::function<void(Graph &)> resultCallback,
+                             std::function<void(const std::string &)> errorCallback)
+{
+    dispatch(0, [spec, resultCallback, errorCallback]()
+             {
+        try {
+            Graph graph = GraphGenerator::generate(spec);
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cout << "Generated " << spec.kind << " graph: " << graph.getVertices() << " vertices, "
+                          << graph.getEdges() << " edges" << std::endl;
+            }
+            resultCallback(graph);
+        } catch (const std::exception& e) {
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cerr << "Error generating graph: " << e.what() << std::endl;
+            }
+            errorCallback("Error generating graph: " + std::string(e.what()));
+        } }, errorCallback);
+}
+
+// Shortest distances between all vertex pairs of the whole graph. The engine spreads its tiles over
+// the server's shared compute pool; the stage worker only coordinates them. Each run holds one of the
+// server-wide slots for its matrix and is refused when all of them are taken.
+void Pipeline::calculateAllPairsStats(std::shared_ptr<const Graph> graph, WorkerPool &pool, size_t threads,
+                                      std::counting_semaphore<> &slots,
+                                      std::function<void(const APSPStats &)> resultCallback,
+                                      std::function<void(const std::string &)> errorCallback)
+{
+    dispatch(0, [graph, &pool, threads, &slots, resultCallback, errorCallback]()
+             {
+        if (!slots.try_acquire())
+        {
+            errorCallback("Error: Too many all-pairs calculations in progress, try again later.");
+            return;
+        }
+        SlotGuard slot{slots}; // Outlives the engine, so the slot is freed only after the matrix
+        try {
+            APSPEngine engine(&pool, threads);
+            engine.run(*graph);
+            APSPStats stats = engine.getStats();
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cout << "All-pairs shortest paths: " << stats.vertices << " vertices in " << stats.milliseconds
+                          << " ms (" << stats.kernel << ", " << stats.threads << " threads)" << std::endl;
+            }
+            resultCallback(stats);
         } catch (const std::exception& e) {
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cerr << "Error calculating all-pairs shortest paths: " << e.what() << std::endl;
+            }
+            errorCallback("Error calculating all-pairs shortest paths: " + std::string(e.what()));
+        } }, errorCallback);
+}
+
+// Single-source shortest paths on the graph's CSR snapshot (converted here when the graph changed).
+// query runs the sources it needs on the engine and answers the client; the engine spreads its work
+// over up to threads threads of the server's shared compute pool.
+void Pipeline::calculateShortestPaths(std::shared_ptr<const Graph> graph, uint64_t version, CSRSnapshotCache &snapshots,
+                                      WorkerPool &pool, size_t threads, std::function<void(ShortestPaths &)> query,
+                                      std::function<void(const std::string &)> errorCallback)
+{
+    dispatch(0, [graph, version, &snapshots, &pool, threads, query, errorCallback]()
+             {
+        try {
+            std::shared_ptr<const CSRGraph> csr = snapshots.get(graph, version);
+            ShortestPaths engine(*csr, &pool, threads);
+            query(engine);
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cout << "Shortest paths: " << csr->getVertexCount() << " vertices in " << engine.getMilliseconds()
+                          << " ms (" << engine.getAlgorithm() << ", " << engine.getThreads() << " threads)" << std::endl;
+            }
+        } catch (const std::exception& e) {
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cerr << "Error calculating shortest paths: " << e.what() << std::endl;
+            }
+            errorCallback("Error calculating shortest paths: " + std::string(e.what()));
+        } }, errorCallback);
+}
+
+// Calculate per-component metrics of a spanning forest. Each tree is independent, so the
+// components are split across all workers and the last one to finish formats the response.
+void Pipeline::calculateForestMetrics(std::shared_ptr<const SpanningForest> forest,
+                                      std::function<void(const std::string &)> responseCallback)
+{
+    auto components = std::make_shared<std::vector<ComponentMetrics>>(forest->getComponentCount());
+    std::vector<std::vector<size_t>> chunks = balanceComponents(forest->componentSizes, activeObjects.size());
+    auto state = std::make_shared<FanIn>(chunks.size());
+
+    std::vector<std::function<void()>> tasks;
+    for (auto &chunk : chunks)
+    {
+        tasks.push_back([forest, chunk, components, state, responseCallback]()
+                        {
+            try {
+                MSTMetrics metrics;
+                for (size_t c : chunk)
+                {
+                    CancellationToken::checkpoint();
+                    (*components)[c] = metrics.getComponentMetrics(forest->getComponentEdges(c), forest->componentSizes[c]);
+                }
+            } catch (const std::exception& e) {
+                state->fail(e.what());
+            }
+            if (!state->finishOne())
+            {
+                return;
+            }
+            if (!state->error.empty())
+            {
+                responseCallback("Error calculating forest metrics: " + state->error);
+                return;
+            }
+
+            // Forest-wide figures only consider pairs of vertices in the same component
+            ComponentMetrics total = MSTMetrics::combine(*components);
+            std::stringstream ss;
+            ss << "Forest Metrics:\n";
+            ss << "Components: " << components->size() << "\n";
+            ss << "Total Weight: " << total.totalWeight << "\n";
+            ss << "Longest Distance: " << total.longestDistance << "\n";
+            ss << "Shortest Distance: " << total.shortestDistance << "\n";
+            ss << "Average Distance: " << total.getAverageDistance() << "\n";
+            for (size_t c = 0; c < components->size(); ++c)
+            {
+                const ComponentMetrics &m = (*components)[c];
+                ss << "Component " << c << ": vertices=" << m.vertices << " edges=" << m.edges
+                   << " weight=" << m.totalWeight << " longest=" << m.longestDistance
+                   << " shortest=" << m.shortestDistance << " average=" << m.getAverageDistance() << "\n";
+            }
+            responseCallback(ss.str()); });
+    }
+    runParallel(tasks);
+}
+
+// Resumes the coroutine on the stage's worker, or right away with accepted == false if the stage is
+// full. Once dispatched, the coroutine may already be running elsewhere, so nothing here touches it.
+void Pipeline::StageHop::await_suspend(std::coroutine_handle<> handle)
+{
+    StageHop *self = this;
+    pipeline.dispatchAdaptive(stage, [handle]()
+                              { handle.resume(); },
+                              [self, handle](const std::string &)
+                              {
+                                  self->accepted = false;
+                                  handle.resume();
+                              });
+}
+
+// Calculate metrics for a given graph and its Minimum Spanning Tree (MST).
+// The graph and MST are shared between the stages rather than copied into every task.
+void Pipeline::calculateMetrics(std::shared_ptr<const Graph> graph, std::shared_ptr<const std::vector<Edge>> mst,
+                                std::function<void(const std::string &)> responseCallback)
+{
+    runMetrics(std::move(graph), std::move(mst), std::move(responseCallback));
+}
+
+// The metrics chain as one coroutine: each co_await moves the rest of the calculation to the next
+// stage, so the stages run in order on their own workers without nesting a callback per stage.
+Detached Pipeline::runMetrics(std::shared_ptr<const Graph> graph, std::shared_ptr<const std::vector<Edge>> mst,
+                              std::function<void(const std::string &)> responseCallback)
+{
+    if (!co_await onStage(1))
+    {
+        responseCallback(busyMessage);
+        co_return;
+    }
+    try
+    {
+        graph = localize(std::move(graph)); // Usually the copy the MST stage already made
+        // Log initial information about the graph and MST
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "Calculating metrics" << std::endl;
+            std::cout << "Graph vertices: " << graph->getVertices() << std::endl;
+            std::cout << "MST edges: " << mst->size() << std::endl;
+        }
+
+        // Check if the MST is valid
+        if (mst->empty() || graph->getVertices() < 2)
+        {
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cerr << "Error: MST is empty or graph has less than 2 vertices" << std::endl;
+            }
+            responseCallback("Error: Cannot calculate metrics. MST is empty or graph has less than 2 vertices.");
+            co_return;
+        }
+
+        // Log MST edges for debugging
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "MST edges:" << std::endl;
+            for (const auto &edge : *mst)
+            {
+                std::cout << "(" << edge.source << ", " << edge.destination << ", " << edge.weight << ")" << std::endl;
+            }
+        }
+
+        MSTMetrics metrics;
+        if (!co_await onStage(2))
+        {
+            responseCallback(busyMessage);
+            co_return;
+        }
+        CancellationToken::checkpoint(); // The request may have been abandoned while this stage was queued
+        int totalWeight = metrics.getTotalWeight(*mst);
+
+        if (!co_await onStage(3))
+        {
+            responseCallback(busyMessage);
+            co_return;
+        }
+        CancellationToken::checkpoint();
+        int longestDistance = metrics.getLongestDistance(*graph, *mst);
+
+        if (!co_await onStage(4))
+        {
+            responseCallback(busyMessage);
+            co_return;
+        }
+        CancellationToken::checkpoint();
+        int shortestDistance = metrics.getShortestDistance(*mst);
+
+        if (!co_await onStage(5))
+        {
+            responseCallback(busyMessage);
+            co_return;
+        }
+        CancellationToken::checkpoint();
+        double averageDistance = metrics.getAverageDistance(*graph, *mst);
+
+        // Prepare the response string with calculated metrics
+        std::stringstream ss;
+        ss << "MST Metrics:\n";
+        ss << "Total Weight: " << totalWeight << "\n";
+        ss << "Longest Distance: " << longestDistance << "\n";
+        ss << "Shortest Distance: " << shortestDistance << "\n";
+        ss << "Average Distance: " << averageDistance << "\n";
+
+        // Log and send the response
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cout << "Sending response" << std::endl;
+        }
+        responseCallback(ss.str());
+    }
+    catch (const std::exception &e)
+    {
+        {
             std::lock_guard<std::mutex> lock(coutMutex);
             std::cerr << "Error calculating metrics: " << e.what() << std::endl;
-            responseCallback("Error calculating metrics: " + std::string(e.what()));
-        } catch (...) {
+        }
+        responseCallback("Error calculating metrics: " + std::string(e.what()));
+    }
+    catch (...)
+    {
+        {
             std::lock_guard<std::mutex> lock(coutMutex);
             std::cerr << "Unknown error occurred while calculating metrics" << std::endl;
-            responseCallback("Unknown error occurred while calculating metrics");
-        } });
+        }
+        responseCallback("Unknown error occurred while calculating metrics");
+    }
+}
+
+// Calculate the full profile of the MST (per-vertex eccentricity and degree, center, centroid and
+// weight distribution). The profile needs only linear passes, so one stage computes all of it.
+void Pipeline::calculateTreeProfile(std::shared_ptr<const std::vector<Edge>> mst,
+                                    std::function<void(const std::string &)> responseCallback)
+{
+    dispatch(1, [mst, responseCallback]()
+             {
+        if (mst->empty())
+        {
+            responseCallback("Error: Cannot calculate metrics. MST is empty or graph has less than 2 vertices.");
+            return;
+        }
+        MSTMetrics metrics;
+        TreeProfile profile = metrics.getTreeProfile(*mst);
+        auto list = [](const std::vector<int> &values)
+        {
+            std::stringstream out;
+            for (size_t i = 0; i < values.size(); ++i)
+            {
+                out << (i ? " " : "") << values[i];
+            }
+            return out.str();
+        };
+
+        std::stringstream ss;
+        ss << "MST Profile:\n";
+        ss << "Vertices: " << profile.vertices << "\n";
+        ss << "Edges: " << profile.edges << "\n";
+        ss << "Total Weight: " << profile.totalWeight << "\n";
+        ss << "Diameter: " << profile.diameter << "\n";
+        ss << "Radius: " << profile.radius << "\n";
+        ss << "Center: " << list(profile.center) << "\n";
+        ss << "Centroid: " << list(profile.centroid) << "\n";
+        ss << "Bottleneck Edge: " << profile.bottleneck.source << " - " << profile.bottleneck.destination
+           << " [weight: " << profile.bottleneck.weight << "]\n";
+        ss << "Weight Percentiles: p50=" << profile.weightP50 << " p90=" << profile.weightP90
+           << " p99=" << profile.weightP99 << "\n";
+        ss << "Weight Histogram [" << profile.weightMin << ", " << profile.weightMax << "]: "
+           << list(profile.weightHistogram) << "\n";
+        ss << "Degree Distribution:";
+        for (size_t d = 0; d < profile.degreeCounts.size(); ++d)
+        {
+            if (profile.degreeCounts[d] > 0)
+            {
+                ss << " " << d << ":" << profile.degreeCounts[d];
+            }
+        }
+        ss << "\n";
+        ss << "Vertex Eccentricity Degree:\n";
+        for (int v = 0; v < profile.vertices; ++v)
+        {
+            ss << profile.vertexIds[v] << " " << profile.eccentricity[v] << " " << profile.degree[v] << "\n";
+        }
+        responseCallback(ss.str()); }, responseCallback);
+}
+
+// Estimate the metrics of a very large MST by sampling. All figures come from a few linear sweeps,
+// so a single stage answers instead of the five-stage exact chain.
+void Pipeline::calculateApproximateMetrics(std::shared_ptr<const std::vector<Edge>> mst, double relativeError,
+                                           int sampleBudget, std::function<void(const std::string &)> responseCallback)
+{
+    dispatch(1, [mst, relativeError, sampleBudget, responseCallback]()
+             {
+        if (mst->empty())
+        {
+            responseCallback("Error: Cannot calculate metrics. MST is empty or graph has less than 2 vertices.");
+            return;
+        }
+        MSTMetrics metrics;
+        ApproximateMetrics result = metrics.getApproximateMetrics(*mst, relativeError, sampleBudget);
+
+        std::stringstream ss;
+        ss << "MST Metrics (approximate):\n";
+        ss << "Total Weight: " << result.totalWeight << "\n";
+        ss << "Longest Distance: " << result.longestDistance
+           << (result.longestExact ? " (exact, double sweep)" : " (lower bound, negative weights)") << "\n";
+        ss << "Shortest Distance: " << result.shortestDistance
+           << (result.shortestExact ? "" : " (upper bound, negative weights)") << "\n";
+        ss << "Average Distance: " << result.averageDistance << " +/- " << result.averageHalfWidth << " ("
+           << result.confidence * 100 << "% confidence, " << result.samples << " of " << result.vertices
+           << " sources sampled)\n";
+        responseCallback(ss.str()); }, responseCallback);
 }
 
 // // Helper function to format metrics as a string
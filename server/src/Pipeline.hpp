@@ -1,23 +1,147 @@
 #pragma once
 #include "ActiveObject.hpp"
-#include "GraphManager.hpp"
+#include "Coroutine.hpp"
+#include "../../common/Graph.hpp"
+#include "../../common/MSTFactory.hpp"
 #include "../../common/MSTMetrics.hpp"
+#include "../../common/ExternalKruskal.hpp"
+#include "../../common/GraphGenerator.hpp"
+#include "../../common/APSPEngine.hpp"
+#include "../../common/ShortestPaths.hpp"
+#include "CSRSnapshotCache.hpp"
+#include <array>
+#include <coroutine>
+#include <deque>
 #include <vector>
 #include <memory>
+#include <atomic>
+#include <mutex>
+#include <semaphore>
 #include <functional>
 #include <string>
 
 class Pipeline
 {
 public:
-    Pipeline(GraphManager &graphManager);
+    Pipeline(size_t queueCapacity = 0, OverflowPolicy policy = OverflowPolicy::Block);
+    void setAffinity(const std::vector<int> &cpus);
+    int getNumaNode() const { return numaNode; }
     void start();
     void stop();
     ~Pipeline();
-    void calculateMetrics(const Graph &graph, const std::vector<Edge> &mst, std::function<void(const std::string &)> responseCallback);
+    void calculateMST(std::shared_ptr<const Graph> graph, const std::string &algorithm,
+                      std::function<void(const std::vector<Edge> &)> resultCallback,
+                      std::function<void(const std::string &)> errorCallback);
+    void calculateForest(std::shared_ptr<const Graph> graph, const std::string &algorithm,
+                         std::function<void(std::shared_ptr<const SpanningForest>)> resultCallback,
+                         std::function<void(const std::string &)> errorCallback);
+    void calculateExternalMST(std::shared_ptr<const Graph> graph, const std::string &directory,
+                              const std::string &edgeFile, size_t memoryBudget,
+                              std::function<void(const ExternalKruskal::Stats &)> resultCallback,
+                              std::function<void(const std::string &)> errorCallback);
+    void generateGraph(const GraphGenerator::Spec &spec, std::function<void(Graph &)> resultCallback,
+                       std::function<void(const std::string &)> errorCallback);
+    void calculateAllPairsStats(std::shared_ptr<const Graph> graph, WorkerPool &pool, size_t threads,
+                                std::counting_semaphore<> &slots,
+                                std::function<void(const APSPStats &)> resultCallback,
+                                std::function<void(const std::string &)> errorCallback);
+    void calculateShortestPaths(std::shared_ptr<const Graph> graph, uint64_t version, CSRSnapshotCache &snapshots,
+                                WorkerPool &pool, size_t threads, std::function<void(ShortestPaths &)> query,
+                                std::function<void(const std::string &)> errorCallback);
+    void calculateForestMetrics(std::shared_ptr<const SpanningForest> forest,
+                                std::function<void(const std::string &)> responseCallback);
+    void calculateMetrics(std::shared_ptr<const Graph> graph, std::shared_ptr<const std::vector<Edge>> mst,
+                          std::function<void(const std::string &)> responseCallback);
+    void calculateTreeProfile(std::shared_ptr<const std::vector<Edge>> mst,
+                              std::function<void(const std::string &)> responseCallback);
+    void calculateApproximateMetrics(std::shared_ptr<const std::vector<Edge>> mst, double relativeError, int sampleBudget,
+                                     std::function<void(const std::string &)> responseCallback);
+    size_t getQueueDepth() const;
+    std::vector<size_t> getStageDepths() const;
+    bool hasRoom() const;
+    size_t getQueueCapacity() const;
+    uint64_t getRejectedCount() const;
+    uint64_t getDroppedCount() const;
+    static int getStageCount() { return stageCount; }
+    const ActiveObject &getStage(int stage) const { return *activeObjects[stage]; }
+    std::string getPlanString() const;
+
+    static const char *const busyMessage;
 
 private:
+    // Stage 0 computes MSTs; stages 1-5 compute the metrics one after another
+    static const int stageCount = 6;
+    static const char *const stageNames[stageCount];
     std::vector<std::unique_ptr<ActiveObject>> activeObjects;
-    GraphManager &graphManager;
+
+    std::atomic<size_t> nextWorker;
+    int numaNode; // Node all stage workers are pinned to, or -1
+
+    // NUMA-local copies of recent snapshots, newest first, keyed by the snapshot they copy. GraphManager
+    // hands out one snapshot per graph version, so this holds one copy per (version, node).
+    struct LocalCopy
+    {
+        std::weak_ptr<const Graph> source;
+        std::shared_ptr<const Graph> local;
+    };
+    static const size_t localCopyLimit = 4;
+    std::mutex localMutex;
+    std::deque<LocalCopy> localCopies;
+
+    std::shared_ptr<const Graph> localize(std::shared_ptr<const Graph> graph);
+
+    // Adaptive placement of the metrics stages (1-5). Each stage's service time is tracked as a moving
+    // average; every replanInterval tasks the five metric workers are divided among the stages in
+    // proportion to their cost, and stages cheaper than fuseThreshold are fused into the stage that
+    // dispatches them (run inline on that worker instead of queueing).
+    static const int firstMetricStage = 1;
+    static const uint64_t fuseThresholdMicros = 50;
+    static const uint64_t replanInterval = 32;
+    static const uint64_t minSamples = 4;
+    struct StagePlan
+    {
+        std::atomic<uint64_t> averageMicros{0};
+        std::atomic<uint64_t> samples{0};
+        std::atomic<int> firstWorker{0};
+        std::atomic<int> workers{1}; // 0 = fused
+    };
+    std::array<StagePlan, stageCount> plans;
+    std::atomic<uint64_t> tasksSinceReplan;
+    std::mutex planMutex;
+
+    void dispatchAdaptive(int stage, std::function<void()> task, const std::function<void(const std::string &)> &onBusy);
+    void recordStageCost(int stage, uint64_t micros);
+    void replan();
+    bool isWorkerThread() const;
+
+    // Awaitable that continues the awaiting coroutine on a metrics stage, placed by dispatchAdaptive.
+    // It resumes with false, on the thread that asked, when the stage refuses the work.
+    struct StageHop
+    {
+        Pipeline &pipeline;
+        int stage;
+        bool accepted;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle);
+        bool await_resume() const noexcept { return accepted; }
+    };
+    StageHop onStage(int stage) { return StageHop{*this, stage, true}; }
+    Detached runMetrics(std::shared_ptr<const Graph> graph, std::shared_ptr<const std::vector<Edge>> mst,
+                        std::function<void(const std::string &)> responseCallback);
+
+    // Completion tracking for work split across several workers; the last task to finish merges
+    struct FanIn
+    {
+        std::atomic<size_t> remaining;
+        std::mutex errorMutex;
+        std::string error;
+        FanIn(size_t tasks) : remaining(tasks) {}
+        void fail(const std::string &message);
+        bool finishOne() { return remaining.fetch_sub(1, std::memory_order_acq_rel) == 1; }
+    };
+
+    void dispatch(int stage, std::function<void()> task, const std::function<void(const std::string &)> &onBusy);
+    void runParallel(std::vector<std::function<void()>> &tasks);
+    static std::vector<std::vector<size_t>> balanceComponents(const std::vector<int> &componentSizes, size_t bins);
     // std::string getMetricsString(const MSTMetrics &metrics, const Graph &graph, const std::vector<Edge> &mst);
-};
\ No newline at end of file
+};
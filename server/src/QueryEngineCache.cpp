@@ -0,0 +1,131 @@
+// This file implements QueryEngineCache, which builds MST query engines on demand and shares them
+// between all connections using the same graph.
+
+#include "QueryEngineCache.hpp"
+#include <stdexcept>
+
+QueryEngineCache::QueryEngineCache() : engineVersion(0), building(false) {}
+
+void QueryEngineCache::get(GraphManager &manager, Pipeline &pipeline, std::shared_ptr<const CancellationToken> shutdown,
+                           Ready ready, Failed failed)
+{
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    uint64_t version = manager.getVersion();
+    if (engine && engineVersion >= version)
+    {
+        std::shared_ptr<const MSTQueryEngine> current = engine;
+        lock.unlock();
+        ready(current);
+        return;
+    }
+    waiting.push_back({version, CancellationToken::current(), std::move(ready), std::move(failed)});
+    if (building)
+    {
+        return; // The running build (or the one after it) answers this query too
+    }
+    building = true;
+    lock.unlock();
+    build(manager, pipeline, std::move(shutdown));
+}
+
+void QueryEngineCache::install(uint64_t version, std::shared_ptr<const MSTQueryEngine> builtEngine)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!engine || version > engineVersion)
+    {
+        engine = std::move(builtEngine);
+        engineVersion = version;
+    }
+}
+
+// Computes the minimum spanning forest of a snapshot on the pipeline and builds the engine there.
+// Never called with cacheMutex held: a blocking dispatch must not stop the worker that finishes a build.
+// The build runs under shutdown, not under the token of the request that happened to start it.
+void QueryEngineCache::build(GraphManager &manager, Pipeline &pipeline, std::shared_ptr<const CancellationToken> shutdown)
+{
+    CancellationToken::Scope scope(std::move(shutdown));
+    uint64_t version = 0;
+    std::shared_ptr<const Graph> graph = manager.getSnapshot(&version);
+    pipeline.calculateForest(
+        graph, "kruskal",
+        [this, &manager, version](std::shared_ptr<const SpanningForest> forest)
+        { finishBuild(manager, version, std::make_shared<const MSTQueryEngine>(*forest), ""); },
+        [this, &manager, version](const std::string &error)
+        { finishBuild(manager, version, nullptr, error); });
+}
+
+// Answers every query the new engine is fresh enough for. Queries that arrived after a later mutation
+// need another build; this runs on a pipeline worker, so that build happens right here instead of
+// being queued behind the worker itself.
+void QueryEngineCache::finishBuild(GraphManager &manager, uint64_t version,
+                                   std::shared_ptr<const MSTQueryEngine> builtEngine, std::string error)
+{
+    while (true)
+    {
+        std::vector<Waiter> done;
+        bool rebuild;
+        {
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            if (builtEngine && (!engine || version >= engineVersion))
+            {
+                engine = builtEngine;
+                engineVersion = version;
+            }
+            std::vector<Waiter> stillWaiting;
+            for (auto &waiter : waiting)
+            {
+                if (!builtEngine || waiter.version <= version)
+                {
+                    done.push_back(std::move(waiter));
+                }
+                else
+                {
+                    stillWaiting.push_back(std::move(waiter));
+                }
+            }
+            waiting.swap(stillWaiting);
+            rebuild = !waiting.empty();
+            building = rebuild;
+        }
+
+        for (auto &waiter : done)
+        {
+            try
+            {
+                if (waiter.token)
+                {
+                    waiter.token->check(); // This request gave up while the build ran
+                }
+            }
+            catch (const OperationCancelled &e)
+            {
+                waiter.failed("Error: " + std::string(e.what()));
+                continue;
+            }
+            if (builtEngine)
+            {
+                waiter.ready(builtEngine);
+            }
+            else
+            {
+                waiter.failed(error);
+            }
+        }
+        if (!rebuild)
+        {
+            return;
+        }
+
+        std::shared_ptr<const Graph> graph = manager.getSnapshot(&version);
+        try
+        {
+            KruskalMST kruskal;
+            builtEngine = std::make_shared<const MSTQueryEngine>(kruskal.findSpanningForest(*graph));
+        }
+        catch (const std::exception &e)
+        {
+            builtEngine = nullptr;
+            error = "Error calculating spanning forest: " + std::string(e.what());
+        }
+    }
+}
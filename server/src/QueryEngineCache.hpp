@@ -0,0 +1,51 @@
+#pragma once
+#include "GraphManager.hpp"
+#include "Pipeline.hpp"
+#include "../../common/MSTQueryEngine.hpp"
+#include "../../common/CancellationToken.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Keeps the MST query engine of one graph, tagged with the graph version it was built from.
+// Queries against an up-to-date engine are answered without touching the pipeline; otherwise one
+// rebuild runs on the graph's pipeline and every query waiting for it is answered when it finishes.
+// The rebuild serves many requests, so it runs under a token only server shutdown cancels; a waiter
+// whose own request was cancelled or ran out of time is failed alone when the build completes.
+class QueryEngineCache
+{
+public:
+    using Ready = std::function<void(std::shared_ptr<const MSTQueryEngine>)>;
+    using Failed = std::function<void(const std::string &)>;
+
+    QueryEngineCache();
+
+    // Calls ready with an engine at least as new as the graph is now (possibly on another thread).
+    // The current token is the waiter's own; a build started here runs under shutdown instead.
+    void get(GraphManager &manager, Pipeline &pipeline, std::shared_ptr<const CancellationToken> shutdown,
+             Ready ready, Failed failed);
+    // Offers an engine built elsewhere (e.g. by calculate_mst ... forest) for the given version
+    void install(uint64_t version, std::shared_ptr<const MSTQueryEngine> builtEngine);
+
+private:
+    struct Waiter
+    {
+        uint64_t version;
+        std::shared_ptr<const CancellationToken> token; // Of the request that asked, if any
+        Ready ready;
+        Failed failed;
+    };
+
+    std::mutex cacheMutex;
+    std::shared_ptr<const MSTQueryEngine> engine;
+    uint64_t engineVersion;
+    bool building;
+    std::vector<Waiter> waiting;
+
+    void build(GraphManager &manager, Pipeline &pipeline, std::shared_ptr<const CancellationToken> shutdown);
+    void finishBuild(GraphManager &manager, uint64_t version, std::shared_ptr<const MSTQueryEngine> builtEngine,
+                     std::string error);
+};
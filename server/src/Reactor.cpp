@@ -0,0 +1,277 @@
+// This file implements the Reactor, the thread pool that runs client connections as coroutines.
+
+#include "Reactor.hpp"
+#include "CpuAffinity.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern std::mutex coutMutex;
+
+const uint32_t Reactor::readEvents = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+const uint32_t Reactor::writeEvents = EPOLLOUT | EPOLLONESHOT;
+
+namespace
+{
+    thread_local const Reactor *currentReactor = nullptr; // Reactor whose pool runs this thread, if any
+
+    // Root of a spawned task: hops onto the pool, runs the task and logs what it throws
+    Detached runDetached(Reactor &reactor, Task<void> task)
+    {
+        co_await reactor.schedule();
+        try
+        {
+            co_await task;
+        }
+        catch (const std::exception &e)
+        {
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cerr << "Error in connection task: " << e.what() << std::endl;
+        }
+    }
+}
+
+// Constructor: creates the epoll instance and the eventfd that announces posted coroutines
+Reactor::Reactor() : epollFd(-1), wakeFd(-1), stopping(false)
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK | EFD_SEMAPHORE);
+    if (epollFd == -1 || wakeFd == -1)
+    {
+        throw std::runtime_error("Error creating reactor: " + std::string(strerror(errno)));
+    }
+    // Level-triggered, so every thread keeps waking while posted coroutines are waiting
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event) == -1)
+    {
+        throw std::runtime_error("Error creating reactor: " + std::string(strerror(errno)));
+    }
+}
+
+Reactor::~Reactor()
+{
+    stop();
+    ::close(wakeFd);
+    ::close(epollFd);
+}
+
+// Starts the pool threads, pinned to the given CPUs if any, and the blocking threads
+void Reactor::start(size_t threadCount, const std::vector<int> &cpus, size_t blockingThreadCount)
+{
+    stopping.store(false, std::memory_order_release);
+    for (size_t i = 0; i < std::max<size_t>(threadCount, 1); ++i)
+    {
+        threads.emplace_back(&Reactor::run, this);
+        CpuAffinity::pin(threads.back(), cpus);
+    }
+    for (size_t i = 0; i < std::max<size_t>(blockingThreadCount, 1); ++i)
+    {
+        blockingThreads.emplace_back(&Reactor::runBlockingThread, this);
+    }
+}
+
+// Stops the pool threads. Coroutines still waiting on sockets are not resumed, so callers first
+// make every connection finish (by shutting its socket down) and then stop the reactor.
+void Reactor::stop()
+{
+    if (threads.empty())
+    {
+        return;
+    }
+    stopping.store(true, std::memory_order_release);
+    // The counter is never read back down while stopping, so every thread sees the eventfd readable
+    uint64_t one = 1;
+    if (::write(wakeFd, &one, sizeof(one)) < 0)
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cerr << "Error waking reactor threads: " << strerror(errno) << std::endl;
+    }
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+    threads.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(blockingMutex);
+        blockingQueue.clear(); // Their coroutines could not be resumed any more
+    }
+    blockingReady.notify_all();
+    for (auto &thread : blockingThreads)
+    {
+        thread.join();
+    }
+    blockingThreads.clear();
+}
+
+void Reactor::post(std::coroutine_handle<> handle)
+{
+    {
+        std::lock_guard<std::mutex> lock(readyMutex);
+        ready.push_back(handle);
+    }
+    uint64_t one = 1;
+    while (::write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR)
+    {
+    }
+}
+
+// Queues work for the blocking threads
+void Reactor::submitBlocking(std::function<void()> work)
+{
+    {
+        std::lock_guard<std::mutex> lock(blockingMutex);
+        blockingQueue.push_back(std::move(work));
+    }
+    blockingReady.notify_one();
+}
+
+// Blocking thread: runs queued work one item at a time until the reactor stops
+void Reactor::runBlockingThread()
+{
+    std::unique_lock<std::mutex> lock(blockingMutex);
+    while (true)
+    {
+        blockingReady.wait(lock, [this]()
+                           { return !blockingQueue.empty() || stopping.load(std::memory_order_acquire); });
+        if (blockingQueue.empty())
+        {
+            return;
+        }
+        std::function<void()> work = std::move(blockingQueue.front());
+        blockingQueue.pop_front();
+        lock.unlock();
+        work();
+        lock.lock();
+    }
+}
+
+bool Reactor::isPoolThread() const
+{
+    return currentReactor == this;
+}
+
+void Reactor::spawn(Task<void> task)
+{
+    runDetached(*this, std::move(task));
+}
+
+// Arms a one-shot wait on the socket. Another thread may resume the coroutine before this returns,
+// so nothing of the awaiting coroutine is touched after epoll_ctl.
+void Reactor::watch(int fd, uint32_t events, std::coroutine_handle<> handle)
+{
+    epoll_event event{};
+    event.events = events;
+    event.data.ptr = handle.address();
+    if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &event) == -1)
+    {
+        if (errno != ENOENT || epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+        {
+            // The socket cannot be watched (e.g. already closed): let the coroutine see the error itself
+            post(handle);
+        }
+    }
+}
+
+// Pool thread: resumes coroutines whose socket is ready and those posted to the pool
+void Reactor::run()
+{
+    currentReactor = this;
+    epoll_event events[maxEvents];
+    while (!stopping.load(std::memory_order_acquire))
+    {
+        int count = epoll_wait(epollFd, events, maxEvents, -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(coutMutex);
+            std::cerr << "Reactor wait failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        for (int i = 0; i < count && !stopping.load(std::memory_order_acquire); ++i)
+        {
+            if (events[i].data.ptr)
+            {
+                std::coroutine_handle<>::from_address(events[i].data.ptr).resume();
+                continue;
+            }
+            // One eventfd read claims one posted coroutine; another thread may have claimed it first
+            uint64_t claimed;
+            if (::read(wakeFd, &claimed, sizeof(claimed)) != sizeof(claimed))
+            {
+                continue;
+            }
+            std::coroutine_handle<> handle;
+            {
+                std::lock_guard<std::mutex> lock(readyMutex);
+                if (!ready.empty())
+                {
+                    handle = ready.front();
+                    ready.pop_front();
+                }
+            }
+            if (handle)
+            {
+                handle.resume();
+            }
+            else
+            {
+                // That was the stop signal; put it back for the other threads
+                uint64_t one = 1;
+                while (::write(wakeFd, &one, sizeof(one)) < 0 && errno == EINTR)
+                {
+                }
+            }
+        }
+    }
+}
+
+Task<ssize_t> Reactor::read(int fd, char *buffer, size_t size)
+{
+    while (true)
+    {
+        ssize_t n = ::recv(fd, buffer, size, MSG_DONTWAIT);
+        if (n >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+        {
+            co_return n;
+        }
+        if (errno != EINTR)
+        {
+            co_await readable(fd);
+        }
+    }
+}
+
+Task<bool> Reactor::write(int fd, const char *data, size_t size)
+{
+    size_t sent = 0;
+    while (sent < size)
+    {
+        ssize_t n = ::send(fd, data + sent, size - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n > 0)
+        {
+            sent += static_cast<size_t>(n);
+        }
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            co_await writable(fd);
+        }
+        else if (n == 0 || errno != EINTR)
+        {
+            co_return false;
+        }
+    }
+    co_return true;
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "Coroutine.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+// Multiplexes coroutines over a small pool of threads. Each thread waits on one shared epoll
+// instance for two kinds of events: sockets that became readable or writable for a suspended
+// coroutine, and coroutines posted to run on the pool. A coroutine waiting for a socket costs only its
+// frame, so thousands of idle connections do not need thousands of threads.
+//
+// Every socket wait is one-shot: the coroutine is resumed once, on whichever pool thread saw the
+// event, and must wait again for the next one. A socket may have at most one waiter at a time.
+//
+// Work that has to block (fdatasync, file writes) is handed to a few separate blocking threads, so
+// that it never holds up the pool; the coroutine that awaits it is resumed on the pool afterwards.
+class Reactor
+{
+public:
+    Reactor();
+    ~Reactor();
+
+    void start(size_t threadCount, const std::vector<int> &cpus, size_t blockingThreadCount = 1);
+    void stop();
+    size_t getThreadCount() const { return threads.size(); }
+    // True on the pool threads of this reactor
+    bool isPoolThread() const;
+
+    // Resumes the coroutine on a pool thread
+    void post(std::coroutine_handle<> handle);
+    // Runs the task on the pool; nobody awaits it, so it must handle its own errors
+    void spawn(Task<void> task);
+
+    // Awaitable that moves the awaiting coroutine onto a pool thread
+    auto schedule()
+    {
+        struct Awaiter
+        {
+            Reactor &reactor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { reactor.post(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this};
+    }
+
+    // Awaitable that runs work on a blocking thread, then resumes the awaiting coroutine on the pool.
+    // What work throws is rethrown from the co_await.
+    auto runBlocking(std::function<void()> work)
+    {
+        struct Awaiter
+        {
+            Reactor &reactor;
+            std::function<void()> work;
+            std::exception_ptr error;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                reactor.submitBlocking([this, handle]()
+                                       {
+                    try
+                    {
+                        work();
+                    }
+                    catch (...)
+                    {
+                        error = std::current_exception();
+                    }
+                    reactor.post(handle); });
+            }
+            void await_resume() const
+            {
+                if (error)
+                {
+                    std::rethrow_exception(error);
+                }
+            }
+        };
+        return Awaiter{*this, std::move(work), nullptr};
+    }
+
+    // Awaitables that resume once the socket can be read (or has hung up) / written
+    auto readable(int fd) { return SocketAwaiter{*this, fd, readEvents}; }
+    auto writable(int fd) { return SocketAwaiter{*this, fd, writeEvents}; }
+
+    // Reads whatever is available, waiting for data if there is none; 0 means the peer closed
+    Task<ssize_t> read(int fd, char *buffer, size_t size);
+    // Writes all of the data, waiting whenever the socket buffer is full; false on error
+    Task<bool> write(int fd, const char *data, size_t size);
+
+private:
+    static const uint32_t readEvents;
+    static const uint32_t writeEvents;
+    static const int maxEvents = 64;
+
+    struct SocketAwaiter
+    {
+        Reactor &reactor;
+        int fd;
+        uint32_t events;
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> handle) { reactor.watch(fd, events, handle); }
+        void await_resume() const noexcept {}
+    };
+
+    int epollFd;
+    int wakeFd; // eventfd counting posted coroutines (semaphore mode: one read per coroutine)
+    std::atomic<bool> stopping;
+    std::vector<std::thread> threads;
+    std::mutex readyMutex;
+    std::deque<std::coroutine_handle<>> ready;
+    std::vector<std::thread> blockingThreads;
+    std::mutex blockingMutex;
+    std::condition_variable blockingReady;
+    std::deque<std::function<void()>> blockingQueue;
+
+    void watch(int fd, uint32_t events, std::coroutine_handle<> handle);
+    void submitBlocking(std::function<void()> work);
+    void run();
+    void runBlockingThread();
+};
@@ -0,0 +1,121 @@
+// This file implements the per-connection request buffers: the input buffer the reader thread parses
+// lines from, the arena responses are formatted in, and the tokenizer that replaced istringstream.
+
+#include "RequestArena.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+InputBuffer::InputBuffer(size_t initialCapacity) : data(initialCapacity), begin(0), end(0) {}
+
+char *InputBuffer::prepare(size_t minSpace)
+{
+    if (space() < minSpace && begin > 0)
+    {
+        // Move the unparsed tail to the front instead of growing
+        std::memmove(data.data(), data.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if (space() < minSpace)
+    {
+        data.resize(std::max(data.size() * 2, end + minSpace));
+    }
+    return data.data() + end;
+}
+
+bool InputBuffer::nextLine(std::string_view &line)
+{
+    const char *start = data.data() + begin;
+    const char *newline = static_cast<const char *>(std::memchr(start, '\n', end - begin));
+    if (!newline)
+    {
+        return false;
+    }
+    size_t length = static_cast<size_t>(newline - start);
+    begin += length + 1;
+    if (length > 0 && start[length - 1] == '\r')
+    {
+        --length;
+    }
+    line = std::string_view(start, length);
+    if (begin == end)
+    {
+        begin = end = 0; // Everything parsed: the next read starts at the front again
+    }
+    return true;
+}
+
+RequestArena::RequestArena(size_t blockSize) : block(new char[blockSize]), memory(block.get(), blockSize) {}
+
+void appendNumber(std::pmr::string &text, long long value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    text.append(digits, result.ptr);
+}
+
+void Tokenizer::skipSpace()
+{
+    while (position < text.size() && (text[position] == ' ' || text[position] == '\t' ||
+                                      text[position] == '\r' || text[position] == '\n'))
+    {
+        ++position;
+    }
+}
+
+bool Tokenizer::next(std::string_view &token)
+{
+    skipSpace();
+    if (position == text.size())
+    {
+        return false;
+    }
+    size_t start = position;
+    while (position < text.size() && text[position] != ' ' && text[position] != '\t' &&
+           text[position] != '\r' && text[position] != '\n')
+    {
+        ++position;
+    }
+    token = text.substr(start, position - start);
+    return true;
+}
+
+bool Tokenizer::nextInt(int &value)
+{
+    size_t saved = position;
+    std::string_view token;
+    if (next(token) && parseInt(token, value))
+    {
+        return true;
+    }
+    position = saved;
+    return false;
+}
+
+bool Tokenizer::atEnd()
+{
+    skipSpace();
+    return position == text.size();
+}
+
+// The whole token must be a number in range; a leading '+' is accepted like operator>> does
+bool Tokenizer::parseInt(std::string_view token, int &value)
+{
+    if (token.size() > 1 && token[0] == '+')
+    {
+        token.remove_prefix(1);
+    }
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size() && !token.empty();
+}
+
+bool Tokenizer::parseDouble(std::string_view token, double &value)
+{
+    if (token.size() > 1 && token[0] == '+')
+    {
+        token.remove_prefix(1);
+    }
+    auto result = std::from_chars(token.data(), token.data() + token.size(), value);
+    return result.ec == std::errc() && result.ptr == token.data() + token.size() && !token.empty();
+}
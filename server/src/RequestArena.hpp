@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Bytes read from a client that have not been parsed yet. Reads go straight into the free space at the
+// end; complete lines are handed out as views into the buffer, so no per-request string is built.
+// The buffer only grows for requests longer than its current capacity.
+class InputBuffer
+{
+public:
+    explicit InputBuffer(size_t initialCapacity = 4096);
+
+    // Room for at least minSpace more bytes, compacting or growing the buffer as needed
+    char *prepare(size_t minSpace);
+    size_t space() const { return data.size() - end; }
+    // Marks count bytes written at prepare()'s pointer as received
+    void commit(size_t count) { end += count; }
+
+    // The next complete line without its "\n" or "\r\n"; the view is valid until the next prepare()
+    bool nextLine(std::string_view &line);
+    std::string_view pending() const { return std::string_view(data.data() + begin, end - begin); }
+    size_t size() const { return end - begin; }
+    void clear() { begin = end = 0; }
+
+private:
+    std::vector<char> data;
+    size_t begin; // First unparsed byte
+    size_t end;   // One past the last received byte
+};
+
+// Scratch memory for one request: temporary strings and the response text are bump-allocated from a
+// block owned by the connection, and everything is released at once when the request is done.
+// Only responses larger than the block fall back to the heap.
+class RequestArena
+{
+public:
+    explicit RequestArena(size_t blockSize = 64 * 1024);
+    RequestArena(const RequestArena &) = delete;
+    RequestArena &operator=(const RequestArena &) = delete;
+
+    std::pmr::memory_resource *resource() { return &memory; }
+    std::pmr::string makeString() { return std::pmr::string(&memory); }
+    // Frees everything allocated since the last reset; strings from the arena must be gone by then
+    void reset() { memory.release(); }
+
+private:
+    std::unique_ptr<char[]> block;
+    std::pmr::monotonic_buffer_resource memory;
+};
+
+// Appends the decimal form of value without a temporary string
+void appendNumber(std::pmr::string &text, long long value);
+
+// Splits a request into whitespace-separated tokens without copying. Number reads leave the token in
+// place when it is not a number, so callers can tell "no more numbers" from "garbage" with atEnd().
+class Tokenizer
+{
+public:
+    explicit Tokenizer(std::string_view text) : text(text), position(0) {}
+
+    bool next(std::string_view &token);
+    bool nextInt(int &value);
+    // True once only whitespace is left
+    bool atEnd();
+
+    static bool parseInt(std::string_view token, int &value);
+    static bool parseDouble(std::string_view token, double &value);
+
+private:
+    std::string_view text;
+    size_t position;
+
+    void skipSpace();
+};
@@ -0,0 +1,118 @@
+// This file implements the response buffer pool and the scatter-gather response builder.
+
+#include "ResponseBuffer.hpp"
+
+BufferPool &BufferPool::instance()
+{
+    static BufferPool pool;
+    return pool;
+}
+
+BufferPool::~BufferPool()
+{
+    for (std::string *buffer : freeBuffers)
+    {
+        delete buffer;
+    }
+}
+
+std::shared_ptr<std::string> BufferPool::acquire()
+{
+    std::string *buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (!freeBuffers.empty())
+        {
+            buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        }
+    }
+    if (!buffer)
+    {
+        buffer = new std::string();
+    }
+    return std::shared_ptr<std::string>(buffer, [this](std::string *released)
+                                        { release(released); });
+}
+
+// Keeps the buffer's capacity for the next response unless the pool is full or the buffer is huge
+void BufferPool::release(std::string *buffer)
+{
+    if (buffer->capacity() <= maxPooledCapacity)
+    {
+        buffer->clear();
+        std::lock_guard<std::mutex> lock(poolMutex);
+        if (freeBuffers.size() < maxPooled)
+        {
+            freeBuffers.push_back(buffer);
+            return;
+        }
+    }
+    delete buffer;
+}
+
+Segment BufferPool::copy(const char *data, size_t size)
+{
+    std::shared_ptr<std::string> buffer = acquire();
+    buffer->assign(data, size);
+    return buffer;
+}
+
+Segment BufferPool::adopt(std::string &&text)
+{
+    return std::make_shared<const std::string>(std::move(text));
+}
+
+// Moves the partly filled buffer into the segment list
+void ResponseBuilder::seal()
+{
+    if (current && !current->empty())
+    {
+        segments.push_back(std::move(current));
+    }
+    current.reset();
+}
+
+ResponseBuilder &ResponseBuilder::append(const std::string &text)
+{
+    if (text.size() > packLimit)
+    {
+        return append(BufferPool::instance().copy(text));
+    }
+    if (!current)
+    {
+        current = BufferPool::instance().acquire();
+    }
+    current->append(text);
+    totalSize += text.size();
+    return *this;
+}
+
+ResponseBuilder &ResponseBuilder::append(std::string &&text)
+{
+    if (text.size() > packLimit)
+    {
+        return append(BufferPool::adopt(std::move(text)));
+    }
+    return append(static_cast<const std::string &>(text));
+}
+
+ResponseBuilder &ResponseBuilder::append(Segment segment)
+{
+    if (segment && !segment->empty())
+    {
+        seal();
+        totalSize += segment->size();
+        segments.push_back(std::move(segment));
+    }
+    return *this;
+}
+
+std::vector<Segment> ResponseBuilder::take()
+{
+    seal();
+    totalSize = 0;
+    std::vector<Segment> result;
+    result.swap(segments);
+    return result;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// An immutable, reference-counted piece of a response. The same segment can be queued on a
+// connection, held by a zero-copy send and referenced by a builder without being copied.
+using Segment = std::shared_ptr<const std::string>;
+
+// Recycles response buffers: a released buffer keeps its capacity and is handed out again,
+// so steady-state responses do not allocate.
+class BufferPool
+{
+public:
+    static BufferPool &instance();
+
+    // An empty buffer that returns to the pool when the last reference goes away
+    std::shared_ptr<std::string> acquire();
+    // Copies text into a pooled buffer
+    Segment copy(const char *data, size_t size);
+    Segment copy(const std::string &text) { return copy(text.data(), text.size()); }
+    // Takes over text without copying (the string's own allocation becomes the segment)
+    static Segment adopt(std::string &&text);
+
+private:
+    static const size_t maxPooled = 256;             // Free buffers kept around
+    static const size_t maxPooledCapacity = 1 << 20; // Bigger buffers are freed, not pooled
+
+    std::mutex poolMutex;
+    std::vector<std::string *> freeBuffers;
+
+    BufferPool() = default;
+    ~BufferPool();
+    void release(std::string *buffer);
+};
+
+// Assembles a response from pieces without concatenating them: small text is packed into pooled
+// buffers, large pieces and shared segments are referenced as they are.
+class ResponseBuilder
+{
+public:
+    ResponseBuilder &append(const std::string &text);
+    ResponseBuilder &append(std::string &&text);
+    ResponseBuilder &append(Segment segment);
+    size_t size() const { return totalSize; }
+    std::vector<Segment> take();
+
+private:
+    static const size_t packLimit = 4096; // Appends up to this size are copied into the current buffer
+
+    std::vector<Segment> segments;
+    std::shared_ptr<std::string> current; // Pooled buffer still being filled
+    size_t totalSize = 0;
+
+    void seal();
+};
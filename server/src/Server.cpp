@@ -1,6 +1,9 @@
 #include "Server.hpp"
+#include "Tracer.hpp"
+#include "CpuAffinity.hpp"
 #include <iostream>
 #include <sys/socket.h>
+#include <sys/time.h>
 #include <netinet/in.h>
 #include <unistd.h>
 #include <thread>
@@ -8,25 +11,27 @@
 #include <csignal>
 #include <atomic>
 #include <sstream>
-#include <map>
 #include <functional>
 #include <cstring>
 #include <mutex>
 #include <chrono>
+#include <cctype>
+#include <cstdlib>
 
 // External declarations for global variables
 extern std::atomic<bool> shutdownRequested;
 extern Server *serverPtr;
 std::mutex runningMutex;
 std::mutex acceptThreadMutex;
-std::mutex graphMutex;
 extern std::mutex coutMutex;
 
 // External declaration for signal handler (defined in main.cpp)
 extern void signalHandler(int signum);
 
-// Constructor: Initialize the server with a given port
-Server::Server(int p) : port(p), running(false), pipeline(graphManager), serverSocket(-1) {}
+// Constructor: Initialize the server with a given port; stored graphs are restored by the registry
+Server::Server(int p, const ServerConfig &cfg)
+    : port(p), config(cfg), running(false), graphs(cfg), serverSocket(-1), metricsSocket(-1), activeSessions(0),
+      shutdownToken(std::make_shared<CancellationToken>()) {}
 
 // Destructor: Ensure the server is stopped when the object is destroyed
 Server::~Server()
@@ -133,13 +138,22 @@ void Server::start()
         running.store(true, std::memory_order_acquire);
     }
 
-    // Start the pipeline
-    pipeline.start();
+    // Start the pipeline shards and the threads that run the connections
+    graphs.start();
+    reactor.start(config.ioThreads, config.ioCpus, config.blockingThreads);
+
+    // The metrics endpoint is optional; failing to open it does not stop the server
+    if (config.metricsPort > 0 && startMetricsEndpoint())
+    {
+        metricsThread = std::thread(&Server::serveMetrics, this);
+        CpuAffinity::pin(metricsThread, config.ioCpus);
+    }
 
     // Start the thread that accepts client connections
     {
         std::lock_guard<std::mutex> lock(acceptThreadMutex);
         acceptThread = std::thread(&Server::acceptClients, this);
+        CpuAffinity::pin(acceptThread, config.ioCpus);
     }
 
     {
@@ -165,6 +179,9 @@ void Server::stop()
         std::cout << "Stopping server..." << std::endl;
     }
 
+    // Queued MST and metrics work gives up at its next checkpoint instead of running to completion
+    shutdownToken->cancel();
+
     // Close the server socket
     if (serverSocket != -1)
     {
@@ -179,32 +196,34 @@ void Server::stop()
         acceptThread.join();
     }
 
-    // Close all client sockets and clear the vector
+    // Close the metrics endpoint
+    if (metricsSocket != -1)
     {
-        std::lock_guard<std::mutex> lock(clientSocketsMutex);
-        for (int clientSocket : clientSockets)
-        {
-            shutdown(clientSocket, SHUT_RDWR);
-            close(clientSocket);
-        }
-        clientSockets.clear();
+        shutdown(metricsSocket, SHUT_RDWR);
+        close(metricsSocket);
+        metricsSocket = -1;
+    }
+    if (metricsThread.joinable())
+    {
+        metricsThread.join();
     }
 
-    // Wait for all client threads to finish
+    // Shut down all client sockets so their sessions stop reading; each Connection closes its own socket
     {
-        std::lock_guard<std::mutex> lock(clientThreadsMutex);
-        for (auto &thread : clientThreads)
+        std::unique_lock<std::mutex> lock(clientSocketsMutex);
+        for (int clientSocket : clientSockets)
         {
-            if (thread.joinable())
-            {
-                thread.join();
-            }
+            shutdown(clientSocket, SHUT_RDWR);
         }
-        clientThreads.clear();
+
+        // Wait for all sessions to finish, then stop the threads that ran them
+        sessionsDone.wait(lock, [this]
+                          { return activeSessions == 0; });
     }
+    reactor.stop();
 
-    // Stop the pipeline
-    pipeline.stop();
+    // Stop the pipeline shards
+    graphs.stop();
 
     {
         std::lock_guard<std::mutex> lock(coutMutex);
@@ -212,19 +231,54 @@ void Server::stop()
     }
 }
 
-void Server::handleClient(int clientSocket)
+// Registers a session's socket so stop() can shut it down and wait for the session to end
+void Server::openSession(int socket)
+{
+    std::lock_guard<std::mutex> lock(clientSocketsMutex);
+    clientSockets.push_back(socket);
+    ++activeSessions;
+}
+
+// Called as the last step of a session, while the socket is still open
+void Server::closeSession(int socket)
+{
+    std::lock_guard<std::mutex> lock(clientSocketsMutex);
+    clientSockets.erase(std::remove(clientSockets.begin(), clientSockets.end(), socket), clientSockets.end());
+    --activeSessions;
+    sessionsDone.notify_all();
+}
+
+// One client session, run as a coroutine on the reactor. It is suspended (holding no thread) while it
+// waits for the next request; commands run on whichever reactor thread resumed it.
+Task<void> Server::handleClient(int clientSocket)
 {
     {
         std::lock_guard<std::mutex> lock(coutMutex);
         std::cout << "Handling client connection..." << std::endl;
     }
 
-    char buffer[1024] = {0};
+    // The connection owns the socket; pending responses keep it alive after this thread exits
+    auto connection = std::make_shared<Connection>(clientSocket, reactor, shutdownToken);
+    connection->setRequestTimeout(std::chrono::milliseconds(config.requestTimeoutMs));
+
+    stats.connectionOpened();
+
+    // Every connection starts on the default graph until it sends use_graph
+    std::shared_ptr<GraphContext> context = graphs.getOrCreate("default");
+
+    // Requests are parsed in place from the input buffer and formatted in the arena, which is reset
+    // after every request, so steady-state traffic does not allocate per command
+    InputBuffer input;
+    RequestArena arena;
+    // Once a client ends a request with a newline, it frames all of them, and a partial line is just
+    // the start of the next request. Until then it may be a client that sends one command per write.
+    bool framed = config.strictInput;
     // Main loop for handling client messages
     while (running.load(std::memory_order_acquire))
     {
-        // Read data from the client socket
-        int valread = read(clientSocket, buffer, 1024);
+        // Read data from the client socket straight into the free space of the input buffer
+        char *target = input.prepare(readChunkSize);
+        ssize_t valread = co_await reactor.read(clientSocket, target, input.space());
 
         // Check if the client has disconnected or if there was an error reading
         if (valread <= 0)
@@ -234,86 +288,277 @@ void Server::handleClient(int clientSocket)
             std::cout << "Client disconnected or error reading" << std::endl;
             break; // Exit the loop if the client has disconnected
         }
+        input.commit(static_cast<size_t>(valread));
 
-        // Convert the received buffer to a string
-        std::string message(buffer);
+        // Process every complete line; pipelined requests can arrive back to back in one read.
+        // Commands that wait for the disk run on a blocking thread while this one serves other clients.
+        std::string_view line;
+        while (input.nextLine(line))
+        {
+            framed = true;
+            if (line.empty())
+            {
+                continue;
+            }
+            if (waitsForDisk(line))
+            {
+                co_await reactor.runBlocking([&]()
+                                             { processCommand(connection, context, line, arena); });
+            }
+            else
+            {
+                processCommand(connection, context, line, arena);
+            }
+            arena.reset();
+        }
 
-        // Log the received message
+        // Unframed clients send one untagged command per write without a trailing newline
+        if (!framed && input.size() > 0 && input.pending()[0] != '#')
         {
-            std::lock_guard<std::mutex> lock(coutMutex);
-            std::cout << "Received message from client: " << message << std::endl;
+            processCommand(connection, context, input.pending(), arena);
+            arena.reset();
+            input.clear();
+        }
+        else if (input.size() > maxRequestLength)
+        {
+            connection->send("Error: Request too long\n");
+            break;
         }
+    }
 
-        // Parse the command from the message
-        std::istringstream iss(message);
-        std::string command;
-        iss >> command; // Extract the first word as the command
+    // Responses still in flight keep the connection open; the socket closes with the last one.
+    // Work for tagged requests is abandoned, since such clients never half-close.
+    connection->getCancellationToken()->cancel();
+    stats.connectionClosed();
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "Client disconnected" << std::endl;
+    }
 
-        // Lambda function to send a response to the client
-        auto sendResponse = [clientSocket, this](const std::string &response)
-        {
-            // Log the response before sending
-            {
-                std::lock_guard<std::mutex> lock(coutMutex);
-                std::cout << "Sending response: " << response << std::endl;
-            }
-            send(clientSocket, response.c_str(), response.length(), 0);
-        };
+    closeSession(clientSocket);
+}
+
+// True for requests that block on disk I/O: export_edges writes a file, and when the graphs are
+// durable, mutations wait for their log record to be synced and use_graph of a new name restores
+// (or creates) the graph's directory
+bool Server::waitsForDisk(std::string_view line) const
+{
+    Tokenizer tokens(line);
+    std::string_view command;
+    tokens.next(command);
+    while (command.size() > 1 && (command[0] == '#' || command[0] == '@'))
+    {
+        command = std::string_view();
+        tokens.next(command);
+    }
+    if (command == "export_edges")
+    {
+        return true;
+    }
+    if (config.dataDirectory.empty())
+    {
+        return false;
+    }
+    std::string_view name;
+    if (command == "use_graph" && tokens.next(name))
+    {
+        return !graphs.contains(std::string(name));
+    }
+    return command == "add_vertex" || command == "add_edge" || command == "remove_vertex" || command == "remove_edge";
+}
+
+// Executes one request line. A line may start with "#<id>" to tag the request; the response is then
+// framed with the same tag and may complete out of order with respect to other requests.
+// MST and metrics work runs on the graph's pipeline shard, so this thread can keep reading requests.
+void Server::processCommand(const std::shared_ptr<Connection> &connection, std::shared_ptr<GraphContext> &context,
+                            std::string_view message, RequestArena &arena)
+{
+    // Log the received message
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "Received message from client: " << message << std::endl;
+    }
+
+    // Parse the optional request tag and the command from the message; tokens are views into it
+    Tokenizer tokens(message);
+    std::string tag;
+    std::string_view command;
+    tokens.next(command); // Extract the first word as the command
+    if (command.size() > 1 && command[0] == '#')
+    {
+        tag = std::string(command.substr(1));
+        command = std::string_view();
+        tokens.next(command);
+    }
 
+    // An optional "@<class>" before the command schedules this request in that class
+    Priority priority = connection->getPriority();
+    if (command.size() > 1 && command[0] == '@')
+    {
+        if (!ActiveObject::parsePriority(command.substr(1), priority))
         {
-            std::lock_guard<std::mutex> lock(coutMutex);
-            std::cout << "Processing command: " << command << std::endl;
+            connection->respond(tag, "Error: Unknown priority class. Use @interactive, @normal or @batch");
+            return;
         }
+        command = std::string_view();
+        tokens.next(command);
+    }
+
+    // Synchronous commands format their response in the request arena and send it right away;
+    // work handed to the pipeline gets a callback (sendResponse) that keeps the connection alive
+    auto reply = [&connection, &tag](std::string_view text)
+    { connection->respond(tag, text); };
+    std::pmr::string response = arena.makeString();
+    GraphManager &graphManager = context->manager;
+    CommandStats &commandStats = stats.getCommand(command);
+    ServerStats::CommandTimer timer(commandStats);
+    Tracer::RequestScope traceScope(commandStats.name.c_str());
 
+    // Work started by this request checks its token: tagged requests end with their connection (and can
+    // be cancelled by tag), untagged ones may outlive a client that only half-closed its socket
+    std::chrono::milliseconds timeout = connection->getRequestTimeout();
+    auto requestToken = std::make_shared<CancellationToken>(
+        tag.empty() ? std::shared_ptr<const CancellationToken>(shutdownToken) : connection->getCancellationToken(),
+        timeout.count() > 0 ? CancellationToken::Clock::now() + timeout : CancellationToken::Clock::time_point::max());
+    if (!tag.empty())
+    {
+        connection->trackRequest(tag, requestToken);
+    }
+    CancellationToken::Scope cancellationScope(requestToken);
+    // Pipeline tasks of this request are queued in its class, as part of this connection's flow. This
+    // thread serves other connections too, so a full stage refuses the task instead of making it wait.
+    ActiveObject::ClassScope classScope(priority, connection->getId());
+    ActiveObject::NoWaitScope noWaitScope;
+
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cout << "Processing command: " << command << std::endl;
+    }
+
+    try
+    {
         if (command == "calculate_mst")
         {
-            std::string algorithm;
-            if (iss >> algorithm)
+            ResponseCallback sendResponse = timer.track(connection->makeResponder(tag));
+            std::string_view algorithmToken;
+            if (tokens.next(algorithmToken))
             {
+                std::string algorithm(algorithmToken);
                 {
                     std::lock_guard<std::mutex> lock(coutMutex);
                     std::cout << "MST algorithm: " << algorithm << std::endl;
                 }
-                if (algorithm == "prim" || algorithm == "kruskal")
+                std::string_view option;
+                if (algorithm == "external")
                 {
-                    std::shared_ptr<Graph> graph;
+                    // Semi-external Kruskal over an edge file; without a file the current graph is exported first
+                    std::string edgeFile;
+                    std::shared_ptr<const Graph> graph;
+                    if (tokens.next(option))
                     {
-                        std::lock_guard<std::mutex> lock(graphMutex);
-                        graph = graphManager.getGraph();
+                        edgeFile = std::string(option);
                     }
+                    else
                     {
-                        std::lock_guard<std::mutex> lock(coutMutex);
-                        std::cout << "Graph vertices: " << graph->getVertices() << std::endl;
+                        edgeFile = context->name + ".edges";
+                        graph = graphManager.getSnapshot();
                     }
-
-                    auto mstCalculator = MSTFactory::createMST(algorithm);
-                    if (!mstCalculator)
+                    if (!isValidFileName(edgeFile))
                     {
-                        sendResponse("Error: Failed to create MST calculator");
-                        continue;
+                        sendResponse("Invalid edge file name. Use: calculate_mst external [file]");
+                        return;
                     }
-
-                    auto mst = mstCalculator->findMST(*graph);
+                    if (!admit(*context))
                     {
-                        std::lock_guard<std::mutex> lock(coutMutex);
-                        std::cout << "MST edges: " << mst.size() << std::endl;
+                        sendResponse(Pipeline::busyMessage);
+                        return;
                     }
-
-                    std::string mstStr = getMSTString(mst, algorithm);
-                    sendResponse("Minimum Spanning Tree:\n" + mstStr);
-
-                    // Calculate metrics using the pipeline
-                    // MARK: Using pipeline here
-                    // pipeline.calculateMetrics(*graph, mst, sendResponse);
+                    context->pipeline->calculateExternalMST(
+                        graph, getEdgeDirectory(), edgeFile, config.externalMemoryBudget,
+                        [edgeFile, sendResponse](const ExternalKruskal::Stats &stats)
+                        {
+                            std::stringstream ss;
+                            ss << "External Minimum Spanning Forest:\n";
+                            ss << "Edges read: " << stats.edgesRead << "\n";
+                            ss << "Vertices: " << stats.vertices << "\n";
+                            ss << "Sorted runs: " << stats.runs << "\n";
+                            ss << "Merge passes: " << stats.mergePasses << "\n";
+                            ss << "Forest edges: " << stats.forestEdges << "\n";
+                            ss << "Total weight: " << stats.totalWeight << "\n";
+                            ss << "Forest written to: " << edgeFile << ".mst\n";
+                            sendResponse(ss.str());
+                        },
+                        sendResponse);
+                    return;
+                }
+                // Optional "forest" and output format (tree, edges or parents)
+                bool forest = false;
+                bool validOptions = true;
+                MSTRenderer::Format format = MSTRenderer::Format::Tree;
+                while (tokens.next(option))
+                {
+                    if (option == "forest")
+                    {
+                        forest = true;
+                    }
+                    else if (!MSTRenderer::parseFormat(std::string(option), format))
+                    {
+                        validOptions = false;
+                    }
+                }
+                if ((algorithm == "prim" || algorithm == "kruskal") && validOptions)
+                {
+                    // The tree is streamed to the socket while it is rendered
+                    ChunkCallback sendChunk = timer.track(connection->makeStreamResponder(tag));
+                    if (!admit(*context))
+                    {
+                        sendResponse(Pipeline::busyMessage);
+                        return;
+                    }
+                    // Compute on a snapshot so later mutations on this connection cannot race with the MST
+                    uint64_t version = 0;
+                    std::shared_ptr<const Graph> graph = graphManager.getSnapshot(&version);
+                    if (forest)
+                    {
+                        // One tree per connected component instead of only the component of the first vertex;
+                        // the forest also refreshes the engine behind the mst_* path queries
+                        std::shared_ptr<GraphContext> target = context;
+                        context->pipeline->calculateForest(
+                            graph, algorithm,
+                            [this, target, version, algorithm, format, sendChunk](std::shared_ptr<const SpanningForest> result)
+                            {
+                                MSTRenderer renderer(format, [&sendChunk](std::string &chunk)
+                                                     { sendChunk(chunk, false); });
+                                renderer.write("Minimum Spanning Forest:\n");
+                                renderForest(renderer, *result, algorithm);
+                                renderer.finish();
+                                sendChunk("", true);
+                                target->queryEngines.install(version, std::make_shared<const MSTQueryEngine>(*result));
+                            },
+                            sendResponse);
+                        return;
+                    }
+                    context->pipeline->calculateMST(
+                        graph, algorithm,
+                        [this, algorithm, format, sendChunk](const std::vector<Edge> &mst)
+                        {
+                            MSTRenderer renderer(format, [&sendChunk](std::string &chunk)
+                                                 { sendChunk(chunk, false); });
+                            renderer.write("Minimum Spanning Tree:\n");
+                            renderMST(renderer, mst, algorithm);
+                            renderer.finish();
+                            sendChunk("", true);
+                        },
+                        sendResponse);
                 }
                 else
                 {
-                    sendResponse("Invalid algorithm. Use 'prim' or 'kruskal'.");
+                    sendResponse("Invalid algorithm. Use 'prim' or 'kruskal', optionally followed by 'forest' and a format (tree, edges or parents), or 'external [file]'.");
                 }
             }
             else
             {
-                sendResponse("Please specify the algorithm: calculate_mst <prim|kruskal>");
+                sendResponse("Please specify the algorithm: calculate_mst <prim|kruskal> [forest] [tree|edges|parents] | calculate_mst external [file]");
             }
         }
         else if (command == "add_vertex")
@@ -322,222 +567,729 @@ void Server::handleClient(int clientSocket)
                 std::lock_guard<std::mutex> lock(coutMutex);
                 std::cout << "Processing add_vertex command" << std::endl;
             }
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                graphManager.addVertex();
-            }
-            sendResponse("Vertex added successfully.\n" + graphManager.getGraphString());
+            graphManager.addVertex();
+            response += "Vertex added successfully.\n";
+            graphManager.appendGraphString(response);
+            reply(response);
         }
         else if (command == "add_edge")
         {
             int v1, v2, weight;
-            if (iss >> v1 >> v2 >> weight)
+            if (tokens.nextInt(v1) && tokens.nextInt(v2) && tokens.nextInt(weight))
             {
-                {
-                    std::lock_guard<std::mutex> lock(graphMutex);
-                    graphManager.addEdge(v1, v2, weight);
-                }
-                sendResponse("Edge added successfully.\n" + graphManager.getGraphString());
+                graphManager.addEdge(v1, v2, weight);
+                response += "Edge added successfully.\n";
+                graphManager.appendGraphString(response);
+                reply(response);
             }
             else
             {
-                sendResponse("Invalid edge format. Use: add_edge <v1> <v2> <weight>");
+                reply("Invalid edge format. Use: add_edge <v1> <v2> <weight>");
             }
         }
         else if (command == "remove_vertex")
         {
             int v;
-            if (iss >> v)
+            if (tokens.nextInt(v))
             {
-                {
-                    std::lock_guard<std::mutex> lock(graphMutex);
-                    graphManager.removeVertex(v);
-                }
-                sendResponse("Vertex removed successfully.\n" + graphManager.getGraphString());
+                graphManager.removeVertex(v);
+                response += "Vertex removed successfully.\n";
+                graphManager.appendGraphString(response);
+                reply(response);
             }
             else
             {
-                sendResponse("Invalid vertex format. Use: remove_vertex <v>");
+                reply("Invalid vertex format. Use: remove_vertex <v>");
             }
         }
         else if (command == "remove_edge")
         {
             int v1, v2;
-            if (iss >> v1 >> v2)
+            if (tokens.nextInt(v1) && tokens.nextInt(v2))
             {
-                {
-                    std::lock_guard<std::mutex> lock(graphMutex);
-                    graphManager.removeEdge(v1, v2);
-                }
-                sendResponse("Edge removed successfully.\n" + graphManager.getGraphString());
+                graphManager.removeEdge(v1, v2);
+                response += "Edge removed successfully.\n";
+                graphManager.appendGraphString(response);
+                reply(response);
             }
             else
             {
-                sendResponse("Invalid edge format. Use: remove_edge <v1> <v2>");
+                reply("Invalid edge format. Use: remove_edge <v1> <v2>");
             }
         }
         else if (command == "metrics_mst")
         {
-            std::shared_ptr<Graph> graph;
-            {
-                std::lock_guard<std::mutex> lock(graphMutex);
-                graph = graphManager.getGraph();
-            }
+            ResponseCallback sendResponse = timer.track(connection->makeResponder(tag));
+            std::shared_ptr<const Graph> graph = graphManager.getSnapshot();
             if (graph->getVertices() == 0)
             {
                 sendResponse("Error: Graph is empty. Add vertices and edges before calculating MST metrics.");
+                return;
             }
-            else
-            {
-                // Determine the MST algorithm to use (default is Kruskal's)
-                std::string algorithm = (command == "calculate_mst" && iss >> algorithm) ? algorithm : "kruskal";
 
-                // Validate the chosen algorithm
-                if (algorithm != "prim" && algorithm != "kruskal")
+            // Determine the MST algorithm to use (default is Kruskal's) and whether to work per component
+            // "approx" may be followed by a relative error bound and a sample budget
+            std::string algorithm = "kruskal";
+            bool forest = false;
+            bool approximate = false;
+            bool full = false;
+            double relativeError = defaultRelativeError;
+            int sampleBudget = defaultSampleBudget;
+            int approximateArguments = 0;
+            std::string_view option;
+            while (tokens.next(option))
+            {
+                double number = 0;
+                bool isNumber = Tokenizer::parseDouble(option, number);
+                if (option == "prim" || option == "kruskal")
                 {
-                    sendResponse("Invalid algorithm. Use 'prim' or 'kruskal'.");
-                    continue;
+                    algorithm = std::string(option);
                 }
-
-                // Log the algorithm and graph information (thread-safe)
+                else if (option == "forest")
                 {
-                    std::lock_guard<std::mutex> lock(coutMutex);
-                    std::cout << "Calculating MST using " << algorithm << " algorithm" << std::endl;
-                    std::cout << "Graph vertices: " << graph->getVertices() << std::endl;
+                    forest = true;
                 }
-
-                // Create an MST calculator based on the chosen algorithm
-                auto mstCalculator = MSTFactory::createMST(algorithm);
-                if (!mstCalculator)
+                else if (option == "full")
+                {
+                    full = true;
+                }
+                else if (option == "approx")
+                {
+                    approximate = true;
+                }
+                else if (approximate && isNumber && approximateArguments == 0 && number > 0 && number < 1)
+                {
+                    relativeError = number;
+                    ++approximateArguments;
+                }
+                else if (approximate && isNumber && approximateArguments < 2 && number >= 1 && number == static_cast<int>(number))
                 {
-                    sendResponse("Error: Failed to create MST calculator");
-                    continue;
+                    sampleBudget = static_cast<int>(number);
+                    approximateArguments = 2;
                 }
+                else
+                {
+                    sendResponse("Invalid option '" + std::string(option) + "'. Use: metrics_mst [prim|kruskal] [forest|full|approx [error] [samples]]");
+                    return;
+                }
+            }
+            if (approximate + forest + full > 1)
+            {
+                sendResponse("Error: choose at most one of 'forest', 'full' and 'approx'.");
+                return;
+            }
 
-                // Calculate the Minimum Spanning Tree
-                auto mst = mstCalculator->findMST(*graph);
+            // Refuse new work while the shard is overloaded instead of queueing more graph copies
+            if (!admit(*context))
+            {
+                sendResponse(Pipeline::busyMessage);
+                return;
+            }
 
-                // Log the number of edges in the MST (thread-safe)
+            // Log the algorithm and graph information (thread-safe)
+            {
+                std::lock_guard<std::mutex> lock(coutMutex);
+                std::cout << "Calculating MST using " << algorithm << " algorithm" << std::endl;
+                std::cout << "Graph vertices: " << graph->getVertices() << std::endl;
+            }
+
+            // Calculate the MST, then its metrics, on the pipeline; the MST and the metrics
+            // are sent together as one response (two segments, never concatenated) once the
+            // last stage finishes
+            Pipeline *pipeline = context->pipeline;
+            SegmentCallback sendSegments = timer.track(connection->makeSegmentResponder(tag));
+            if (forest)
+            {
+                pipeline->calculateForest(
+                    graph, algorithm,
+                    [this, pipeline, algorithm, sendSegments](std::shared_ptr<const SpanningForest> result)
+                    {
+                        Segment forestStr = BufferPool::adopt("Minimum Spanning Forest:\n" + getForestString(*result, algorithm));
+                        pipeline->calculateForestMetrics(result, [forestStr, sendSegments](const std::string &metricsStr)
+                                                         { sendSegments({forestStr, BufferPool::instance().copy(metricsStr)}); });
+                    },
+                    sendResponse);
+                return;
+            }
+            if (full)
+            {
+                // The profile replaces the drawing: it already lists every vertex
+                pipeline->calculateMST(
+                    graph, algorithm,
+                    [pipeline, sendResponse](const std::vector<Edge> &mst)
+                    { pipeline->calculateTreeProfile(std::make_shared<const std::vector<Edge>>(mst), sendResponse); },
+                    sendResponse);
+                return;
+            }
+            if (approximate)
+            {
+                // Huge trees are summarized instead of drawn
+                pipeline->calculateMST(
+                    graph, algorithm,
+                    [pipeline, relativeError, sampleBudget, sendResponse](const std::vector<Edge> &mst)
+                    {
+                        pipeline->calculateApproximateMetrics(std::make_shared<const std::vector<Edge>>(mst),
+                                                              relativeError, sampleBudget, sendResponse);
+                    },
+                    sendResponse);
+                return;
+            }
+            pipeline->calculateMST(
+                graph, algorithm,
+                [this, pipeline, graph, algorithm, sendSegments](const std::vector<Edge> &mst)
                 {
-                    std::lock_guard<std::mutex> lock(coutMutex);
-                    std::cout << "MST edges: " << mst.size() << std::endl;
-                }
+                    Segment mstStr = BufferPool::adopt("Minimum Spanning Tree:\n" + getMSTString(mst, algorithm));
+                    pipeline->calculateMetrics(graph, std::make_shared<const std::vector<Edge>>(mst),
+                                               [mstStr, sendSegments](const std::string &metricsStr)
+                                               { sendSegments({mstStr, BufferPool::instance().copy(metricsStr)}); });
+                },
+                sendResponse);
+        }
+        else if (command == "mst_path" || command == "mst_distance" || command == "mst_bottleneck" ||
+                 command == "mst_batch")
+        {
+            // mst_batch <path|distance|bottleneck> u1 v1 u2 v2 ... answers many pairs in one response
+            ResponseCallback sendResponse = timer.track(connection->makeResponder(tag));
+            bool batch = command == "mst_batch";
+            std::string_view queryToken = command.substr(4);
+            if (batch && !tokens.next(queryToken))
+            {
+                queryToken = std::string_view();
+            }
+            std::string query(queryToken);
+            std::vector<int> vertices;
+            int vertex;
+            while (tokens.nextInt(vertex))
+            {
+                vertices.push_back(vertex);
+            }
+            std::vector<std::pair<int, int>> pairs;
+            for (size_t i = 0; i + 1 < vertices.size(); i += 2)
+            {
+                pairs.emplace_back(vertices[i], vertices[i + 1]);
+            }
+            bool validQuery = query == "path" || query == "distance" || query == "bottleneck";
+            if (!validQuery || pairs.empty() || vertices.size() % 2 != 0 || !tokens.atEnd() ||
+                (!batch && pairs.size() != 1))
+            {
+                sendResponse(batch ? "Invalid query. Use: mst_batch <path|distance|bottleneck> <u1> <v1> [<u2> <v2> ...]"
+                                   : "Invalid query. Use: " + std::string(command) + " <u> <v>");
+                return;
+            }
+            context->queryEngines.get(
+                graphManager, *context->pipeline, shutdownToken,
+                [query, pairs, batch, sendResponse](std::shared_ptr<const MSTQueryEngine> engine)
+                { sendResponse(answerPathQueries(*engine, query, pairs, batch)); },
+                sendResponse);
+        }
+        else if (command == "apsp_stats")
+        {
+            // Shortest paths between all pairs of the original graph (not the MST)
+            ResponseCallback sendResponse = timer.track(connection->makeResponder(tag));
+            std::shared_ptr<const Graph> graph = graphManager.getSnapshot();
+            if (graph->getVertices() == 0)
+            {
+                sendResponse("Error: Graph is empty. Add vertices and edges before calculating all-pairs distances.");
+                return;
+            }
+            if (graph->getVertices() > APSPEngine::maxVertices)
+            {
+                sendResponse("Error: all-pairs distances are limited to " + std::to_string(APSPEngine::maxVertices) +
+                             " vertices; this graph has " + std::to_string(graph->getVertices()) + ".");
+                return;
+            }
+            if (!admit(*context))
+            {
+                sendResponse(Pipeline::busyMessage);
+                return;
+            }
+            context->pipeline->calculateAllPairsStats(
+                graph, graphs.getComputePool(), config.apspThreads, graphs.getApspSlots(),
+                [sendResponse](const APSPStats &stats)
+                {
+                    std::stringstream ss;
+                    ss << "All-Pairs Shortest Paths:\n";
+                    ss << "Vertices: " << stats.vertices << "\n";
+                    ss << "Edges: " << stats.edges << "\n";
+                    ss << "Connected: " << (stats.unreachablePairs == 0 ? "yes" : "no") << "\n";
+                    ss << "Reachable pairs: " << stats.reachablePairs << "\n";
+                    ss << "Unreachable pairs: " << stats.unreachablePairs << "\n";
+                    if (stats.reachablePairs > 0)
+                    {
+                        ss << "Diameter: " << stats.diameter << " (" << stats.diameterFrom << " - " << stats.diameterTo << ")\n";
+                        ss << "Radius: " << stats.radius << " (center " << stats.center << ")\n";
+                        ss << "Average distance: " << stats.averageDistance << "\n";
+                    }
+                    ss << "Computed in " << stats.milliseconds << " ms (" << stats.distanceBits << "-bit distances, "
+                       << stats.kernel << " kernel, " << stats.threads << " threads)\n";
+                    sendResponse(ss.str());
+                },
+                sendResponse);
+        }
+        else if (command == "shortest_path" || command == "shortest_paths")
+        {
+            // shortest_path <source> <target> gives one path; shortest_paths <s1> [<s2> ...] summarizes each source
+            ResponseCallback sendResponse = timer.track(connection->makeResponder(tag));
+            bool batch = command == "shortest_paths";
+            std::vector<int> vertices;
+            int vertex;
+            while (tokens.nextInt(vertex))
+            {
+                vertices.push_back(vertex);
+            }
+            if (!tokens.atEnd() || (batch ? vertices.empty() || vertices.size() > ShortestPaths::maxBatchSources
+                                          : vertices.size() != 2))
+            {
+                sendResponse(batch ? "Invalid query. Use: shortest_paths <source> [<source> ...] (at most " +
+                                         std::to_string(ShortestPaths::maxBatchSources) + " sources)"
+                                   : "Invalid query. Use: shortest_path <source> <target>");
+                return;
+            }
+            uint64_t version = 0;
+            std::shared_ptr<const Graph> graph = graphManager.getSnapshot(&version);
+            if (graph->getVertices() == 0)
+            {
+                sendResponse("Error: Graph is empty. Add vertices and edges before calculating shortest paths.");
+                return;
+            }
+            if (!admit(*context))
+            {
+                sendResponse(Pipeline::busyMessage);
+                return;
+            }
+            context->pipeline->calculateShortestPaths(
+                graph, version, context->csrSnapshots, graphs.getComputePool(), config.ssspThreads,
+                [batch, vertices, sendResponse](ShortestPaths &engine)
+                { sendResponse(answerShortestPaths(engine, vertices, batch)); },
+                sendResponse);
+        }
+        else if (command == "generate")
+        {
+            // generate <kind> <parameters...> [seed <s>] [weights <min> <max>] replaces the current graph
+            ResponseCallback sendResponse = timer.track(connection->makeResponder(tag));
+            std::vector<std::string> args;
+            std::string_view token;
+            while (tokens.next(token))
+            {
+                args.emplace_back(token);
+            }
+            GraphGenerator::Spec spec;
+            try
+            {
+                spec = GraphGenerator::parse(args);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                sendResponse(std::string(e.what()) + ". Use: generate " + GraphGenerator::getUsage());
+                return;
+            }
+            if (!admit(*context))
+            {
+                sendResponse(Pipeline::busyMessage);
+                return;
+            }
+            std::shared_ptr<GraphContext> target = context;
+            context->pipeline->generateGraph(
+                spec,
+                [target, sendResponse](Graph &graph)
+                {
+                    int vertices = graph.getVertices();
+                    int edges = graph.getEdges();
+                    target->manager.replaceGraph(std::move(graph));
+                    sendResponse("Generated graph '" + target->name + "': " + std::to_string(vertices) + " vertices, " +
+                                 std::to_string(edges) + " edges.");
+                },
+                sendResponse);
+        }
+        else if (command == "export_edges")
+        {
+            std::string_view token;
+            std::string edgeFile;
+            if (tokens.next(token) && isValidFileName(edgeFile = std::string(token)))
+            {
+                uint64_t written = ExternalKruskal::writeEdgeFile(*graphManager.getSnapshot(), getEdgeDirectory() + "/" + edgeFile);
+                reply("Exported " + std::to_string(written) + " edges to " + edgeFile + ".");
+            }
+            else
+            {
+                reply("Invalid edge file name. Use: export_edges <file> (letters, digits, '_', '-' or '.')");
+            }
+        }
+        else if (command == "use_graph")
+        {
+            std::string_view token;
+            std::string name;
+            if (tokens.next(token) && GraphRegistry::isValidName(name = std::string(token)))
+            {
+                context = graphs.getOrCreate(name);
+                reply("Using graph '" + name + "' (shard " + std::to_string(context->shard) + ", " +
+                             std::to_string(context->manager.getVertices()) + " vertices).");
+            }
+            else
+            {
+                reply("Invalid graph name. Use: use_graph <name> (letters, digits, '_' or '-')");
+            }
+        }
+        else if (command == "health")
+        {
+            reply(getHealthString());
+        }
+        else if (command == "trace")
+        {
+            // trace on|off|clear|dump: the dump is Chrome trace JSON
+            std::string_view action;
+            tokens.next(action);
+            if (action == "on" || action == "off")
+            {
+                Tracer::setEnabled(action == "on");
+                reply(action == "on" ? "Tracing enabled." : "Tracing disabled.");
+            }
+            else if (action == "clear")
+            {
+                Tracer::clear();
+                reply("Trace cleared.");
+            }
+            else if (action == "dump")
+            {
+                reply(Tracer::exportChromeTrace());
+            }
+            else
+            {
+                reply("Invalid trace action. Use: trace <on|off|clear|dump>");
+            }
+        }
+        else if (command == "stats")
+        {
+            reply(stats.format(graphs));
+        }
+        else if (command == "priority")
+        {
+            // priority <interactive|normal|batch>: default class of later requests on this connection
+            std::string_view name;
+            Priority chosen;
+            if (tokens.next(name) && ActiveObject::parsePriority(name, chosen))
+            {
+                connection->setPriority(chosen);
+                response += "Priority set to ";
+                response += ActiveObject::getPriorityName(chosen);
+                response += ".";
+                reply(response);
+            }
+            else
+            {
+                reply("Invalid priority command. Use: priority <interactive|normal|batch>");
+            }
+        }
+        else if (command == "deadline")
+        {
+            // deadline <ms>: time limit for each later request on this connection (0 = none)
+            int milliseconds;
+            if (tokens.nextInt(milliseconds) && milliseconds >= 0)
+            {
+                connection->setRequestTimeout(std::chrono::milliseconds(milliseconds));
+                response += "Request deadline set to ";
+                appendNumber(response, milliseconds);
+                response += " ms.";
+                reply(response);
+            }
+            else
+            {
+                reply("Invalid deadline command. Use: deadline <milliseconds>");
+            }
+        }
+        else if (command == "cancel")
+        {
+            // cancel <tag>: stops the work of a tagged request on this connection; it answers with an error
+            std::string_view target;
+            if (tokens.next(target) && !target.empty() && target[0] == '#')
+            {
+                target.remove_prefix(1);
+            }
+            if (target.empty())
+            {
+                reply("Invalid cancel command. Use: cancel <tag>");
+            }
+            else if (connection->cancelRequest(std::string(target)))
+            {
+                response += "Cancelled request #";
+                response += target;
+                reply(response);
+            }
+            else
+            {
+                response += "Error: No request #";
+                response += target;
+                response += " in progress";
+                reply(response);
+            }
+        }
+        else if (command == "list_graphs")
+        {
+            response += "Graphs:\n";
+            for (const auto &graphContext : graphs.listGraphs())
+            {
+                response += graphContext == context ? "* " : "  ";
+                response += graphContext->name;
+                response += " (shard ";
+                appendNumber(response, graphContext->shard);
+                response += ", ";
+                appendNumber(response, graphContext->manager.getVertices());
+                response += " vertices, ";
+                appendNumber(response, graphContext->manager.getEdges());
+                response += " edges)\n";
+            }
+            reply(response);
+        }
+        else
+        {
+            response += "Unknown command: ";
+            response += command;
+            reply(response);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        // A bad request (e.g. an edge to a missing vertex) must not take the connection down
+        response = "Error: ";
+        response += e.what();
+        reply(response);
+    }
+}
 
-                // Convert the MST to a string representation and send it to the client
-                std::string mstStr = getMSTString(mst, algorithm);
-                sendResponse("Minimum Spanning Tree:\n" + mstStr);
+// Admission control: only start new pipeline work while the graph's shard is below its pending limit
+// and none of its stage queues is full
+bool Server::admit(const GraphContext &context) const
+{
+    return (config.maxPendingPerShard == 0 || context.pipeline->getQueueDepth() < config.maxPendingPerShard) &&
+           context.pipeline->hasRoom();
+}
 
-                // Calculate metrics using the pipeline
-                try
+// Answers path queries against the MST of the graph. A single query gets a sentence; a batch gets one
+// line per pair ("u v <answer>"), with per-pair errors inline so one bad pair does not void the rest.
+std::string Server::answerPathQueries(const MSTQueryEngine &engine, const std::string &query,
+                                      const std::vector<std::pair<int, int>> &pairs, bool batch)
+{
+    std::stringstream ss;
+    for (const auto &[u, v] : pairs)
+    {
+        if (batch)
+        {
+            ss << u << " " << v << " ";
+        }
+        try
+        {
+            if (query == "distance")
+            {
+                long long distance = engine.distance(u, v);
+                ss << (batch ? "" : "MST distance between " + std::to_string(u) + " and " + std::to_string(v) + ": ")
+                   << distance;
+            }
+            else if (query == "bottleneck")
+            {
+                Edge edge = engine.bottleneck(u, v);
+                if (batch)
                 {
-                    // Use a lambda function to send the calculated metrics back to the client
-                    pipeline.calculateMetrics(*graph, mst, [this, &sendResponse](const std::string &metricsStr)
-                                              { sendResponse("MST Metrics:\n" + metricsStr); });
+                    ss << edge.source << " " << edge.destination << " " << edge.weight;
                 }
-                catch (const std::exception &e)
+                else
                 {
-                    // Handle specific exceptions (thread-safe)
-                    std::lock_guard<std::mutex> lock(coutMutex);
-                    std::cerr << "Error calculating metrics: " << e.what() << std::endl;
-                    sendResponse("Error calculating metrics: " + std::string(e.what()));
+                    ss << "MST bottleneck between " << u << " and " << v << ": " << edge.source << " - "
+                       << edge.destination << " [weight: " << edge.weight << "]";
                 }
-                catch (...)
+            }
+            else
+            {
+                std::vector<int> path = engine.path(u, v);
+                if (!batch)
                 {
-                    // Handle any other unexpected exceptions (thread-safe)
-                    std::lock_guard<std::mutex> lock(coutMutex);
-                    std::cerr << "Unknown error occurred while calculating metrics" << std::endl;
-                    sendResponse("Unknown error occurred while calculating metrics");
+                    ss << "MST path from " << u << " to " << v << ": ";
+                }
+                for (size_t i = 0; i < path.size(); ++i)
+                {
+                    ss << (i ? (batch ? " " : " -> ") : "") << path[i];
+                }
+                if (!batch)
+                {
+                    ss << " (distance: " << engine.distance(u, v) << ")";
                 }
             }
         }
-        else
+        catch (const std::invalid_argument &e)
         {
-            sendResponse("Unknown command: " + command);
+            ss << (batch ? "error: " : "Error: ") << e.what();
         }
+        ss << "\n";
+    }
+    return ss.str();
+}
 
-        // Clear the buffer for the next message
-        std::memset(buffer, 0, sizeof(buffer));
+// Answers shortest path queries on the whole graph. A single query gets the path and its length; a
+// batch gets one line per source summarizing the distances from it.
+std::string Server::answerShortestPaths(ShortestPaths &engine, const std::vector<int> &vertices, bool batch)
+{
+    std::stringstream ss;
+    if (batch)
+    {
+        std::vector<ShortestPathSummary> summaries = engine.runBatch(vertices);
+        ss << "Shortest paths from " << summaries.size() << " source" << (summaries.size() == 1 ? "" : "s") << ":\n";
+        for (const ShortestPathSummary &summary : summaries)
+        {
+            ss << "Source " << summary.source << ": reached " << summary.reached << " of "
+               << engine.getGraph().getVertexCount() << " vertices";
+            if (summary.reached > 1)
+            {
+                ss << ", farthest " << summary.farthest << " at distance " << summary.eccentricity
+                   << ", average distance " << summary.averageDistance;
+            }
+            ss << "\n";
+        }
     }
+    else
+    {
+        int source = vertices[0];
+        int target = vertices[1];
+        std::vector<long long> distances = engine.run(source);
+        std::vector<int> path = engine.path(distances, source, target);
+        if (path.empty())
+        {
+            ss << "No path from " << source << " to " << target << "\n";
+        }
+        else
+        {
+            ss << "Shortest path from " << source << " to " << target << ": ";
+            for (size_t i = 0; i < path.size(); ++i)
+            {
+                ss << (i ? " -> " : "") << path[i];
+            }
+            ss << " (distance: " << distances[engine.getGraph().indexOf(target)] << ")\n";
+        }
+    }
+    ss << "Computed in " << engine.getMilliseconds() << " ms (" << engine.getAlgorithm();
+    if (engine.getDelta() > 0)
+    {
+        ss << " with delta " << engine.getDelta();
+    }
+    ss << ", " << engine.getThreads() << " thread" << (engine.getThreads() == 1 ? "" : "s") << ")\n";
+    return ss.str();
+}
 
-    close(clientSocket);
+// Edge files are kept next to the durable state unless a separate directory was configured
+std::string Server::getEdgeDirectory() const
+{
+    if (!config.edgeDirectory.empty())
     {
-        std::lock_guard<std::mutex> lock(coutMutex);
-        std::cout << "Client disconnected" << std::endl;
+        return config.edgeDirectory;
     }
+    return config.dataDirectory.empty() ? "." : config.dataDirectory;
+}
 
-    // Remove the client socket from the vector
+// Edge file names come from clients, so they must stay inside the edge directory
+bool Server::isValidFileName(const std::string &name)
+{
+    if (name.empty() || name.size() > 128 || name[0] == '.')
     {
-        std::lock_guard<std::mutex> lock(clientSocketsMutex);
-        clientSockets.erase(std::remove(clientSockets.begin(), clientSockets.end(), clientSocket), clientSockets.end());
+        return false;
     }
+    return std::all_of(name.begin(), name.end(), [](char c)
+                       { return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '-' || c == '.'; });
 }
 
-// This function converts the Minimum Spanning Tree (MST) into a string representation
-std::string Server::getMSTString(const std::vector<Edge> &mst, const std::string &algorithm)
+// Reports queue depths in a simple "key: value" format that load balancers can poll
+std::string Server::getHealthString() const
 {
+    size_t depth = 0;
+    size_t busiestShard = 0;
+    uint64_t rejected = 0;
+    uint64_t dropped = 0;
+    const auto &shards = graphs.getShards();
+    for (const auto &shard : shards)
+    {
+        size_t shardDepth = shard->getQueueDepth();
+        depth += shardDepth;
+        busiestShard = std::max(busiestShard, shardDepth);
+        rejected += shard->getRejectedCount();
+        dropped += shard->getDroppedCount();
+    }
+    bool busy = config.maxPendingPerShard != 0 && busiestShard >= config.maxPendingPerShard;
+
     std::stringstream ss;
+    ss << "status: " << (busy ? "busy" : "ok") << "\n";
+    ss << "queue_depth: " << depth << "\n";
+    ss << "max_shard_queue_depth: " << busiestShard << "\n";
+    ss << "max_pending_per_shard: " << config.maxPendingPerShard << "\n";
+    ss << "rejected_tasks: " << rejected << "\n";
+    ss << "shed_tasks: " << dropped << "\n";
+    for (size_t i = 0; i < shards.size(); ++i)
+    {
+        ss << "shard_" << i << "_stage_depths:";
+        for (size_t stageDepth : shards[i]->getStageDepths())
+        {
+            ss << " " << stageDepth;
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+// Writes the Minimum Spanning Tree (MST) in the renderer's format, after a line naming the algorithm
+void Server::renderMST(MSTRenderer &renderer, const std::vector<Edge> &mst, const std::string &algorithm)
+{
     // Add header indicating which algorithm was used
-    ss << "MST created using " << (algorithm == "prim" ? "Prim's" : "Kruskal's") << " algorithm.\n";
+    renderer.write(std::string("MST created using ") + (algorithm == "prim" ? "Prim's" : "Kruskal's") + " algorithm.\n");
 
     // Check if the MST is empty
     if (mst.empty())
     {
-        ss << "The MST is empty. The graph might be disconnected or have no edges.\n";
-        return ss.str();
-    }
-
-    // Create an adjacency list representation of the tree
-    std::map<int, std::vector<std::pair<int, int>>> tree;
-    for (const auto &edge : mst)
-    {
-        tree[edge.source].emplace_back(edge.destination, edge.weight);
-        tree[edge.destination].emplace_back(edge.source, edge.weight);
+        renderer.write("The MST is empty. The graph might be disconnected or have no edges.\n");
+        return;
     }
+    renderer.renderTree(mst);
+}
 
-    // Recursive lambda function to print the tree structure
-    std::function<void(int, int, std::string, std::string, bool)> printNode =
-        [&](int node, int parent, std::string prefix, std::string childPrefix, bool isLast)
+// Writes every tree of a spanning forest, one component after another
+void Server::renderForest(MSTRenderer &renderer, const SpanningForest &forest, const std::string &algorithm)
+{
+    renderer.write(std::string("Minimum spanning forest created using ") + (algorithm == "prim" ? "Prim's" : "Kruskal's") +
+                   " algorithm.\n");
+    renderer.write("Components: " + std::to_string(forest.getComponentCount()) + "\n");
+    for (size_t c = 0; c < forest.getComponentCount(); ++c)
     {
-        ss << prefix;
-        if (parent != -1)
+        renderer.write("Component " + std::to_string(c) + " (" + std::to_string(forest.componentSizes[c]) + " vertices):\n");
+        if (forest.componentOffsets[c] != forest.componentOffsets[c + 1])
         {
-            ss << (isLast ? "└─ " : "├─ ");
-            auto it = std::find_if(tree[node].begin(), tree[node].end(),
-                                   [parent](const auto &p)
-                                   { return p.first == parent; });
-            if (it != tree[node].end())
-            {
-                ss << "Node " << node << " [weight: " << it->second << "]";
-            }
+            renderer.renderTree(forest.getComponentEdges(c));
         }
-        else
+        else if (renderer.getFormat() == MSTRenderer::Format::Tree)
         {
-            ss << "Node " << node;
+            renderer.write("Node " + std::to_string(forest.componentRoots[c]) + "\n");
         }
-        ss << "\n";
-
-        // Recursively print child nodes
-        for (size_t i = 0; i < tree[node].size(); ++i)
+        else if (renderer.getFormat() == MSTRenderer::Format::Parents)
         {
-            const auto &[child, weight] = tree[node][i];
-            if (child != parent)
-            {
-                bool isLastChild = (i == tree[node].size() - 1) ||
-                                   (i == tree[node].size() - 2 && tree[node][i + 1].first == parent);
-                printNode(child, node,
-                          childPrefix + (isLast ? "   " : "│  "),
-                          childPrefix + (isLast ? "   " : "│  "),
-                          isLastChild);
-            }
+            renderer.write(std::to_string(forest.componentRoots[c]) + " -1 0\n");
         }
-    };
-
-    // Start printing from the first node in the MST
-    if (!mst.empty())
-    {
-        printNode(mst[0].source, -1, "", "", true);
     }
-    return ss.str();
+}
+
+// Renders the MST as one string in the tree format (used where more text follows it)
+std::string Server::getMSTString(const std::vector<Edge> &mst, const std::string &algorithm)
+{
+    std::string result;
+    MSTRenderer renderer(MSTRenderer::Format::Tree, [&result](std::string &chunk)
+                         { result += chunk; });
+    renderMST(renderer, mst, algorithm);
+    renderer.finish();
+    return result;
+}
+
+// Renders a spanning forest as one string in the tree format
+std::string Server::getForestString(const SpanningForest &forest, const std::string &algorithm)
+{
+    std::string result;
+    MSTRenderer renderer(MSTRenderer::Format::Tree, [&result](std::string &chunk)
+                         { result += chunk; });
+    renderForest(renderer, forest, algorithm);
+    renderer.finish();
+    return result;
 }
 
 // This function handles accepting new client connections
@@ -564,14 +1316,70 @@ void Server::acceptClients()
             std::cout << "New client connected" << std::endl;
         }
 
+        // Hand the client to the reactor; its session runs as a coroutine on the reactor threads
+        openSession(clientSocket);
+        reactor.spawn(handleClient(clientSocket));
+    }
+}
+
+// Opens the Prometheus endpoint on the loopback interface only
+bool Server::startMetricsEndpoint()
+{
+    metricsSocket = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    sockaddr_in metricsAddr{};
+    metricsAddr.sin_family = AF_INET;
+    metricsAddr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    metricsAddr.sin_port = htons(config.metricsPort);
+    if (metricsSocket == -1 || setsockopt(metricsSocket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        bind(metricsSocket, (struct sockaddr *)&metricsAddr, sizeof(metricsAddr)) < 0 || listen(metricsSocket, 8) < 0)
+    {
+        std::lock_guard<std::mutex> lock(coutMutex);
+        std::cerr << "Error opening metrics port " << config.metricsPort << ": " << strerror(errno) << std::endl;
+        if (metricsSocket != -1)
         {
-            std::lock_guard<std::mutex> socketLock(clientSocketsMutex);
-            std::lock_guard<std::mutex> threadLock(clientThreadsMutex);
+            close(metricsSocket);
+            metricsSocket = -1;
+        }
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cout << "Metrics available at http://127.0.0.1:" << config.metricsPort << "/metrics" << std::endl;
+    return true;
+}
 
-            // Add the new client socket to the list
-            clientSockets.push_back(clientSocket);
-            // Start a new thread to handle this client
-            clientThreads.emplace_back(&Server::handleClient, this, clientSocket);
+// Accepts scrapes on the metrics port; each is answered by its own coroutine on the reactor, so a
+// slow scraper does not hold up the others
+void Server::serveMetrics()
+{
+    while (running.load(std::memory_order_acquire))
+    {
+        int scraper = accept(metricsSocket, nullptr, nullptr);
+        if (scraper < 0)
+        {
+            if (!running.load(std::memory_order_acquire))
+            {
+                break;
+            }
+            continue;
         }
+        openSession(scraper);
+        reactor.spawn(answerScrape(scraper));
     }
-}
\ No newline at end of file
+}
+
+// Answers an HTTP request with the current stats in the Prometheus text format
+Task<void> Server::answerScrape(int scraper)
+{
+    // Read (and ignore) the request
+    char request[1024];
+    if (co_await reactor.read(scraper, request, sizeof(request)) > 0)
+    {
+        std::string body = stats.formatPrometheus(graphs);
+        std::string reply = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                            std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        co_await reactor.write(scraper, reply.data(), reply.size());
+    }
+    closeSession(scraper);
+    close(scraper);
+}
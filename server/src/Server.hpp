@@ -1,16 +1,25 @@
 #pragma once
-#include "Pipeline.hpp"
+#include "GraphRegistry.hpp"
+#include "Connection.hpp"
+#include "ServerConfig.hpp"
+#include "MSTRenderer.hpp"
+#include "RequestArena.hpp"
+#include "ServerStats.hpp"
+#include "Reactor.hpp"
+#include "Coroutine.hpp"
 #include "../../common/MSTFactory.hpp"
 #include <string>
 #include <atomic>
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <sstream>
 
 class Server
 {
 public:
-    Server(int port);
+    Server(int port, const ServerConfig &config = ServerConfig());
     void start();
     void stop();
     bool isRunning() const { return running; }
@@ -18,17 +27,45 @@ public:
 
 private:
     int port;
+    ServerConfig config;
     std::atomic<bool> running;
-    GraphManager graphManager;
-    Pipeline pipeline;
+    ServerStats stats; // Declared before graphs: pipeline callbacks record into it until the shards stop
+    GraphRegistry graphs;
     int serverSocket;
+    int metricsSocket; // Prometheus endpoint (-1 when --metrics-port is not set)
     std::thread acceptThread;
-    std::vector<std::thread> clientThreads;
-    std::vector<int> clientSockets;
-    std::mutex clientThreadsMutex;
+    std::thread metricsThread;
+    Reactor reactor;                // Runs every client connection and metrics scrape as a coroutine
+    std::vector<int> clientSockets; // Sockets of running sessions (clients and scrapes)
+    size_t activeSessions;          // Session coroutines that have not finished yet
     std::mutex clientSocketsMutex;
+    std::condition_variable sessionsDone;
+    std::shared_ptr<CancellationToken> shutdownToken; // Parent of every request's token
 
-    void handleClient(int clientSocket);
+    static const size_t maxRequestLength = 1 << 20; // Longest request line accepted without a newline
+    static const size_t readChunkSize = 4096;        // Free space ensured in the input buffer before each read
+    static constexpr double defaultRelativeError = 0.05; // metrics_mst approx: target interval half-width
+    static const int defaultSampleBudget = 64;            // metrics_mst approx: most sources sampled
+
+    Task<void> handleClient(int clientSocket);
+    bool waitsForDisk(std::string_view line) const;
+    Task<void> answerScrape(int scraper);
+    void openSession(int socket);
+    void closeSession(int socket);
+    bool admit(const GraphContext &context) const;
+    std::string getHealthString() const;
+    std::string getEdgeDirectory() const;
+    static bool isValidFileName(const std::string &name);
+    static std::string answerPathQueries(const MSTQueryEngine &engine, const std::string &query,
+                                         const std::vector<std::pair<int, int>> &pairs, bool batch);
+    static std::string answerShortestPaths(ShortestPaths &engine, const std::vector<int> &vertices, bool batch);
+    void processCommand(const std::shared_ptr<Connection> &connection, std::shared_ptr<GraphContext> &context,
+                        std::string_view message, RequestArena &arena);
     void acceptClients();
+    bool startMetricsEndpoint();
+    void serveMetrics();
     std::string getMSTString(const std::vector<Edge> &mst, const std::string &algorithm);
+    std::string getForestString(const SpanningForest &forest, const std::string &algorithm);
+    void renderMST(MSTRenderer &renderer, const std::vector<Edge> &mst, const std::string &algorithm);
+    void renderForest(MSTRenderer &renderer, const SpanningForest &forest, const std::string &algorithm);
 };
\ No newline at end of file
@@ -0,0 +1,29 @@
+#pragma once
+#include "ActiveObject.hpp"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Runtime options for the server, filled in from the command line in main.cpp
+struct ServerConfig
+{
+    std::string dataDirectory;       // Where the mutation log and snapshots live (empty = memory only)
+    size_t snapshotInterval = 10000; // Logged mutations between snapshot compactions (0 = never)
+    size_t shardCount = 0;           // Pipeline shards that graphs are spread over (0 = one per core)
+    size_t maxGraphs = 64;           // Named graphs that may exist at once (0 = unlimited)
+    size_t stageQueueCapacity = 64;  // Tasks each pipeline stage may queue (0 = unbounded)
+    OverflowPolicy overflowPolicy = OverflowPolicy::Block; // What a full stage queue does
+    size_t maxPendingPerShard = 128; // Admission limit: queued tasks per shard before new work is refused
+    std::string edgeDirectory;       // Edge files and external sort runs (empty = data directory, else ".")
+    size_t externalMemoryBudget = 256u << 20; // Bytes of edge buffers for the external-memory MST
+    int metricsPort = 0;             // Local port of the Prometheus text endpoint (0 = disabled)
+    std::vector<int> stageCpus;      // CPUs for pipeline workers, split into one block per shard (empty = unpinned)
+    std::vector<int> ioCpus;         // CPUs the accept and connection threads may run on (empty = unpinned)
+    size_t ioThreads = 2;            // Threads multiplexing all client connections
+    size_t blockingThreads = 4;      // Threads running commands that wait for the disk
+    size_t requestTimeoutMs = 0;     // Default deadline of every request (0 = none)
+    size_t apspThreads = 0;          // Threads of one all-pairs shortest path run (0 = one per core)
+    size_t ssspThreads = 0;          // Threads of one shortest path query (0 = one per core)
+    size_t apspConcurrency = 1;      // All-pairs runs (and matrices) in progress at once, server-wide
+    bool strictInput = false;        // Only run newline-terminated requests, even before a client sent one
+};
@@ -0,0 +1,248 @@
+// This file implements ServerStats and formats it for the stats command and for Prometheus.
+
+#include "ServerStats.hpp"
+#include "GraphRegistry.hpp"
+#include <sstream>
+
+namespace
+{
+    // Commands with their own latency histogram
+    const char *const knownCommands[] = {
+        "add_vertex", "add_edge", "remove_vertex", "remove_edge", "calculate_mst", "metrics_mst",
+        "mst_path", "mst_distance", "mst_bottleneck", "mst_batch", "apsp_stats", "shortest_path", "shortest_paths",
+        "export_edges", "generate", "use_graph", "list_graphs", "health", "stats", "trace", "deadline", "cancel", "priority"};
+
+    const double quantiles[] = {0.5, 0.9, 0.99};
+
+    // One "name: p50=.. p90=.. p99=.. max=.." summary in microseconds
+    void writeSummary(std::ostream &out, const LatencyHistogram &histogram)
+    {
+        out << "count=" << histogram.getCount() << " p50=" << histogram.getPercentile(0.5)
+            << "us p90=" << histogram.getPercentile(0.9) << "us p99=" << histogram.getPercentile(0.99)
+            << "us max=" << histogram.getMax() << "us";
+    }
+
+    // A Prometheus summary (quantiles, sum and count in seconds) with the given labels
+    void writePrometheusSummary(std::ostream &out, const std::string &metric, const std::string &labels,
+                                const LatencyHistogram &histogram)
+    {
+        for (double quantile : quantiles)
+        {
+            out << metric << "{" << labels << ",quantile=\"" << quantile << "\"} "
+                << histogram.getPercentile(quantile) / 1e6 << "\n";
+        }
+        out << metric << "_sum{" << labels << "} " << histogram.getSum() / 1e6 << "\n";
+        out << metric << "_count{" << labels << "} " << histogram.getCount() << "\n";
+    }
+}
+
+ServerStats::ServerStats() : startTime(Clock::now()), connectionsAccepted(0), connectionsActive(0)
+{
+    for (const char *name : knownCommands)
+    {
+        commands.push_back(std::make_unique<CommandStats>(name));
+    }
+    commands.push_back(std::make_unique<CommandStats>("other"));
+}
+
+CommandStats &ServerStats::getCommand(std::string_view name)
+{
+    for (size_t i = 0; i + 1 < commands.size(); ++i)
+    {
+        if (commands[i]->name == name)
+        {
+            return *commands[i];
+        }
+    }
+    return *commands.back();
+}
+
+void ServerStats::connectionOpened()
+{
+    connectionsAccepted.fetch_add(1, std::memory_order_relaxed);
+    connectionsActive.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ServerStats::connectionClosed()
+{
+    connectionsActive.fetch_sub(1, std::memory_order_relaxed);
+}
+
+// Human-readable report for the stats command
+std::string ServerStats::format(const GraphRegistry &graphs) const
+{
+    std::stringstream ss;
+    ss << "uptime_seconds: " << std::chrono::duration_cast<std::chrono::seconds>(Clock::now() - startTime).count() << "\n";
+    ss << "connections: active=" << connectionsActive.load(std::memory_order_relaxed)
+       << " accepted=" << connectionsAccepted.load(std::memory_order_relaxed) << "\n";
+    ss << "commands:\n";
+    for (const auto &command : commands)
+    {
+        if (command->latency.getCount() > 0)
+        {
+            ss << "  " << command->name << ": ";
+            writeSummary(ss, command->latency);
+            ss << "\n";
+        }
+    }
+    ss << "stages:\n";
+    const auto &shards = graphs.getShards();
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        for (int stage = 0; stage < Pipeline::getStageCount(); ++stage)
+        {
+            const ActiveObject &activeObject = shards[shard]->getStage(stage);
+            ss << "  shard " << shard << " stage " << stage << ": depth=" << activeObject.getQueueDepth() << "\n";
+            ss << "    wait: ";
+            writeSummary(ss, activeObject.getQueueWait());
+            for (Priority priority : {Priority::Interactive, Priority::Normal, Priority::Batch})
+            {
+                if (activeObject.getQueueWait(priority).getCount() > 0)
+                {
+                    ss << "\n    wait " << ActiveObject::getPriorityName(priority) << ": ";
+                    writeSummary(ss, activeObject.getQueueWait(priority));
+                }
+            }
+            ss << "\n    service: ";
+            writeSummary(ss, activeObject.getServiceTime());
+            ss << "\n";
+        }
+        std::stringstream plan(shards[shard]->getPlanString());
+        std::string line;
+        while (std::getline(plan, line))
+        {
+            ss << "  shard " << shard << " plan " << line << "\n";
+        }
+    }
+    ss << "graphs:\n";
+    for (const auto &graph : graphs.listGraphs())
+    {
+        ss << "  " << graph->name << ": vertices=" << graph->manager.getVertices()
+           << " edges=" << graph->manager.getEdges() << " version=" << graph->manager.getVersion() << "\n";
+    }
+    return ss.str();
+}
+
+// Prometheus text exposition format (version 0.0.4); latencies are summaries in seconds
+std::string ServerStats::formatPrometheus(const GraphRegistry &graphs) const
+{
+    std::stringstream ss;
+    ss << "# TYPE mst_uptime_seconds gauge\n";
+    ss << "mst_uptime_seconds " << std::chrono::duration<double>(Clock::now() - startTime).count() << "\n";
+    ss << "# TYPE mst_connections_accepted_total counter\n";
+    ss << "mst_connections_accepted_total " << connectionsAccepted.load(std::memory_order_relaxed) << "\n";
+    ss << "# TYPE mst_connections_active gauge\n";
+    ss << "mst_connections_active " << connectionsActive.load(std::memory_order_relaxed) << "\n";
+
+    ss << "# TYPE mst_command_latency_seconds summary\n";
+    for (const auto &command : commands)
+    {
+        writePrometheusSummary(ss, "mst_command_latency_seconds", "command=\"" + command->name + "\"", command->latency);
+    }
+
+    const auto &shards = graphs.getShards();
+    ss << "# TYPE mst_stage_queue_depth gauge\n";
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        for (int stage = 0; stage < Pipeline::getStageCount(); ++stage)
+        {
+            ss << "mst_stage_queue_depth{shard=\"" << shard << "\",stage=\"" << stage << "\"} "
+               << shards[shard]->getStage(stage).getQueueDepth() << "\n";
+        }
+    }
+    ss << "# TYPE mst_stage_queue_wait_seconds summary\n";
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        for (int stage = 0; stage < Pipeline::getStageCount(); ++stage)
+        {
+            std::string labels = "shard=\"" + std::to_string(shard) + "\",stage=\"" + std::to_string(stage) + "\"";
+            writePrometheusSummary(ss, "mst_stage_queue_wait_seconds", labels, shards[shard]->getStage(stage).getQueueWait());
+        }
+    }
+    ss << "# TYPE mst_stage_service_seconds summary\n";
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        for (int stage = 0; stage < Pipeline::getStageCount(); ++stage)
+        {
+            std::string labels = "shard=\"" + std::to_string(shard) + "\",stage=\"" + std::to_string(stage) + "\"";
+            writePrometheusSummary(ss, "mst_stage_service_seconds", labels, shards[shard]->getStage(stage).getServiceTime());
+        }
+    }
+    ss << "# TYPE mst_shard_rejected_tasks_total counter\n";
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        ss << "mst_shard_rejected_tasks_total{shard=\"" << shard << "\"} " << shards[shard]->getRejectedCount() << "\n";
+    }
+    ss << "# TYPE mst_shard_shed_tasks_total counter\n";
+    for (size_t shard = 0; shard < shards.size(); ++shard)
+    {
+        ss << "mst_shard_shed_tasks_total{shard=\"" << shard << "\"} " << shards[shard]->getDroppedCount() << "\n";
+    }
+
+    auto graphList = graphs.listGraphs();
+    ss << "# TYPE mst_graph_vertices gauge\n";
+    for (const auto &graph : graphList)
+    {
+        ss << "mst_graph_vertices{graph=\"" << graph->name << "\"} " << graph->manager.getVertices() << "\n";
+    }
+    ss << "# TYPE mst_graph_edges gauge\n";
+    for (const auto &graph : graphList)
+    {
+        ss << "mst_graph_edges{graph=\"" << graph->name << "\"} " << graph->manager.getEdges() << "\n";
+    }
+    ss << "# TYPE mst_graph_version counter\n";
+    for (const auto &graph : graphList)
+    {
+        ss << "mst_graph_version{graph=\"" << graph->name << "\"} " << graph->manager.getVersion() << "\n";
+    }
+    return ss.str();
+}
+
+ServerStats::CommandTimer::CommandTimer(CommandStats &c) : command(c), started(Clock::now()), deferred(false) {}
+
+ServerStats::CommandTimer::~CommandTimer()
+{
+    if (!deferred)
+    {
+        command.latency.recordSince(started);
+    }
+}
+
+ResponseCallback ServerStats::CommandTimer::track(ResponseCallback callback)
+{
+    deferred = true;
+    CommandStats *stats = &command;
+    Clock::time_point start = started;
+    return [stats, start, callback](std::string_view response)
+    {
+        callback(response);
+        stats->latency.recordSince(start);
+    };
+}
+
+SegmentCallback ServerStats::CommandTimer::track(SegmentCallback callback)
+{
+    deferred = true;
+    CommandStats *stats = &command;
+    Clock::time_point start = started;
+    return [stats, start, callback](std::vector<Segment> segments)
+    {
+        callback(std::move(segments));
+        stats->latency.recordSince(start);
+    };
+}
+
+ChunkCallback ServerStats::CommandTimer::track(ChunkCallback callback)
+{
+    deferred = true;
+    CommandStats *stats = &command;
+    Clock::time_point start = started;
+    return [stats, start, callback](std::string chunk, bool last)
+    {
+        callback(std::move(chunk), last);
+        if (last)
+        {
+            stats->latency.recordSince(start);
+        }
+    };
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include "Connection.hpp"
+#include "LatencyHistogram.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class GraphRegistry;
+
+// Request count and latency of one command
+struct CommandStats
+{
+    std::string name;
+    LatencyHistogram latency;
+    CommandStats(const std::string &commandName) : name(commandName) {}
+};
+
+// Runtime counters of the server, shared by all client threads without locks. Together with the
+// per-stage histograms of the pipeline shards it separates time spent queueing, computing and
+// writing, and it is reported by the stats command and the Prometheus endpoint.
+class ServerStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    ServerStats();
+
+    // Stats of a command; names the server does not know share one "other" entry
+    CommandStats &getCommand(std::string_view name);
+    void connectionOpened();
+    void connectionClosed();
+
+    std::string format(const GraphRegistry &graphs) const;
+    std::string formatPrometheus(const GraphRegistry &graphs) const;
+
+    // Times one request. Synchronous commands are recorded when the timer goes out of scope; once a
+    // response callback is wrapped with track(), the latency is recorded when that callback delivers
+    // the (last piece of the) response instead, which may be on a pipeline thread.
+    class CommandTimer
+    {
+    public:
+        CommandTimer(CommandStats &command);
+        ~CommandTimer();
+        CommandTimer(const CommandTimer &) = delete;
+        CommandTimer &operator=(const CommandTimer &) = delete;
+
+        ResponseCallback track(ResponseCallback callback);
+        SegmentCallback track(SegmentCallback callback);
+        ChunkCallback track(ChunkCallback callback);
+
+    private:
+        CommandStats &command;
+        Clock::time_point started;
+        bool deferred;
+    };
+
+private:
+    Clock::time_point startTime;
+    std::vector<std::unique_ptr<CommandStats>> commands; // Fixed at construction; the last one is "other"
+    std::atomic<uint64_t> connectionsAccepted;
+    std::atomic<uint64_t> connectionsActive;
+};
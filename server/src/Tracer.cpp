@@ -0,0 +1,260 @@
+// This file implements Tracer.
+//
+// Every thread that records spans owns a ring buffer of bufferCapacity slots and is its only writer.
+// Slots are protected by a sequence number (odd while being written), so the exporter can copy them
+// while workers keep recording and simply skips slots that were overwritten mid-copy. A thread's
+// buffer goes back to a free list when the thread exits and is reused by the next new thread, so
+// one-thread-per-connection servers do not accumulate buffers.
+
+#include "Tracer.hpp"
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+std::atomic<bool> Tracer::enabled(false);
+
+namespace
+{
+    const size_t bufferCapacity = 4096; // Most recent spans kept per thread
+
+    struct Slot
+    {
+        std::atomic<uint64_t> sequence{0}; // 2 * index + 1 while writing, 2 * index + 2 when complete
+        std::atomic<uint64_t> request{0};
+        std::atomic<const char *> name{nullptr};
+        std::atomic<int> stage{0};
+        std::atomic<uint32_t> thread{0};
+        std::atomic<uint64_t> enqueued{0};
+        std::atomic<uint64_t> started{0};
+        std::atomic<uint64_t> finished{0};
+    };
+
+    struct ThreadBuffer
+    {
+        std::array<Slot, bufferCapacity> slots;
+        std::atomic<uint64_t> head{0}; // Number of spans ever written
+        bool inUse = true;
+    };
+
+    // A plain copy of a slot taken by the exporter
+    struct Span
+    {
+        uint64_t request;
+        const char *name;
+        int stage;
+        uint32_t thread;
+        uint64_t enqueued;
+        uint64_t started;
+        uint64_t finished;
+    };
+
+    std::mutex registryMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers; // Never shrinks; buffers are recycled
+    std::atomic<uint32_t> nextThreadId(1);
+    std::atomic<uint64_t> nextRequestId(1);
+    thread_local uint64_t currentRequest = 0;
+
+    // Gives the buffer back to the free list when its thread exits
+    struct BufferHandle
+    {
+        ThreadBuffer *buffer = nullptr;
+        uint32_t threadId = 0;
+        ~BufferHandle()
+        {
+            if (buffer)
+            {
+                std::lock_guard<std::mutex> lock(registryMutex);
+                buffer->inUse = false;
+            }
+        }
+    };
+    thread_local BufferHandle handle;
+
+    ThreadBuffer &localBuffer()
+    {
+        if (!handle.buffer)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto &buffer : buffers)
+            {
+                if (!buffer->inUse)
+                {
+                    buffer->inUse = true;
+                    handle.buffer = buffer.get();
+                    break;
+                }
+            }
+            if (!handle.buffer)
+            {
+                buffers.push_back(std::make_unique<ThreadBuffer>());
+                handle.buffer = buffers.back().get();
+            }
+            handle.threadId = nextThreadId++;
+        }
+        return *handle.buffer;
+    }
+}
+
+void Tracer::setEnabled(bool on)
+{
+    enabled.store(on, std::memory_order_relaxed);
+}
+
+// Forgets recorded spans by invalidating the sequence number of every slot, which keeps the writers
+// lock-free; a span being written concurrently may survive.
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (auto &buffer : buffers)
+    {
+        for (auto &slot : buffer->slots)
+        {
+            slot.sequence.store(0, std::memory_order_release);
+        }
+    }
+}
+
+uint64_t Tracer::now()
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t Tracer::getCurrentRequest()
+{
+    return currentRequest;
+}
+
+void Tracer::record(uint64_t request, const char *name, int stage, uint64_t enqueued, uint64_t started, uint64_t finished)
+{
+    ThreadBuffer &buffer = localBuffer();
+    uint64_t index = buffer.head.load(std::memory_order_relaxed);
+    Slot &slot = buffer.slots[index % bufferCapacity];
+    slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.request.store(request, std::memory_order_relaxed);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.stage.store(stage, std::memory_order_relaxed);
+    slot.thread.store(handle.threadId, std::memory_order_relaxed);
+    slot.enqueued.store(enqueued, std::memory_order_relaxed);
+    slot.started.store(started, std::memory_order_relaxed);
+    slot.finished.store(finished, std::memory_order_relaxed);
+    slot.sequence.store(2 * index + 2, std::memory_order_release);
+    buffer.head.store(index + 1, std::memory_order_release);
+}
+
+std::function<void()> Tracer::wrap(std::function<void()> task, const char *name, int stage)
+{
+    if (!isEnabled())
+    {
+        return task;
+    }
+    uint64_t request = currentRequest;
+    uint64_t enqueued = now();
+    return [task = std::move(task), request, enqueued, name, stage]()
+    {
+        uint64_t previous = currentRequest;
+        currentRequest = request;
+        uint64_t started = now();
+        try
+        {
+            task();
+        }
+        catch (...)
+        {
+            record(request, name, stage, enqueued, started, now());
+            currentRequest = previous;
+            throw;
+        }
+        record(request, name, stage, enqueued, started, now());
+        currentRequest = previous;
+    };
+}
+
+// Chrome trace format: every span is a complete ("X") event on the thread that ran it, and queue
+// waits are async events on a track per request, since waits on one stage overlap each other.
+std::string Tracer::exportChromeTrace()
+{
+    std::vector<Span> spans;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto &buffer : buffers)
+        {
+            uint64_t head = buffer->head.load(std::memory_order_acquire);
+            uint64_t first = head > bufferCapacity ? head - bufferCapacity : 0;
+            for (uint64_t index = first; index < head; ++index)
+            {
+                const Slot &slot = buffer->slots[index % bufferCapacity];
+                uint64_t before = slot.sequence.load(std::memory_order_acquire);
+                Span span{slot.request.load(std::memory_order_relaxed), slot.name.load(std::memory_order_relaxed),
+                          slot.stage.load(std::memory_order_relaxed), slot.thread.load(std::memory_order_relaxed),
+                          slot.enqueued.load(std::memory_order_relaxed), slot.started.load(std::memory_order_relaxed),
+                          slot.finished.load(std::memory_order_relaxed)};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                uint64_t after = slot.sequence.load(std::memory_order_relaxed);
+                if (before == 2 * index + 2 && after == before)
+                {
+                    spans.push_back(span);
+                }
+            }
+        }
+    }
+
+    std::stringstream ss;
+    ss << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]()
+    {
+        if (!first)
+        {
+            ss << ",";
+        }
+        first = false;
+    };
+    ss.setf(std::ios::fixed);
+    ss.precision(3);
+    for (const Span &span : spans)
+    {
+        const char *name = span.name ? span.name : "task";
+        if (span.started > span.enqueued)
+        {
+            separator();
+            ss << "{\"name\":\"" << name << " wait\",\"cat\":\"queue\",\"ph\":\"b\",\"id\":" << span.request
+               << ",\"pid\":1,\"tid\":" << span.thread << ",\"ts\":" << span.enqueued / 1000.0
+               << ",\"args\":{\"request\":" << span.request << ",\"stage\":" << span.stage << "}}";
+            separator();
+            ss << "{\"name\":\"" << name << " wait\",\"cat\":\"queue\",\"ph\":\"e\",\"id\":" << span.request
+               << ",\"pid\":1,\"tid\":" << span.thread << ",\"ts\":" << span.started / 1000.0 << "}";
+        }
+        separator();
+        ss << "{\"name\":\"" << name << "\",\"cat\":\"run\",\"ph\":\"X\",\"pid\":1,\"tid\":" << span.thread
+           << ",\"ts\":" << span.started / 1000.0 << ",\"dur\":" << (span.finished - span.started) / 1000.0
+           << ",\"args\":{\"request\":" << span.request << ",\"stage\":" << span.stage
+           << ",\"wait_us\":" << (span.started - span.enqueued) / 1000.0 << "}}";
+    }
+    ss << "]}\n";
+    return ss.str();
+}
+
+Tracer::RequestScope::RequestScope(const char *n)
+    : name(n), request(0), previous(currentRequest), started(0)
+{
+    if (isEnabled())
+    {
+        request = nextRequestId.fetch_add(1, std::memory_order_relaxed);
+        started = now();
+    }
+    currentRequest = request;
+}
+
+Tracer::RequestScope::~RequestScope()
+{
+    if (request != 0)
+    {
+        record(request, name, -1, started, started, now());
+    }
+    currentRequest = previous;
+}
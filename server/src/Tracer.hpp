@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Lightweight span tracing for requests that cross pipeline stages. While tracing is on, every request
+// gets an ID that follows its work through Pipeline::dispatch (the ID rides along with the task in a
+// thread-local, so no pipeline signature changes). Each stage task records when it was enqueued,
+// dequeued and finished into a fixed-size ring buffer owned by the recording thread, so recording
+// takes no locks. The buffers can be exported as Chrome trace JSON (chrome://tracing, Perfetto).
+class Tracer
+{
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static void clear();
+
+    // Nanoseconds on the steady clock
+    static uint64_t now();
+    static uint64_t getCurrentRequest();
+
+    // Records one span; enqueued == started means the work did not wait in a queue
+    static void record(uint64_t request, const char *name, int stage, uint64_t enqueued, uint64_t started,
+                       uint64_t finished);
+
+    // Wraps a task about to be queued on a stage: the task runs under the current request ID and
+    // records its queue wait and run time. Returns the task unchanged while tracing is off.
+    static std::function<void()> wrap(std::function<void()> task, const char *name, int stage);
+
+    static std::string exportChromeTrace();
+
+    // Starts a new request on this thread and records the time until the scope ends as a span named
+    // after the command. Work dispatched inside the scope inherits the request ID.
+    class RequestScope
+    {
+    public:
+        RequestScope(const char *name);
+        ~RequestScope();
+        RequestScope(const RequestScope &) = delete;
+        RequestScope &operator=(const RequestScope &) = delete;
+
+    private:
+        const char *name;
+        uint64_t request;
+        uint64_t previous;
+        uint64_t started;
+    };
+
+private:
+    static std::atomic<bool> enabled;
+};
@@ -2,12 +2,16 @@
 
 // Include necessary headers
 #include "Server.hpp"
+#include "CpuAffinity.hpp"
+#include "../../common/WeightKernels.hpp"
 #include <iostream>
 #include <csignal>
 #include <atomic>
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <string>
+#include <cstdlib>
 
 // Global variables
 std::atomic<bool> shutdownRequested(false); // Flag to indicate if shutdown is requested
@@ -28,12 +32,139 @@ void signalHandler(int signum)
     }
 }
 
+// Parses command line options into the server configuration
+ServerConfig parseArguments(int argc, char *argv[])
+{
+    ServerConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--data-dir" && i + 1 < argc)
+        {
+            config.dataDirectory = argv[++i];
+        }
+        else if (arg == "--snapshot-interval" && i + 1 < argc)
+        {
+            config.snapshotInterval = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--shards" && i + 1 < argc)
+        {
+            config.shardCount = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--max-graphs" && i + 1 < argc)
+        {
+            config.maxGraphs = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--queue-capacity" && i + 1 < argc)
+        {
+            config.stageQueueCapacity = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--max-pending" && i + 1 < argc)
+        {
+            config.maxPendingPerShard = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--edge-dir" && i + 1 < argc)
+        {
+            config.edgeDirectory = argv[++i];
+        }
+        else if (arg == "--external-memory" && i + 1 < argc)
+        {
+            config.externalMemoryBudget = std::strtoul(argv[++i], nullptr, 10) << 20;
+        }
+        else if (arg == "--stage-cpus" && i + 1 < argc)
+        {
+            config.stageCpus = CpuAffinity::parseCpuList(argv[++i]);
+        }
+        else if (arg == "--io-cpus" && i + 1 < argc)
+        {
+            config.ioCpus = CpuAffinity::parseCpuList(argv[++i]);
+        }
+        else if (arg == "--request-timeout" && i + 1 < argc)
+        {
+            config.requestTimeoutMs = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--io-threads" && i + 1 < argc)
+        {
+            config.ioThreads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--blocking-threads" && i + 1 < argc)
+        {
+            config.blockingThreads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--metrics-port" && i + 1 < argc)
+        {
+            config.metricsPort = std::atoi(argv[++i]);
+        }
+        else if (arg == "--overflow-policy" && i + 1 < argc)
+        {
+            std::string policy = argv[++i];
+            if (policy == "block")
+            {
+                config.overflowPolicy = OverflowPolicy::Block;
+            }
+            else if (policy == "reject")
+            {
+                config.overflowPolicy = OverflowPolicy::Reject;
+            }
+            else if (policy == "shed-oldest")
+            {
+                config.overflowPolicy = OverflowPolicy::DropOldest;
+            }
+            else
+            {
+                throw std::invalid_argument("Unknown overflow policy: " + policy + " (use block, reject or shed-oldest)");
+            }
+        }
+        else if (arg == "--apsp-threads" && i + 1 < argc)
+        {
+            config.apspThreads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--apsp-concurrency" && i + 1 < argc)
+        {
+            config.apspConcurrency = std::strtoul(argv[++i], nullptr, 10);
+            if (config.apspConcurrency == 0)
+            {
+                throw std::invalid_argument("--apsp-concurrency must be at least 1");
+            }
+        }
+        else if (arg == "--sssp-threads" && i + 1 < argc)
+        {
+            config.ssspThreads = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--strict-input")
+        {
+            config.strictInput = true;
+        }
+        else if (arg == "--weight-kernels" && i + 1 < argc)
+        {
+            std::string kernels = argv[++i];
+            if (!WeightKernels::setImplementation(kernels))
+            {
+                throw std::invalid_argument("Unavailable weight kernels: " + kernels + " (use auto, avx2 or scalar)");
+            }
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown option: " + arg +
+                                        "\nUsage: server_exe [--data-dir <dir>] [--snapshot-interval <n>] [--shards <n>]"
+                                        "\n                  [--max-graphs <n>] [--queue-capacity <n>] [--overflow-policy block|reject|shed-oldest]"
+                                        "\n                  [--max-pending <n>] [--edge-dir <dir>] [--external-memory <MB>]"
+                                        "\n                  [--metrics-port <port>] [--stage-cpus <list>] [--io-cpus <list>]"
+                                        "\n                  [--io-threads <n>] [--blocking-threads <n>] [--request-timeout <ms>]"
+                                        "\n                  [--weight-kernels auto|avx2|scalar]"
+                                        "\n                  [--apsp-threads <n>] [--apsp-concurrency <n>] [--sssp-threads <n>] [--strict-input]");
+        }
+    }
+    return config;
+}
+
 // Main function
-int main()
+int main(int argc, char *argv[])
 {
     try
     {
-        Server server(9036); // Create a Server instance on port 9036
+        ServerConfig config = parseArguments(argc, argv);
+        Server server(9036, config); // Create a Server instance on port 9036
         serverPtr = &server; // Set the global server pointer
 
         // Register signal handlers for SIGINT and SIGTERM
@@ -42,7 +173,7 @@ int main()
 
         {
             std::lock_guard<std::mutex> lock(coutMutex);
-            std::cout << "Starting server on port 9036..." << std::endl;
+            std::cout << "Starting server on port 9036 (" << WeightKernels::getImplementation() << " weight kernels)..." << std::endl;
         }
         server.start(); // Start the server
 
@@ -0,0 +1,100 @@
+// This is the graphgen command line tool, which writes generated graphs to files the server reads.
+//
+//   graphgen <kind> <parameters...> [seed <s>] [weights <min> <max>] [--output <file>] [--edge-file <file>]
+//
+// The graph is written in the snapshot format (to stdout unless --output is given), so it can be
+// placed at <data-dir>/<graph name>/graph.snapshot before the server starts. --edge-file also writes
+// the binary edge list read by "calculate_mst external".
+
+#include "GraphGenerator.hpp"
+#include "GraphSnapshot.hpp"
+#include "ExternalKruskal.hpp"
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Creates the directory a file is about to be written to
+void createParentDirectory(const std::string &path)
+{
+    std::filesystem::path parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty())
+    {
+        std::filesystem::create_directories(parent);
+    }
+}
+
+// Prints how to call the tool
+void printUsage(const char *program)
+{
+    std::cerr << "Usage: " << program << " " << GraphGenerator::getUsage() << "\n"
+              << "       [--output <snapshot file>] [--edge-file <binary edge file>]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<std::string> args;
+    std::string outputPath;
+    std::string edgePath;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc)
+        {
+            outputPath = argv[++i];
+        }
+        else if (arg == "--edge-file" && i + 1 < argc)
+        {
+            edgePath = argv[++i];
+        }
+        else if (arg == "--help" || arg == "-h")
+        {
+            printUsage(argv[0]);
+            return 0;
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    try
+    {
+        GraphGenerator::Spec spec = GraphGenerator::parse(args);
+        Graph graph = GraphGenerator::generate(spec);
+
+        if (outputPath.empty())
+        {
+            GraphSnapshot::write(graph, std::cout);
+            std::cout.flush();
+        }
+        else
+        {
+            std::ostringstream out;
+            GraphSnapshot::write(graph, out);
+            createParentDirectory(outputPath);
+            GraphSnapshot::writeFile(outputPath, out.str());
+        }
+        if (!edgePath.empty())
+        {
+            createParentDirectory(edgePath);
+            ExternalKruskal::writeEdgeFile(graph, edgePath);
+        }
+        std::cerr << "Generated " << spec.kind << " graph (seed " << spec.seed << "): " << graph.getVertices()
+                  << " vertices, " << graph.getEdges() << " edges" << std::endl;
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 2;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}